@@ -0,0 +1,317 @@
+#include "file_solver.hpp"
+#include "synthetic.hpp"
+
+#include "mathModelling.hpp"
+#include "solvers/solver_bonmin.hpp"
+#include "solvers/solver_cbc.hpp"
+#include "solvers/solver_enum.hpp"
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <dirent.h>
+#include <algorithm>
+#include <iostream>
+
+/*
+    ethelo_bench times every stage of a solve separately, over the fixture
+    decisions and over synthetic ones:
+
+        ethelo_bench [--repeat N] [--format csv|json] [--no-fixtures] [--crossover]
+                     [--synthetic OPTIONS:VOTERS[:CRITERIA]]... [DIR]...
+
+    DIRs hold decision.json, influents.json, weights.json and config.json as
+    read by runner. Without DIRs every fixture under api/tests/fixtures is
+    used; without --synthetic two default synthetic decisions are added.
+
+    Stages are timed on the same decision, loaded from a preproc like
+    interface::solve does but without range discovery. Each stage is run N
+    times (default 5) and reported as one row of input, stage, repetitions
+    and the min, median and mean wall time in seconds.
+
+    Decisions with at most solver_enum::max_variables free options are also
+    solved by enumeration (solve_enum), whatever their enumeration_limit.
+    --crossover adds synthetic decisions of 8 to 26 options, so that
+    solve_enum and solve_cbc show where enumeration stops paying off.
+*/
+
+using namespace ethelo;
+
+namespace
+{
+    struct bench_input {
+        std::string name;
+        std::string decision_json, influents_json, weights_json, config_json;
+    };
+
+    struct bench_row {
+        std::string input, stage;
+        std::vector<double> seconds;
+    };
+
+    typedef std::chrono::steady_clock bench_clock;
+
+    double since(bench_clock::time_point start) {
+        return std::chrono::duration<double>(bench_clock::now() - start).count();
+    }
+
+    class bench {
+        size_t repeat_;
+        std::vector<bench_row> rows_;
+
+    public:
+        bench(size_t repeat) : repeat_(repeat) {}
+        const std::vector<bench_row>& rows() const { return rows_; }
+
+        // times fn() repeat times; setup() runs untimed before each call and
+        //   returns the state fn works on
+        template<typename Setup, typename Fn>
+        void stage(const std::string& input, const std::string& name, Setup setup, Fn fn) {
+            bench_row row{input, name, {}};
+            try {
+                for (size_t i = 0; i < repeat_; i++) {
+                    auto state = setup();
+                    auto start = bench_clock::now();
+                    fn(state);
+                    row.seconds.push_back(since(start));
+                }
+                rows_.push_back(row);
+            }
+            catch (const std::exception& ex) {
+                std::cerr << input << ": " << name << " failed: " << ex.what() << std::endl;
+            }
+        }
+
+        template<typename Fn>
+        void stage(const std::string& input, const std::string& name, Fn fn) {
+            stage(input, name, [] { return 0; }, [&](int) { fn(); });
+        }
+    };
+
+    template<typename Ty>
+    Ty read(const std::string& text) {
+        return serializer<Ty>::create("json")->deserialize(text);
+    }
+
+    void run(bench& b, const bench_input& in) {
+        const std::string& name = in.name;
+
+        b.stage(name, "deserialize_decision", [&] { read<decision>(in.decision_json); });
+        b.stage(name, "deserialize_votes", [&] {
+            read<vote_matrix>(in.influents_json);
+            read<arma::mat>(in.weights_json);
+            read<solver_config>(in.config_json);
+        });
+
+        std::string preproc_data;
+        b.stage(name, "preproc", [&] { preproc_data = interface::preproc(in.decision_json); });
+        if (preproc_data.empty()) return;
+
+        decision dec;
+        {
+            expression::deferred_parsing defer;
+            dec = read<decision>(in.decision_json);
+        }
+        const std::string hash = interface::hash(in.decision_json);
+        b.stage(name, "load_preproc", [&] {
+            std::istringstream iss(preproc_data);
+            MathProgram::loadFromStream(iss, dec, hash, interface::version());
+        });
+
+        std::istringstream iss(preproc_data);
+        std::unique_ptr<MathProgram> preproc = MathProgram::loadFromStream(iss, dec, hash, interface::version());
+        dec.linkMathProgram(preproc.get());
+
+        vote_matrix votes = read<vote_matrix>(in.influents_json);
+        solver_config config = read<solver_config>(in.config_json);
+        dec.load(votes.values, votes.nulls, read<arma::mat>(in.weights_json));
+        dec.configure({config.collective_identity, config.tipping_point, false, false,
+                       config.support_only, config.per_option_satisfaction,
+                       config.normalize_influents, config.histogram_bins, config.enumeration_limit});
+
+        solver s;
+        auto image = [&] { return s.formMP(dec); };
+        b.stage(name, "create_image", [&] { image(); });
+        b.stage(name, "linearize", image, [](std::unique_ptr<MathProgram>& MP) { MP->linearize(true); });
+
+        // CBC only handles a linear ethelo function, i.e. a collective identity of 0
+        decision linear(dec);
+        configuration linear_config = dec.config();
+        linear_config.collective_identity = 0.0;
+        linear.configure(linear_config);
+        if (image()->is_linearizable()) {
+            b.stage(name, "solve_cbc",
+                    [&] { return s.formMP(linear); },
+                    [](std::unique_ptr<MathProgram>& MP) { solver_CBC cbc(MP.get()); });
+        }
+
+        b.stage(name, "solve_bonmin",
+                [&]() -> std::unique_ptr<MathProgram> { auto MP = image(); MP->linearize(true); return MP; },
+                [](std::unique_ptr<MathProgram>& MP) { solver_bonmin bonmin; bonmin.solve(MP.get()); });
+
+        solution sol;
+        b.stage(name, "solve",
+                [&] { dec.keep_ranking(nullptr); return 0; },
+                [&](int) { sol = dec.solve(); });
+        arma::vec x = sol.success ? sol.x : arma::vec(dec.dim(), arma::fill::ones);
+
+        // a fresh sweep each time, not the ranking of the previous one
+        configuration enumerated = dec.config();
+        enumerated.enumeration_limit = solver_enum::max_variables;
+        dec.configure(enumerated);
+        if (solver_enum::applicable(*image())) {
+            b.stage(name, "solve_enum",
+                    [&] { dec.keep_ranking(nullptr); return image(); },
+                    [&](std::unique_ptr<MathProgram>& MP) { solver_enum enumeration(MP.get(), dec); enumeration.get_solution(); });
+        }
+
+        b.stage(name, "compute_fgh", [&] { solution::compute_fgh(dec, x); });
+        b.stage(name, "statistics", [&] { dec.statistics(x, false); });
+
+        if (sol.success) {
+            result_set res_set;
+            res_set.config = config;
+            res_set.results.push_back(result(dec, sol, 0, false));
+            b.stage(name, "serialize_result", [&] { serializer<result_set>::create("json")->serialize(res_set); });
+        }
+
+        dec.unlinkMathProgram();
+    }
+
+    std::vector<std::string> fixture_dirs() {
+        std::vector<std::string> dirs;
+        if (DIR* dir = opendir(ETHELO_FIXTURES_DIR)) {
+            while (dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..")
+                    dirs.push_back(std::string(ETHELO_FIXTURES_DIR) + "/" + name);
+            }
+            closedir(dir);
+        }
+        std::sort(dirs.begin(), dirs.end());
+        return dirs;
+    }
+
+    synthetic_spec parse_spec(const std::string& text) {
+        synthetic_spec spec;
+        char sep1 = 0, sep2 = 0;
+        std::istringstream iss(text);
+        iss >> spec.options >> sep1 >> spec.voters;
+        if (!iss || sep1 != ':')
+            throw std::invalid_argument("expected OPTIONS:VOTERS[:CRITERIA], got '" + text + "'");
+        if (iss >> sep2 >> spec.criteria && sep2 != ':')
+            throw std::invalid_argument("expected OPTIONS:VOTERS[:CRITERIA], got '" + text + "'");
+        return spec;
+    }
+
+    struct summary { double min, median, mean; };
+
+    summary summarize(std::vector<double> seconds) {
+        std::sort(seconds.begin(), seconds.end());
+        double total = 0.0;
+        for (double s : seconds) total += s;
+        size_t n = seconds.size();
+        double median = n % 2 ? seconds[n / 2] : 0.5 * (seconds[n / 2 - 1] + seconds[n / 2]);
+        return {seconds.front(), median, total / n};
+    }
+
+    void write_csv(std::ostream& out, const std::vector<bench_row>& rows) {
+        out << "input,stage,repetitions,min_s,median_s,mean_s\n";
+        out.precision(9);
+        for (const auto& row : rows) {
+            summary s = summarize(row.seconds);
+            out << row.input << ',' << row.stage << ',' << row.seconds.size() << ','
+                << s.min << ',' << s.median << ',' << s.mean << '\n';
+        }
+    }
+
+    void write_json(std::ostream& out, const std::vector<bench_row>& rows) {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        writer.StartObject();
+        writer.Key("version"); writer.String(interface::version().c_str());
+        writer.Key("results");
+        writer.StartArray();
+        for (const auto& row : rows) {
+            summary s = summarize(row.seconds);
+            writer.StartObject();
+            writer.Key("input"); writer.String(row.input.c_str());
+            writer.Key("stage"); writer.String(row.stage.c_str());
+            writer.Key("repetitions"); writer.Uint(row.seconds.size());
+            writer.Key("min_s"); writer.Double(s.min);
+            writer.Key("median_s"); writer.Double(s.median);
+            writer.Key("mean_s"); writer.Double(s.mean);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+        out << buffer.GetString() << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t repeat = 5;
+    std::string format = "csv";
+    bool fixtures = true, crossover = false;
+    std::vector<std::string> dirs;
+    std::vector<synthetic_spec> specs;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--repeat" && has_value) repeat = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--format" && has_value) format = argv[++i];
+            else if (arg == "--synthetic" && has_value) specs.push_back(parse_spec(argv[++i]));
+            else if (arg == "--no-fixtures") fixtures = false;
+            else if (arg == "--crossover") crossover = true;
+            else if (arg.compare(0, 2, "--") == 0) throw std::invalid_argument("unknown option " + arg);
+            else dirs.push_back(arg);
+        }
+        if (format != "csv" && format != "json")
+            throw std::invalid_argument("format must be csv or json");
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << "\n"
+                  << "usage: ethelo_bench [--repeat N] [--format csv|json] [--no-fixtures] [--crossover] "
+                  << "[--synthetic OPTIONS:VOTERS[:CRITERIA]]... [DIR]...\n";
+        return 1;
+    }
+
+    if (dirs.empty() && fixtures) dirs = fixture_dirs();
+    if (crossover) {
+        for (size_t options : {8, 12, 16, 18, 20, 22, 24, 26}) {
+            synthetic_spec spec;
+            spec.options = options;
+            spec.voters = 200;
+            specs.push_back(spec);
+        }
+    }
+    else if (specs.empty()) {
+        specs.resize(2);
+        specs[0].options = 20;  specs[0].voters = 200;
+        specs[1].options = 100; specs[1].voters = 2000;
+    }
+
+    std::vector<bench_input> inputs;
+    for (const auto& dir : dirs) {
+        inputs.push_back({dir.substr(dir.find_last_of('/') + 1),
+                          file2str(dir + "/decision.json"), file2str(dir + "/influents.json"),
+                          file2str(dir + "/weights.json"), file2str(dir + "/config.json")});
+    }
+    for (const auto& spec : specs) {
+        synthetic_decision gen = generate_decision(spec);
+        inputs.push_back({spec_name(spec), gen.decision_json, gen.influents_json, gen.weights_json, gen.config_json});
+    }
+
+    bench b(repeat);
+    for (const auto& in : inputs) {
+        std::cerr << "benchmarking " << in.name << std::endl;
+        try { run(b, in); }
+        catch (const std::exception& ex) { std::cerr << in.name << ": " << ex.what() << std::endl; }
+    }
+
+    if (format == "json") write_json(std::cout, b.rows());
+    else write_csv(std::cout, b.rows());
+    return 0;
+}
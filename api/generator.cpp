@@ -0,0 +1,76 @@
+#include "synthetic.hpp"
+
+#include <sys/stat.h>
+#include <iostream>
+
+/*
+    generator writes a synthetic decision directory that runner and
+    ethelo_bench read directly:
+
+        generator DIR [--options N] [--criteria N] [--details N] [--voters N]
+                      [--groups N] [--no-budget] [--ratios N] [--abs N] [--sqrt N]
+                      [--nulls P] [--weights none|uniform|random|skewed] [--seed N]
+
+    See synthetic_spec for what each parameter controls. The same arguments
+    always produce the same files.
+*/
+
+using namespace ethelo;
+
+static synthetic_spec::weight_pattern parse_weights(const std::string& name) {
+    if (name == "none") return synthetic_spec::weight_pattern::none;
+    if (name == "uniform") return synthetic_spec::weight_pattern::uniform;
+    if (name == "random") return synthetic_spec::weight_pattern::random;
+    if (name == "skewed") return synthetic_spec::weight_pattern::skewed;
+    throw std::invalid_argument("unknown weight pattern '" + name + "'");
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir;
+    synthetic_spec spec;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--no-budget") { spec.budget = false; continue; }
+            if (arg.compare(0, 2, "--") != 0) {
+                if (!dir.empty()) throw std::invalid_argument("more than one output directory");
+                dir = arg;
+                continue;
+            }
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+
+            std::string value = argv[++i];
+            if (arg == "--options") spec.options = std::stoul(value);
+            else if (arg == "--criteria") spec.criteria = std::stoul(value);
+            else if (arg == "--details") spec.details = std::stoul(value);
+            else if (arg == "--voters") spec.voters = std::stoul(value);
+            else if (arg == "--groups") spec.groups = std::stoul(value);
+            else if (arg == "--ratios") spec.ratios = std::stoul(value);
+            else if (arg == "--abs") spec.abs_constraints = std::stoul(value);
+            else if (arg == "--sqrt") spec.sqrt_constraints = std::stoul(value);
+            else if (arg == "--nulls") spec.null_density = std::stod(value);
+            else if (arg == "--weights") spec.weights = parse_weights(value);
+            else if (arg == "--seed") spec.seed = std::stoull(value);
+            else throw std::invalid_argument("unknown option " + arg);
+        }
+        if (dir.empty()) throw std::invalid_argument("no output directory");
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << "\n"
+                  << "usage: generator DIR [--options N] [--criteria N] [--details N] [--voters N] [--groups N]\n"
+                  << "                     [--no-budget] [--ratios N] [--abs N] [--sqrt N] [--nulls P]\n"
+                  << "                     [--weights none|uniform|random|skewed] [--seed N]\n";
+        return 1;
+    }
+
+    try {
+        mkdir(dir.c_str(), 0755); // may already exist
+        write_decision(generate_decision(spec), dir);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -4,6 +4,8 @@
 #include "mathModelling.hpp"	// For preprocessing, located in engine/ folder
 #include <sys/stat.h>			// for checking whether the cache folder exists and creating folders in Linux
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
 
 namespace ethelo
 {
@@ -15,6 +17,27 @@ namespace ethelo
         }
     }
 
+    // With a preproc available the expression trees are never needed,
+    // so parsing is deferred until something asks for an AST.
+    static decision load_decision(const std::string& decision_json, bool defer_parsing)
+    {
+        expression::deferred_parsing defer(defer_parsing);
+        return deserialize<decision>("json", "decision", decision_json);
+    }
+
+    static void configure(decision& dec, const solver_config& config)
+    {
+        dec.configure({config.collective_identity,                               /* collective_identity */
+                       config.tipping_point,                                     /* tipping_point */
+                       false,                                                    /* minimize */
+                       (config.normalize_satisfaction && !config.single_outcome),/* discover_range */
+                       config.support_only,                                      /* support_only */
+                       config.per_option_satisfaction,                           /* per_option_satisfaction */
+                       config.normalize_influents,                               /* normalize_influents */
+                       config.histogram_bins,                                    /* histogram_bins */
+                       config.enumeration_limit});                               /* enumeration_limit */
+    }
+
     static result global_outcome(decision& dec, const solver_config& config)
     {
         PLOGD << "--global_outcome--";
@@ -28,32 +51,210 @@ namespace ethelo
 
         return result(dec, sol, 0, true);
     }
+
+    // links MP to the decision for the lifetime of the link, also when the request throws
+    struct math_program_link
+    {
+        decision& dec;
+
+        math_program_link(decision& dec, const MathProgram* MP) : dec(dec) { dec.linkMathProgram(MP); }
+        ~math_program_link() { dec.unlinkMathProgram(); }
+    };
+
+    static void log_memory(const decision& dec)
+    {
+        node_census::counts nodes = node_census::snapshot();
+        PLOGD << "Memory: peak RSS " << process_memory::read().peak_rss_bytes << " bytes, decision matrices "
+              << dec.matrix_bytes() << " bytes, LinExp coefficients " << nodes.coef_bytes << " bytes (peak "
+              << nodes.peak_coef_bytes << ")";
+        for (size_t t = 0; t < node_census::num_types; t++)
+            PLOGD << "  " << node_census::type_names[t] << ": " << nodes.live[t] << " live, " << nodes.peak[t] << " peak";
+    }
 	
 	std::string interface::hash(const std::string& decision_json){
 		return md5(decision_json);
 	}
 	
-	MathProgram* interface::preproc_MP(decision& dec){
-		dec.load( arma::mat(1, dec.options().size() * dec.criteria().size(), arma::fill::ones),arma::mat()); // load fake vote with default value
+	std::unique_ptr<MathProgram> interface::preproc_MP(decision& dec){
+		load_placeholder_votes(dec);
 		FixVar_Mask VM{static_cast<int>(dec.dim())}; // casting to kill the warning
 		
-		return new MathProgram(VM, dec, true, false);
+		return std::unique_ptr<MathProgram>(new MathProgram(VM, dec, true, false));
+	}
+	
+	void interface::load_placeholder_votes(decision& dec){
+		dec.load( arma::mat(1, dec.options().size() * dec.criteria().size(), arma::fill::ones),arma::mat()); // load fake vote with default value
+	}
+	
+	/*
+		Content hashes are appended to a preproc artifact after the MathProgram
+		(loadFromStream stops reading before them). The hash of a constraint or
+		display covers everything its translation depends on: its source, the
+		fragments it uses (transitively), and the values of every detail those
+		reach. The option list is hashed separately since it shapes every entry.
+	*/
+	struct content_hashes {
+		std::string options;
+		std::vector<std::string> fragments, constraints, displays;
+	};
+	
+	static std::string hash_expression(const decision& dec, const expression& expr, const std::string& extra){
+		std::set<std::string> fragments, details, pending;
+		expr.references(pending, details);
+		while (!pending.empty()){
+			std::string name = *pending.begin();
+			pending.erase(pending.begin());
+			if (!fragments.insert(name).second) continue;
+			
+			auto index = dec.fragments().find(name);
+			if (index >= 0) dec.fragments()[index].references(pending, details);
+		}
+		
+		std::ostringstream oss;
+		oss << std::setprecision(17);
+		oss << expr.type() << '\n' << extra << '\n' << expr.source() << '\n';
+		for (const auto& name : fragments){
+			auto index = dec.fragments().find(name);
+			oss << '@' << name << '=' << (index >= 0 ? dec.fragments()[index].source() : std::string("?")) << '\n';
+		}
+		for (const auto& name : details){
+			oss << '$' << name << '=';
+			const auto column = dec.details().find(name);
+			for (size_t i = 0; i < dec.dim(); i++) oss << dec.details().value(column, dec.original_option_index(i)) << ' ';
+			oss << '\n';
+		}
+		return md5(oss.str());
+	}
+	
+	static content_hashes hash_contents(const decision& dec){
+		content_hashes hashes;
+		
+		std::ostringstream options;
+		for (const auto& opt : dec.options()) options << opt.name() << '\n';
+		hashes.options = md5(options.str());
+		
+		for (const auto& frag : dec.fragments())
+			hashes.fragments.push_back(hash_expression(dec, frag, ""));
+		for (const auto& cons : dec.constraints())
+			hashes.constraints.push_back(hash_expression(dec, cons, cons.is_relaxable() ? "relaxable" : "strict"));
+		for (const auto& disp : dec.displays())
+			hashes.displays.push_back(hash_expression(dec, disp, ""));
+		return hashes;
+	}
+	
+	static void write_hashes(std::ostream& out, const content_hashes& hashes){
+		out << "hashes" << std::endl;
+		out << hashes.options << std::endl;
+		for (auto list : {&hashes.fragments, &hashes.constraints, &hashes.displays}){
+			out << list->size() << std::endl;
+			for (const auto& h : *list) out << h << std::endl;
+		}
+	}
+	
+	// returns false if the stream holds no (complete) hash section
+	static bool read_hashes(std::istream& in, content_hashes& hashes){
+		std::string tag;
+		if (!(in >> tag) || tag != "hashes" || !(in >> hashes.options)) return false;
+		for (auto list : {&hashes.fragments, &hashes.constraints, &hashes.displays}){
+			size_t n;
+			if (!(in >> n)) return false;
+			list->resize(n);
+			for (auto& h : *list)
+				if (!(in >> h)) return false;
+		}
+		return true;
+	}
+	
+	// cons_from[i] is the index of an entry of old_hashes equal to new_hashes[i], or -1
+	static std::vector<int> match_hashes(const std::vector<std::string>& old_hashes, const std::vector<std::string>& new_hashes){
+		std::unordered_map<std::string, int> index;
+		for (int i = old_hashes.size() - 1; i >= 0; i--) index[old_hashes[i]] = i;
+		
+		std::vector<int> from(new_hashes.size(), -1);
+		for (size_t i = 0; i < new_hashes.size(); i++){
+			auto it = index.find(new_hashes[i]);
+			if (it != index.end()) from[i] = it->second;
+		}
+		return from;
 	}
 	
 	std::string interface::preproc(const std::string& decision_json){
 		
 		decision dec = deserialize<decision>("json", "decision", decision_json);
+		content_hashes hashes = hash_contents(dec);
 		
-		MathProgram* MP = preproc_MP(dec);
+		std::unique_ptr<MathProgram> MP = preproc_MP(dec);
 		std::ostringstream oss;
 		MP->save(oss, hash(decision_json), version());
-		delete MP;
+		write_hashes(oss, hashes);
+		return oss.str();
+	}
+	
+	std::string interface::preproc_update(const std::string& old_preproc_data, const std::string& decision_json){
+		
+		decision dec = deserialize<decision>("json", "decision", decision_json);
+		content_hashes hashes = hash_contents(dec);
+		
+		// the header of the old artifact decides whether anything can be reused
+		std::istringstream iss(old_preproc_data);
+		std::string old_hash, old_version;
+		int n_var = -1;
+		iss >> old_hash >> old_version >> n_var;
+		
+		std::unique_ptr<MathProgram> old_MP;
+		content_hashes old_hashes;
+		if (iss && old_version == "v" + version() && n_var == static_cast<int>(dec.dim())){
+			iss.seekg(0);
+			old_MP = MathProgram::loadFromStream(iss, dec, old_hash, version());
+			if (!read_hashes(iss, old_hashes) || old_hashes.options != hashes.options ||
+					old_hashes.constraints.size() != old_MP->getConsList().size() ||
+					old_hashes.displays.size() != old_MP->getDisplayList().size()){
+				old_MP.reset();
+			}
+		}
+		
+		std::unique_ptr<MathProgram> MP;
+		if (old_MP){
+			std::vector<int> cons_from = match_hashes(old_hashes.constraints, hashes.constraints);
+			std::vector<int> disp_from = match_hashes(old_hashes.displays, hashes.displays);
+			PLOGD << "preproc_update: reusing "
+				<< std::count_if(cons_from.begin(), cons_from.end(), [](int i){ return i >= 0; }) << "/" << cons_from.size() << " constraints and "
+				<< std::count_if(disp_from.begin(), disp_from.end(), [](int i){ return i >= 0; }) << "/" << disp_from.size() << " displays";
+			
+			load_placeholder_votes(dec);
+			MP = MathProgram::update(*old_MP, dec, cons_from, disp_from);
+		}
+		else{
+			PLOGD << "preproc_update: old preproc data is not reusable, preprocessing from scratch";
+			MP = preproc_MP(dec);
+		}
+		
+		std::ostringstream oss;
+		MP->save(oss, hash(decision_json), version());
+		write_hashes(oss, hashes);
 		return oss.str();
 	}
 	
     std::string interface::solve(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data)
     {
         initLogger();
+
+        // stages of this request are timed on the calling thread
+        span_timer timer;
+        std::string output;
+        {
+            span_timer::scope timing(timer);
+            span request("solve");
+            output = solve_request(decision_json, influents_json, weights_json, config_json, preproc_data);
+        }
+
+        PLOGD << "Timings:";
+        timer.log();
+        return output;
+    }
+
+    std::string interface::solve_request(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data)
+    {
         PLOGD << "--solve--";
         PLOGD << "Decision json:\n" << decision_json;
         PLOGD << "Influents json:\n" << influents_json;
@@ -62,49 +263,68 @@ namespace ethelo
 
         PLOGD << "Parsing decision";
         solver_config config;
+        result_set res_set;
         if (!config_json.empty())
             config = deserialize<solver_config>("json", "config", config_json);
 
-        result_set res_set; res_set.config = config;
-        decision dec = deserialize<decision>("json", "decision", decision_json);
+        res_set.config = config;
+        if (config.timings || config.memory)
+            res_set.timings = span_timer::current();
+
+        // memory figures of the stages, see node_census for what is counted
+        std::unique_ptr<node_census::scope> census;
+        if (config.memory) {
+            census.reset(new node_census::scope());
+            span_timer::current()->track_memory(true);
+        }
+
+        // the stage span open, closed before the next one opens so they do not nest
+        std::unique_ptr<span> stage;
+        auto next_stage = [&stage](const char* name) { stage.reset(); stage.reset(new span(name)); };
+
+        next_stage("parse");
+        decision dec = load_decision(decision_json, !preproc_data.empty());
 		
 
 		// Pre-processing
 		
-		MathProgram* MP;
+		std::unique_ptr<MathProgram> MP;
 		
 		if (preproc_data == ""){
 			// preprocessed data not provided, translate in real time
+			next_stage("preproc");
 			MP = preproc_MP(dec); // this modifies votes of dec
 		}
 		else{
 			// load MP from preprocessed data
+			next_stage("load_preproc");
 			std::istringstream iss(preproc_data);
 			MP = MathProgram::loadFromStream(iss, dec, hash(decision_json), version());
 		}
 
-		dec.linkMathProgram(MP);
+		// declared after MP so that an exception unlinks it before MP is freed
+		std::unique_ptr<math_program_link> link(new math_program_link(dec, MP.get()));
+		stage->memory("var_mask_depth", MP->getVM()->get_maxDepth());
 		
 				
 		// Load votes
 		
+        next_stage("load_votes");
         if (!influents_json.empty()) {
-            arma::mat influents = deserialize<arma::mat>("json", "influents", influents_json);
+            vote_matrix influents = deserialize<vote_matrix>("json", "influents", influents_json);
             arma::mat weights = deserialize<arma::mat>("json", "weights", weights_json);
-            dec.load(influents, weights);
+            dec.load(influents.values, influents.nulls, weights);
         }
+        stage->memory("matrix_bytes", dec.matrix_bytes());
 
         PLOGD << "Configuring decision";
-        dec.configure({config.collective_identity,                               /* collective_identity */
-                       config.tipping_point,                                     /* tipping_point */
-                       false,                                                    /* minimize */
-                       (config.normalize_satisfaction && !config.single_outcome),/* discover_range */
-                       config.support_only,                                      /* support_only */
-                       config.per_option_satisfaction,                           /* per_option_satisfaction */
-                       config.normalize_influents,                               /* normalize_influents */
-                       config.histogram_bins});                                  /* histogram_bins */
+        next_stage("configure");
+        configure(dec, config);
 
+        next_stage("global_outcome");
         res_set.results.push_back(global_outcome(dec, config));
+        stage->memory("matrix_bytes", dec.matrix_bytes());
+        stage.reset();
 		
 
         if (!config.single_outcome) {
@@ -115,6 +335,7 @@ namespace ethelo
             PLOGD << "Searching for " << config.solution_limit << " best scenarios";
             arma::mat exclusions = base;
             for (size_t i = 0; i < config.solution_limit; i++) {
+                span scenario("scenario");
                 dec.exclude(exclusions);
                 auto sol = dec.solve(); if (!sol.success) break;
                 res_set.results.push_back(result(dec, sol, exclusions.n_rows, false));
@@ -124,6 +345,7 @@ namespace ethelo
             // Search for the worst scenario as well, unless the requset is to only search for a single scenario
             if(config.solution_limit > 1) { 
                 PLOGD << "Searching for the worst scenario";
+                span scenario("worst_scenario");
                 auto dec_conf = dec.config();
                 dec_conf.minimize = true;
                 dec.configure(dec_conf);
@@ -134,11 +356,124 @@ namespace ethelo
         }
 		
 		// memory cleanup
-		dec.unlinkMathProgram();
-		delete MP;
+		link.reset();
+		MP.reset();
 		
         PLOGD << "Serializing result set";
-        return serializer<result_set>::create("json")->serialize(res_set);
+        std::string output = serializer<result_set>::create("json")->serialize(res_set);
+
+        if (config.memory)
+            log_memory(dec);
+        return output;
+    }
+
+    std::string interface::evaluate(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data, const std::string& scenarios_json)
+    {
+        initLogger();
+
+        span_timer timer;
+        std::string output;
+        {
+            span_timer::scope timing(timer);
+            span request("evaluate");
+            output = evaluate_request(decision_json, influents_json, weights_json, config_json, preproc_data, scenarios_json);
+        }
+
+        PLOGD << "Timings:";
+        timer.log();
+        return output;
+    }
+
+    std::string interface::evaluate_request(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data, const std::string& scenarios_json)
+    {
+        PLOGD << "--evaluate--";
+        PLOGD << "Scenarios json:\n" << scenarios_json;
+
+        solver_config config;
+        result_set res_set;
+        if (!config_json.empty())
+            config = deserialize<solver_config>("json", "config", config_json);
+        if (influents_json.empty())
+            throw interface::parameter_error("influents_json: scenarios need votes to be evaluated");
+        scenario_list scenarios = deserialize<scenario_list>("json", "scenarios", scenarios_json);
+
+        res_set.config = config;
+        res_set.scenario_breakdown = false; // the global outcome carries it
+        if (config.timings || config.memory)
+            res_set.timings = span_timer::current();
+
+        std::unique_ptr<node_census::scope> census;
+        if (config.memory) {
+            census.reset(new node_census::scope());
+            span_timer::current()->track_memory(true);
+        }
+
+        std::unique_ptr<span> stage;
+        auto next_stage = [&stage](const char* name) { stage.reset(); stage.reset(new span(name)); };
+
+        next_stage("parse");
+        decision dec = load_decision(decision_json, !preproc_data.empty());
+        std::unique_ptr<MathProgram> MP;
+        if (preproc_data.empty()) {
+            next_stage("preproc");
+            MP = preproc_MP(dec); // this modifies votes of dec
+        }
+        else {
+            next_stage("load_preproc");
+            std::istringstream iss(preproc_data);
+            MP = MathProgram::loadFromStream(iss, dec, hash(decision_json), version());
+        }
+        math_program_link link(dec, MP.get());
+        stage->memory("var_mask_depth", MP->getVM()->get_maxDepth());
+
+        next_stage("load_votes");
+        vote_matrix influents = deserialize<vote_matrix>("json", "influents", influents_json);
+        arma::mat weights = deserialize<arma::mat>("json", "weights", weights_json);
+        dec.load(influents.values, influents.nulls, weights);
+        stage->memory("matrix_bytes", dec.matrix_bytes());
+
+        next_stage("configure");
+        configure(dec, config);
+
+        // one column per scenario
+        arma::mat X(dec.dim(), scenarios.options.size(), arma::fill::zeros);
+        for (size_t j = 0; j < scenarios.options.size(); j++) {
+            for (const auto& name : scenarios.options[j]) {
+                std::ptrdiff_t i = dec.options().find(name);
+                if (i < 0)
+                    throw interface::parameter_error("scenarios_json: [" + std::to_string(j) + "] unknown option '" + name + "'");
+                X(i, j) = 1.0;
+            }
+        }
+
+        next_stage("global_outcome");
+        res_set.results.push_back(global_outcome(dec, config));
+        stage->memory("matrix_bytes", dec.matrix_bytes());
+
+        PLOGD << "Evaluating " << X.n_cols << " scenarios";
+        next_stage("evaluate_scenarios");
+        auto start = std::chrono::steady_clock::now();
+        arma::mat fgh = solution::compute_fgh(dec, X);
+        solver_metrics metrics;
+        metrics.solver = "evaluation";
+        metrics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        metrics.nodes = X.n_cols;
+        metrics.rows = dec.constraints().size();
+        metrics.columns = dec.dim();
+        for (size_t j = 0; j < X.n_cols; j++) {
+            solution sol;
+            sol.fill_success(dec, X.col(j), fgh.col(j));
+            sol.metrics = metrics;
+            res_set.results.push_back(result(dec, sol, 0, false));
+        }
+        stage.reset();
+
+        PLOGD << "Serializing result set";
+        std::string output = serializer<result_set>::create("json")->serialize(res_set);
+
+        if (config.memory)
+            log_memory(dec);
+        return output;
     }
 
     void interface::validate(const std::string& type, const std::string& code) {
@@ -22,14 +22,48 @@ namespace ethelo
 		Assumptions:
 		  preproc_data is a string returned by (perhaps an old version of) the
 		    preproc(...) function below. 
+		  When preproc_data is provided, expressions in decision_json are not
+		    parsed, the translated constraints are taken from preproc_data.
 		Exceptions:
 		  - Throws std::invalid_argument if preproc_data is outdated. That is,
 			when preproc_data is provided but either
 		    1) does not correspond to the decision_json inputted; or
 			2) was generated by an engine of older version
+		Timings:
+		  The stages of the request (parsing, preproc loading, each scenario's
+		    createImage/linearize/solve, statistics and serialization) are
+		    logged at debug level. With "timings": true in config_json they
+		    are also added to the first (global) result as a "timings" tree.
 		*/
         static std::string solve(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json = "", const std::string& preproc_data="");
 
+		/*
+			evaluate(...) scores given scenarios instead of searching for them.
+		Inputs:
+			The inputs of solve(...), followed by
+			scenarios_json : a JSON array of scenarios, each an array of the
+			                 names of its options, e.g. [["a","b"],["c"]]
+		Output:
+		  A string in the format returned by solve(...): the global outcome,
+		    then one result per scenario, in order, with its ethelo score
+		    ("objective"), constraint and display values and global stats.
+		    The per option, issue and criterion stats are only given with the
+		    global outcome, since they do not depend on the scenario.
+		Notes:
+		  All scenarios are evaluated together: the ethelo scores from one
+		    product of the influents with the scenario matrix, and the
+		    constraints and displays in one pass over their compiled tapes.
+		    Constraints are reported, not enforced.
+		  The timings, metrics and memory options of config_json apply as
+		    in solve(...), with an "evaluate_scenarios" stage; the metrics of
+		    each scenario describe the whole batch.
+		Exceptions:
+		  - Those of solve(...)
+		  - Throws parameter_error if influents_json is empty or a scenario
+		    names an unknown option
+		*/
+		static std::string evaluate(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data, const std::string& scenarios_json);
+
 		
         static void validate(const std::string& type, const std::string& code);
         
@@ -60,16 +94,43 @@ namespace ethelo
 		*/
 		static std::string preproc(const std::string& decision_json);
 		
+		/*
+			preproc_update(...) returns the same data as preproc(decision_json),
+			reusing the translated constraints and displays of an artifact
+			produced for an earlier version of the decision. The artifact
+			carries a content hash per fragment, constraint and display; only
+			entries whose hash changed are translated again.
+		Input:
+			old_preproc_data: string returned by preproc(...) or preproc_update(...)
+			decision_json: string content of the edited decision.json file
+		Output:
+			a string containing data that needs to be stored
+		Notes:
+			Falls back to a full preproc when old_preproc_data was generated by
+			another code version, lacks content hashes or has a different
+			option list.
+		Exceptions:
+			Does not raise exceptions unless decision_json is ill-formatted
+		*/
+		static std::string preproc_update(const std::string& old_preproc_data, const std::string& decision_json);
+		
     protected:
         static void initLogger();
 		
+		// solve(...) without the logger setup, run with the request's span timer installed
+		static std::string solve_request(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data);
+		
+		// evaluate(...) without the logger setup, run with the request's span timer installed
+		static std::string evaluate_request(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data, const std::string& scenarios_json);
+		
 		//preproc_MP(dec) preprocesses a decision [dec] and returns the 
 		//  translated result as a MathProgram. This is used as a subprocedure
 		//  in both solve(...) and preproc(...)
-		//Warnings:
-		// 1. Caller is responsble for freeing returned object
-		// 2. This modifies/overwrites votes of [dec]
-		static MathProgram* preproc_MP(decision& dec);
+		//Warning: this modifies/overwrites votes of [dec]
+		static std::unique_ptr<MathProgram> preproc_MP(decision& dec);
+		
+		// loads the all-ones vote preproc_MP uses, since translation needs influents
+		static void load_placeholder_votes(decision& dec);
 		
     };
 
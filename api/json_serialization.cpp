@@ -152,11 +152,11 @@ namespace ethelo
         return decision(options, criteria, fragments, constraints, displays);
     }
 
-    template<> std::string json_serializer<arma::mat>::serialize(const arma::mat& matrix) {
+    template<> std::string json_serializer<vote_matrix>::serialize(const vote_matrix& votes) {
         throw std::runtime_error("not implemented");
     }
 
-    template<> arma::mat json_serializer<arma::mat>::deserialize(const std::string& text)
+    template<> vote_matrix json_serializer<vote_matrix>::deserialize(const std::string& text)
     {
         Document doc;
         doc.Parse(text.c_str(), text.length());
@@ -178,13 +178,19 @@ namespace ethelo
         if (num_columns < 0)
             num_columns = 0;
 
-        arma::mat result(num_rows, num_columns);
+        // nulls are recorded in the bitmap as they are read, values keep the null_vote sentinel
+        vote_matrix result{arma::mat(num_rows, num_columns), null_bitmap(num_rows, num_columns)};
         for (SizeType i = 0; i < num_rows; i++) {
             for (SizeType j = 0; j < num_columns; j++) {
-                if (doc[i][j].IsNumber())
-                    result(i, j) = doc[i][j].GetDouble();
-                else if (doc[i][j].IsNull())
-                    result(i, j) = ethelo::null_vote;
+                if (doc[i][j].IsNumber()) {
+                    result.values(i, j) = doc[i][j].GetDouble();
+                    if (result.values(i, j) == ethelo::null_vote)
+                        result.nulls.set(i, j); // the sentinel older clients send for null
+                }
+                else if (doc[i][j].IsNull()) {
+                    result.values(i, j) = ethelo::null_vote;
+                    result.nulls.set(i, j);
+                }
                 else
                     throw parse_error("[" + std::to_string(i) + "][" + std::to_string(j) + "] is not a number or null.");
             }
@@ -192,6 +198,42 @@ namespace ethelo
         return result;
     }
 
+    template<> std::string json_serializer<arma::mat>::serialize(const arma::mat& matrix) {
+        throw std::runtime_error("not implemented");
+    }
+
+    template<> arma::mat json_serializer<arma::mat>::deserialize(const std::string& text)
+    {
+        return json_serializer<vote_matrix>().deserialize(text).values;
+    }
+
+    template<> std::string json_serializer<scenario_list>::serialize(const scenario_list& scenarios) {
+        throw std::runtime_error("not implemented");
+    }
+
+    template<> scenario_list json_serializer<scenario_list>::deserialize(const std::string& text)
+    {
+        Document doc;
+        doc.Parse(text.c_str(), text.length());
+        if (doc.HasParseError())
+            throw parse_error(GetParseError_En(doc.GetParseError()));
+        if (!doc.IsArray())
+            throw parse_error("Expected array.");
+
+        scenario_list result;
+        result.options.resize(doc.Size());
+        for (SizeType i = 0; i < doc.Size(); i++) {
+            if (!doc[i].IsArray())
+                throw parse_error("[" + std::to_string(i) + "] is not an array.");
+            for (SizeType j = 0; j < doc[i].Size(); j++) {
+                if (!doc[i][j].IsString())
+                    throw parse_error("[" + std::to_string(i) + "][" + std::to_string(j) + "] is not an option name.");
+                result.options[i].push_back(doc[i][j].GetString());
+            }
+        }
+        return result;
+    }
+
     static Value serialize_stats(Document& doc, const stats& statistics) {
         auto& alloc = doc.GetAllocator();
 
@@ -214,7 +256,74 @@ namespace ethelo
         return serialize_stats(doc, decision.statistics(x, global));
     }
 
-    static Document serialize_result(const result& res, solver_config solver_config) {
+    static Value serialize_metrics(Document& doc, const solver_metrics& metrics) {
+        auto& alloc = doc.GetAllocator();
+        Value value(kObjectType);
+        value.AddMember("solver", Value(metrics.solver.c_str(), alloc), alloc);
+        value.AddMember("seconds", metrics.seconds, alloc);
+        value.AddMember("nodes", static_cast<uint64_t>(metrics.nodes), alloc);
+        value.AddMember("iterations", static_cast<uint64_t>(metrics.iterations), alloc);
+        value.AddMember("cuts", static_cast<uint64_t>(metrics.cuts), alloc);
+        value.AddMember("nlp_solves", static_cast<uint64_t>(metrics.nlp_solves), alloc);
+
+        Value model(kObjectType);
+        model.AddMember("rows", static_cast<uint64_t>(metrics.rows), alloc);
+        model.AddMember("columns", static_cast<uint64_t>(metrics.columns), alloc);
+        model.AddMember("nonzeros", static_cast<uint64_t>(metrics.nonzeros), alloc);
+        model.AddMember("rlt_variables", static_cast<uint64_t>(metrics.rlt_variables), alloc);
+        value.AddMember("model", model, alloc);
+        return value;
+    }
+
+    // stats of each option, issue and (with several criteria) option and criterion
+    static void add_breakdown(Document& doc, Value& stats, decision& decision, const solver_config& solver_config) {
+        auto& alloc = doc.GetAllocator();
+
+        Value stats_options;
+        stats_options.SetObject();
+        for (size_t i = 0; i < decision.options().size(); i++) {
+            arma::vec x(decision.options().size(), arma::fill::zeros); x(i) = 1.0;
+            stats_options.AddMember(Value(decision.options()[i].name().c_str(), alloc),
+                serialize_stats(doc, decision, x, false), alloc);
+        }
+        stats.AddMember("options", stats_options, alloc);
+
+        Value stats_issues;
+        stats_issues.SetObject();
+        for (const auto& detail : solver_config.issues) {
+            arma::vec x(decision.options().size(), arma::fill::zeros);
+            const auto column = decision.details().find(detail);
+            for (size_t i = 0; i < decision.options().size(); i++)
+                if (std::abs(decision.details().value(column, decision.original_option_index(i))) > std::numeric_limits<double>::epsilon())
+                    x(i) = 1.0;
+
+            if (arma::sum(x) >= 1.0) {
+                stats_issues.AddMember(Value(detail.c_str(), alloc),
+                    serialize_stats(doc, decision, x, false), alloc);
+            }
+        }
+        stats.AddMember("issues", stats_issues, alloc);
+
+        if (decision.criteria().size() > 1) {
+            Value stats_criteria;
+            stats_criteria.SetObject();
+            size_t num_options = decision.options().size();
+            size_t num_criteria = decision.criteria().size();
+            for (size_t i = 0; i < num_options; i++) {
+                Value criteria;
+                criteria.SetObject();
+                for (size_t j = 0; j < num_criteria; j++) {
+                    arma::vec x(num_options * num_criteria, arma::fill::zeros); x(i * num_criteria + j) = 1.0;
+                    criteria.AddMember(Value(decision.criteria()[j].name().c_str(), alloc),
+                        serialize_stats(doc, decision, x, false), alloc);
+                }
+                stats_criteria.AddMember(Value(decision.options()[i].name().c_str(), alloc), criteria, alloc);
+            }
+            stats.AddMember("criteria", stats_criteria, alloc);
+        }
+    }
+
+    static Document serialize_result(const result& res, solver_config solver_config, bool breakdown) {
         Document doc; doc.SetObject();
         auto& alloc = doc.GetAllocator();
         auto& decision = res.get_decision();
@@ -233,6 +342,10 @@ namespace ethelo
         doc_config.AddMember("global", Value(global), alloc);
         doc.AddMember("config", doc_config, alloc);
 
+        // the global outcome is not solved for, so it has no solver effort
+        if (solver_config.metrics && !solution.metrics.solver.empty())
+            doc.AddMember("metrics", serialize_metrics(doc, solution.metrics), alloc);
+
         if (solution.success) {
             doc.AddMember("objective", Value(solution.fgh[0]), alloc);
 
@@ -268,47 +381,9 @@ namespace ethelo
             stats.SetObject();
             stats.AddMember("global", serialize_stats(doc, decision, solution.x, true), alloc);
 
-            Value stats_options;
-            stats_options.SetObject();
-            for (size_t i = 0; i < decision.options().size(); i++) {
-                arma::vec x(decision.options().size(), arma::fill::zeros); x(i) = 1.0;
-                stats_options.AddMember(Value(decision.options()[i].name().c_str(), alloc),
-                    serialize_stats(doc, decision, x, false), alloc);
-            }
-            stats.AddMember("options", stats_options, alloc);
-
-            Value stats_issues;
-            stats_issues.SetObject();
-            for (const auto& detail : solver_config.issues) {
-                arma::vec x(decision.options().size(), arma::fill::zeros);
-                for (size_t i = 0; i < decision.options().size(); i++)
-                    if (std::abs(decision.options()[i].get_detail(detail)) > std::numeric_limits<double>::epsilon())
-                        x(i) = 1.0;
-
-                if (arma::sum(x) >= 1.0) {
-                    stats_issues.AddMember(Value(detail.c_str(), alloc),
-                        serialize_stats(doc, decision, x, false), alloc);
-                }
-            }
-            stats.AddMember("issues", stats_issues, alloc);
-
-            if (decision.criteria().size() > 1) {
-                Value stats_criteria;
-                stats_criteria.SetObject();
-                size_t num_options = decision.options().size();
-                size_t num_criteria = decision.criteria().size();
-                for (size_t i = 0; i < num_options; i++) {
-                    Value criteria;
-                    criteria.SetObject();
-                    for (size_t j = 0; j < num_criteria; j++) {
-                        arma::vec x(num_options * num_criteria, arma::fill::zeros); x(i * num_criteria + j) = 1.0;
-                        criteria.AddMember(Value(decision.criteria()[j].name().c_str(), alloc),
-                            serialize_stats(doc, decision, x, false), alloc);
-                    }
-                    stats_criteria.AddMember(Value(decision.options()[i].name().c_str(), alloc), criteria, alloc);
-                }
-                stats.AddMember("criteria", stats_criteria, alloc);
-            }
+            // the breakdown does not depend on the scenario
+            if (global || breakdown)
+                add_breakdown(doc, stats, decision, solver_config);
 
             doc.AddMember("stats", stats, alloc);
         }
@@ -324,13 +399,71 @@ namespace ethelo
         throw std::runtime_error("not implemented");
     }
 
+    // the spans below `parent` as nested {name, seconds, children} objects
+    static Value serialize_timings(Document& doc, const std::vector<span_timer::record>& spans, ptrdiff_t parent) {
+        auto& alloc = doc.GetAllocator();
+        Value children(kArrayType);
+        for (size_t i = 0; i < spans.size(); i++) {
+            if (spans[i].parent != parent) continue;
+            Value span(kObjectType);
+            span.AddMember("name", Value(spans[i].name.c_str(), alloc), alloc);
+            span.AddMember("seconds", spans[i].seconds, alloc);
+            if (!spans[i].memory.empty()) {
+                Value memory(kObjectType);
+                for (const auto& figure : spans[i].memory)
+                    memory.AddMember(Value(figure.first.c_str(), alloc), figure.second, alloc);
+                span.AddMember("memory", memory, alloc);
+            }
+            span.AddMember("children", serialize_timings(doc, spans, static_cast<ptrdiff_t>(i)), alloc);
+            children.PushBack(span, alloc);
+        }
+        return children;
+    }
+
     template<> std::string json_serializer<result_set>::serialize(const result_set& res_set) {
         Document doc; doc.SetArray();
         auto& alloc = doc.GetAllocator();
 
-        for (const auto& res : res_set.results) {
-            res.activate_config();
-            doc.PushBack(Value(serialize_result(res, res_set.config), alloc), alloc);
+        {
+            span serialize("serialize");
+            for (const auto& res : res_set.results) {
+                span stats("stats");
+                res.activate_config();
+                doc.PushBack(Value(serialize_result(res, res_set.config, res_set.scenario_breakdown), alloc), alloc);
+            }
+        }
+
+        // node counts are process-wide, so they include concurrent requests
+        if (res_set.config.memory && !doc.Empty()) {
+            node_census::counts census = node_census::snapshot();
+            Value nodes(kObjectType);
+            for (size_t t = 0; t < node_census::num_types; t++) {
+                Value counts(kObjectType);
+                counts.AddMember("live", census.live[t], alloc);
+                counts.AddMember("peak", census.peak[t], alloc);
+                nodes.AddMember(StringRef(node_census::type_names[t]), counts, alloc);
+            }
+
+            Value coefficients(kObjectType);
+            coefficients.AddMember("live", census.coef_bytes, alloc);
+            coefficients.AddMember("peak", census.peak_coef_bytes, alloc);
+
+            Value memory(kObjectType);
+            memory.AddMember("nodes", nodes, alloc);
+            memory.AddMember("linexp_coef_bytes", coefficients, alloc);
+            memory.AddMember("matrix_bytes", static_cast<uint64_t>(res_set.results[0].get_decision().matrix_bytes()), alloc);
+            memory.AddMember("peak_rss_bytes", static_cast<uint64_t>(process_memory::read().peak_rss_bytes), alloc);
+            doc[0].AddMember("memory", memory, alloc);
+        }
+
+        // taken after the serialize span closes, so it is complete; open
+        // spans (the request itself) report their time so far
+        if (res_set.timings && !doc.Empty()) {
+            Value timings = serialize_timings(doc, res_set.timings->records(), -1);
+            if (timings.Size() == 1)
+                doc[0].AddMember("timings", Value(timings[0], alloc), alloc);
+            else
+                doc[0].AddMember("timings", timings, alloc);
         }
 
         StringBuffer buffer; buffer.Clear();
@@ -429,6 +562,30 @@ namespace ethelo
             config.solution_limit = doc["solution_limit"].GetInt();
         }
 
+        if (doc.HasMember("enumeration_limit")) {
+            if (!doc["enumeration_limit"].IsInt() || doc["enumeration_limit"].GetInt() < 0)
+                throw parse_error("Expected enumeration_limit to be a non-negative integer.");
+            config.enumeration_limit = doc["enumeration_limit"].GetInt();
+        }
+
+        if (doc.HasMember("timings")) {
+            if (!doc["timings"].IsBool())
+                throw parse_error("Expected timings to be boolean.");
+            config.timings = doc["timings"].GetBool();
+        }
+
+        if (doc.HasMember("metrics")) {
+            if (!doc["metrics"].IsBool())
+                throw parse_error("Expected metrics to be boolean.");
+            config.metrics = doc["metrics"].GetBool();
+        }
+
+        if (doc.HasMember("memory")) {
+            if (!doc["memory"].IsBool())
+                throw parse_error("Expected memory to be boolean.");
+            config.memory = doc["memory"].GetBool();
+        }
+
         return config;
     }
 }
@@ -1,12 +1,69 @@
 #include "file_solver.hpp"
 
+#ifdef ETHELO_PROFILING
+#include "profiler.hpp"
+#include <fstream>
+#endif
+
+/*
+    runner DIR [--trace out.json] [--perf-counters]
+
+    --trace writes the spans of every thread as a Chrome trace, and
+    --perf-counters adds hardware counters to them. Both need an engine
+    configured with -DENGINE_PROFILING=ON.
+*/
+
 int main(int argc, char *argv[]) {
-  if(argc != 2) {
-    std::cerr << "Please provide the path to the JSON files\n";
+  std::string dir, trace_path;
+  bool perf_counters = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--trace" && i + 1 < argc) trace_path = argv[++i];
+    else if (arg == "--perf-counters") perf_counters = true;
+    else if (dir.empty() && arg.compare(0, 2, "--") != 0) dir = arg;
+    else { dir.clear(); break; }
+  }
+
+  if (dir.empty()) {
+    std::cerr << "Please provide the path to the JSON files\n"
+              << "usage: runner DIR [--trace out.json] [--perf-counters]\n";
+    return 1;
+  }
+  if (perf_counters && trace_path.empty()) {
+    std::cerr << "--perf-counters needs --trace\n";
     return 1;
   }
 
-  std::string result = ethelo::solve_from_json_dir(std::string(argv[1]));
+#ifdef ETHELO_PROFILING
+  ethelo::span_timer timer;
+  if (!trace_path.empty()) {
+    try { ethelo::profiler::start(timer, perf_counters); }
+    catch (const std::exception& ex) {
+      std::cerr << ex.what() << std::endl;
+      return 1;
+    }
+  }
+#else
+  if (!trace_path.empty()) {
+    std::cerr << "runner was built without profiling, configure with -DENGINE_PROFILING=ON\n";
+    return 1;
+  }
+#endif
+
+  std::string result = ethelo::solve_from_json_dir(dir);
   std::cout << result;
+
+#ifdef ETHELO_PROFILING
+  if (!trace_path.empty()) {
+    ethelo::profiler::stop();
+    std::ofstream trace(trace_path);
+    ethelo::profiler::write_trace(timer, trace);
+    if (!trace) {
+      std::cerr << "cannot write " << trace_path << std::endl;
+      return 1;
+    }
+  }
+#endif
   return 0;
 }
@@ -6,8 +6,10 @@ namespace ethelo
     void serializer_base::init() {
         json_serializer<decision>::bind();
         json_serializer<arma::mat>::bind();
+        json_serializer<vote_matrix>::bind();
         json_serializer<result>::bind();
         json_serializer<result_set>::bind();
         json_serializer<solver_config>::bind();
+        json_serializer<scenario_list>::bind();
     }
 }
@@ -10,7 +10,8 @@ namespace ethelo
                       double collective_identity = 0.0,
                       double tipping_point = 1.0/3.0,
                       size_t histogram_bins = 5,
-                      size_t solution_limit = 10)
+                      size_t solution_limit = 10,
+                      size_t enumeration_limit = 18)
             : single_outcome(single_outcome),
               support_only(support_only),
               normalize_satisfaction(normalize_satisfaction),
@@ -18,7 +19,11 @@ namespace ethelo
               collective_identity(collective_identity),
               tipping_point(tipping_point),
               histogram_bins(histogram_bins),
-              solution_limit(solution_limit)
+              solution_limit(solution_limit),
+              enumeration_limit(enumeration_limit),
+              timings(false),
+              metrics(false),
+              memory(false)
         {};
 
         bool single_outcome;
@@ -30,6 +35,10 @@ namespace ethelo
         double tipping_point;
         size_t histogram_bins;
         size_t solution_limit;
+        size_t enumeration_limit;   // most free options solved by enumeration instead of CBC/Bonmin
+        bool timings;       // add the stage timings of the request to the global result
+        bool metrics;       // add the solver effort to each scenario result
+        bool memory;        // add memory figures to the timings, and a memory summary
         std::set<std::string> issues;
     };
 
@@ -63,5 +72,12 @@ namespace ethelo
     struct result_set {
         solver_config config;
         std::vector<result> results;
+        const span_timer* timings = nullptr;    // serialized with the first result when set
+        bool scenario_breakdown = true;         // per option, issue and criterion stats in non-global results
+    };
+
+    // candidate scenarios for interface::evaluate, each a list of option names
+    struct scenario_list {
+        std::vector<std::vector<std::string>> options;
     };
 }
@@ -0,0 +1,251 @@
+#include "synthetic.hpp"
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace rapidjson;
+
+namespace ethelo
+{
+    // splitmix64: the same stream on every platform, unlike the std distributions
+    class synthetic_rng {
+        uint64_t state_;
+
+    public:
+        synthetic_rng(uint64_t seed) : state_(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        // uniform in [0, 1)
+        double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+        double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+    };
+
+    static std::string group_name(size_t k) { return "g" + std::to_string(k); }
+
+    static void write_detail(Writer<StringBuffer>& writer, const std::string& name, double value) {
+        writer.StartObject();
+        writer.Key("name"); writer.String(name.c_str());
+        writer.Key("value"); writer.Double(value);
+        writer.EndObject();
+    }
+
+    static void write_expression(Writer<StringBuffer>& writer, const std::string& name, const std::string& code) {
+        writer.StartObject();
+        writer.Key("name"); writer.String(name.c_str());
+        writer.Key("code"); writer.String(code.c_str());
+        writer.EndObject();
+    }
+
+    static std::string number(double value) {
+        std::ostringstream oss;
+        oss.precision(17);
+        oss << value;
+        return oss.str();
+    }
+
+    synthetic_decision generate_decision(const synthetic_spec& spec)
+    {
+        if (spec.options == 0)
+            throw std::invalid_argument("a synthetic decision needs at least one option");
+        if (spec.null_density < 0.0 || spec.null_density > 1.0)
+            throw std::invalid_argument("null density must be in [0, 1]");
+
+        synthetic_rng rng(spec.seed);
+        const size_t options = spec.options;
+        const size_t groups = std::min(spec.groups, options);
+        const size_t criteria = std::max<size_t>(spec.criteria, 1);
+
+        // detail 0 is the cost, details 1.. are d0, d1, ...
+        std::vector<std::string> names{"cost"};
+        for (size_t k = 0; k < spec.details; k++)
+            names.push_back("d" + std::to_string(k));
+        const size_t num_details = names.size();
+
+        std::vector<std::vector<double>> values(num_details, std::vector<double>(options));
+        std::vector<double> total(num_details, 0.0), popularity(options);
+        for (size_t i = 0; i < options; i++) {
+            values[0][i] = 1000.0 * std::round(rng.uniform(10.0, 100.0));
+            popularity[i] = rng.uniform(-1.0, 1.0);
+            for (size_t k = 1; k < num_details; k++)
+                values[k][i] = std::round(rng.uniform(0.0, 100.0)) / 10.0;
+            for (size_t k = 0; k < num_details; k++)
+                total[k] += values[k][i];
+        }
+
+        // the budget affords an average option of every group, so XORs stay feasible
+        double budget = 0.0;
+        if (groups > 0) {
+            std::vector<double> group_total(groups, 0.0), group_count(groups, 0.0);
+            for (size_t i = 0; i < options; i++) {
+                group_total[i % groups] += values[0][i];
+                group_count[i % groups] += 1.0;
+            }
+            for (size_t k = 0; k < groups; k++)
+                budget += group_total[k] / group_count[k];
+        } else {
+            budget = 0.4 * total[0];
+        }
+
+        synthetic_decision out;
+
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        writer.StartObject();
+
+        writer.Key("options");
+        writer.StartArray();
+        for (size_t i = 0; i < options; i++) {
+            writer.StartObject();
+            writer.Key("name"); writer.String(("option-" + std::to_string(i)).c_str());
+            writer.Key("details");
+            writer.StartArray();
+            for (size_t k = 0; k < num_details; k++)
+                write_detail(writer, "D" + names[k], values[k][i]);
+            write_detail(writer, "Gall_options", 1.0);
+            for (size_t k = 0; k < groups; k++)
+                write_detail(writer, "G" + group_name(k), i % groups == k ? 1.0 : 0.0);
+            writer.EndArray();
+            writer.EndObject();
+        }
+        writer.EndArray();
+
+        writer.Key("criteria");
+        writer.StartArray();
+        for (size_t j = 0; j < criteria; j++)
+            writer.String(("criterion-" + std::to_string(j)).c_str());
+        writer.EndArray();
+
+        writer.Key("fragments");
+        writer.StartArray();
+        for (size_t k = 0; k < num_details; k++)
+            write_expression(writer, names[k] + "_selected_sum", "$D" + names[k]);
+        write_expression(writer, "all_selected_count", "$Gall_options");
+        for (size_t k = 0; k < groups; k++)
+            write_expression(writer, group_name(k) + "_selected_count", "$G" + group_name(k));
+        writer.EndArray();
+
+        writer.Key("constraints");
+        writer.StartArray();
+        if (spec.budget)
+            write_expression(writer, "budget", "[@cost_selected_sum] <= " + number(budget));
+        for (size_t k = 0; k < groups; k++)
+            write_expression(writer, "xor-" + group_name(k), "[@" + group_name(k) + "_selected_count] = 1.0");
+        for (size_t r = 0; r < spec.ratios; r++) {
+            const std::string& d = names[r % num_details];
+            write_expression(writer, "ratio-" + std::to_string(r),
+                             "[@" + d + "_selected_sum / @all_selected_count] <= " + number(1.25 * total[r % num_details] / options));
+        }
+        for (size_t r = 0; r < spec.abs_constraints; r++) {
+            const std::string& a = names[r % num_details];
+            const std::string& b = names[(r + 1) % num_details];
+            write_expression(writer, "abs-" + std::to_string(r),
+                             "[abs(@" + a + "_selected_sum - @" + b + "_selected_sum)] <= " +
+                             number(0.25 * (total[r % num_details] + total[(r + 1) % num_details])));
+        }
+        for (size_t r = 0; r < spec.sqrt_constraints; r++) {
+            const std::string& d = names[r % num_details];
+            write_expression(writer, "sqrt-" + std::to_string(r),
+                             "[sqrt(@" + d + "_selected_sum)] <= " + number(std::sqrt(0.5 * total[r % num_details])));
+        }
+        writer.EndArray();
+
+        writer.Key("displays");
+        writer.StartArray();
+        write_expression(writer, "total_cost", "@cost_selected_sum");
+        writer.EndArray();
+
+        writer.EndObject();
+        out.decision_json = buffer.GetString();
+
+        // votes on a scale of halves around the popularity of each option
+        buffer.Clear();
+        Writer<StringBuffer> votes(buffer);
+        votes.StartArray();
+        for (size_t v = 0; v < spec.voters; v++) {
+            votes.StartArray();
+            for (size_t i = 0; i < options; i++) {
+                for (size_t j = 0; j < criteria; j++) {
+                    if (spec.null_density > 0.0 && rng.uniform() < spec.null_density) {
+                        votes.Null();
+                        continue;
+                    }
+                    double vote = std::round(2.0 * (popularity[i] + rng.uniform(-1.0, 1.0))) / 2.0;
+                    votes.Double(std::max(-1.0, std::min(1.0, vote)));
+                }
+            }
+            votes.EndArray();
+        }
+        votes.EndArray();
+        out.influents_json = buffer.GetString();
+
+        buffer.Clear();
+        Writer<StringBuffer> weights(buffer);
+        weights.StartArray();
+        if (spec.weights != synthetic_spec::weight_pattern::none) {
+            for (size_t v = 0; v < spec.voters; v++) {
+                size_t favourite = static_cast<size_t>(rng.uniform() * criteria);
+                weights.StartArray();
+                for (size_t i = 0; i < options; i++) {
+                    for (size_t j = 0; j < criteria; j++) {
+                        switch (spec.weights) {
+                            case synthetic_spec::weight_pattern::uniform: weights.Double(1.0); break;
+                            case synthetic_spec::weight_pattern::random: weights.Double(std::round(rng.uniform() * 100.0) / 100.0); break;
+                            default: weights.Double(j == favourite ? 1.0 : 0.1); break;
+                        }
+                    }
+                }
+                weights.EndArray();
+            }
+        }
+        weights.EndArray();
+        out.weights_json = buffer.GetString();
+
+        buffer.Clear();
+        Writer<StringBuffer> config(buffer);
+        config.StartObject();
+        config.Key("collective_identity"); config.Double(0.5);
+        config.Key("tipping_point"); config.Double(0.33333);
+        config.Key("support_only"); config.Bool(false);
+        config.Key("solution_limit"); config.Uint(1);
+        config.Key("single_outcome"); config.Bool(false);
+        config.Key("per_option_satisfaction"); config.Bool(false);
+        config.Key("normalize_satisfaction"); config.Bool(true);
+        config.Key("normalize_influents"); config.Bool(false);
+        config.Key("histogram_bins"); config.Uint(5);
+        config.EndObject();
+        out.config_json = buffer.GetString();
+
+        return out;
+    }
+
+    void write_decision(const synthetic_decision& generated, const std::string& dir)
+    {
+        const std::pair<const char*, const std::string*> files[] = {
+            {"decision.json", &generated.decision_json},
+            {"influents.json", &generated.influents_json},
+            {"weights.json", &generated.weights_json},
+            {"config.json", &generated.config_json}};
+
+        for (const auto& file : files) {
+            std::ofstream out(dir + "/" + file.first);
+            if (!(out << *file.second))
+                throw std::runtime_error("cannot write " + dir + "/" + file.first);
+        }
+    }
+
+    std::string spec_name(const synthetic_spec& spec)
+    {
+        return "synthetic-o" + std::to_string(spec.options) + "-c" + std::to_string(spec.criteria) +
+               "-v" + std::to_string(spec.voters) + "-s" + std::to_string(spec.seed);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "api.hpp"
+
+#include <cstdint>
+
+namespace ethelo
+{
+    /*
+        Parameters of a generated decision. Options carry a cost detail and
+        `details` more numeric details (d0, d1, ...), and are split into
+        groups with one XOR constraint (exactly one option) each. On top of
+        those the decision can have
+          - a budget on the total cost,
+          - ratio constraints bounding the mean detail of the selection (DivNode),
+          - abs constraints bounding the spread of two detail totals,
+          - sqrt constraints bounding the square root of a detail total.
+        Votes fall on a scale of halves around a popularity per option; each
+        is null with probability null_density. The same spec always generates
+        the same files.
+    */
+    struct synthetic_spec {
+        enum class weight_pattern {
+            none,       // weights.json is empty, i.e. default weights
+            uniform,    // all ones
+            random,     // uniform in [0, 1]
+            skewed      // every voter weighs one criterion fully and the others at 0.1
+        };
+
+        size_t options = 20;
+        size_t criteria = 1;
+        size_t details = 0;
+        size_t voters = 100;
+        size_t groups = 4;
+        bool budget = true;
+        size_t ratios = 0;
+        size_t abs_constraints = 0;
+        size_t sqrt_constraints = 0;
+        double null_density = 0.0;
+        weight_pattern weights = weight_pattern::none;
+        uint64_t seed = 1;
+    };
+
+    // the inputs of interface::solve, as read by solve_from_json_dir
+    struct synthetic_decision {
+        std::string decision_json;
+        std::string influents_json;
+        std::string weights_json;
+        std::string config_json;
+    };
+
+    synthetic_decision generate_decision(const synthetic_spec& spec);
+
+    // writes the four files of a generated decision into an existing directory
+    void write_decision(const synthetic_decision& generated, const std::string& dir);
+
+    // short name of a spec, e.g. "synthetic-o20-c1-v100-s1"
+    std::string spec_name(const synthetic_spec& spec);
+}
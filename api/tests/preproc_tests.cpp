@@ -3,17 +3,22 @@
 #include "../../engine/ethelo.hpp"
 #include "../../engine/mathModelling.hpp"
 #include "../file_solver.hpp"
+#ifdef ETHELO_PROFILING
+#include "../../engine/profiler.hpp"
+#endif
 #include <catch2/catch.hpp>
 #include <iterator>
 #include <sstream>
 #include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
 using namespace ethelo;
 
 
 class testing_interface: public interface{
 	public:
-	static MathProgram* preproc_MP(decision& dec){
+	static std::unique_ptr<MathProgram> preproc_MP(decision& dec){
 		return interface::preproc_MP(dec);
 	}
 };
@@ -43,14 +48,14 @@ inline void check_fixture(std::string fixture_name) {
 	decision dec = deserialize<decision>("json", "decision", decision_json);
 
 	// MP when without preproc
-	MathProgram* MP0 = testing_interface::preproc_MP(dec);
+	std::unique_ptr<MathProgram> MP0 = testing_interface::preproc_MP(dec);
 
 	// create MP using preproc data
 	const std::string preproc_data = testing_interface::preproc(decision_json);
 	const std::string dec_hashed = testing_interface::hash(decision_json);
 	const std::string ver = testing_interface::version();
 	std::istringstream iss(preproc_data);
-	MathProgram* MP1 = MathProgram::loadFromStream(iss, dec, dec_hashed, ver);
+	std::unique_ptr<MathProgram> MP1 = MathProgram::loadFromStream(iss, dec, dec_hashed, ver);
 
 	// check if MP0,MP1 are the same
 	// number of variable
@@ -97,9 +102,6 @@ inline void check_fixture(std::string fixture_name) {
 	
 	// final check
 	REQUIRE_NOTHROW(MP0->assert_similar(*MP1));
-
-	delete MP0;
-	delete MP1;
 }
 
 
@@ -129,3 +131,436 @@ TEST_CASE("carbon budget test decision", "[integration]") {
 TEST_CASE("criteria voting decision", "[integration]") {
     check_fixture("granting_process");
 };
+
+inline std::string fixture_dir(std::string fixture_name) {
+	std::string base_path = __FILE__;
+	base_path.erase(base_path.find_last_of("/")+1);
+	return base_path + "fixtures/" + fixture_name;
+}
+
+inline size_t count_expressions(const std::string& decision_json) {
+	rapidjson::Document d;
+	d.Parse(decision_json.c_str());
+
+	size_t count = 0;
+	for (auto key : {"fragments", "constraints", "displays"}) {
+		if (d.HasMember(key) && d[key].IsArray()) count += d[key].Size();
+	}
+	return count;
+}
+
+TEST_CASE("each expression is parsed at most once per solve", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "tax_assessment_personal_partial_vote", "carbon_budget"}) {
+		const std::string dir = fixture_dir(fixture_name);
+		const std::string decision_json = file2str(dir + "/decision.json");
+		const std::string influents_json = file2str(dir + "/influents.json");
+		const std::string weights_json = file2str(dir + "/weights.json");
+		const std::string config_json = file2str(dir + "/config.json");
+
+		uint64_t before = expression::parse_count();
+		interface::solve(decision_json, influents_json, weights_json, config_json);
+		REQUIRE(expression::parse_count() - before == count_expressions(decision_json));
+
+		// a matching preproc means the parser is never needed
+		const std::string preproc_data = interface::preproc(decision_json);
+		before = expression::parse_count();
+		interface::solve(decision_json, influents_json, weights_json, config_json, preproc_data);
+		REQUIRE(expression::parse_count() == before);
+	}
+};
+
+TEST_CASE("preproc output does not depend on the number of threads", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "tax_assessment_personal_partial_vote", "carbon_budget", "granting_process"}) {
+		const std::string decision_json = file2str(fixture_dir(fixture_name) + "/decision.json");
+
+		thread_pool::configure(1);
+		const std::string sequential = interface::preproc(decision_json);
+
+		thread_pool::configure(4);
+		for (int run = 0; run < 3; run++) {
+			REQUIRE(interface::preproc(decision_json) == sequential);
+		}
+	}
+	thread_pool::configure(std::thread::hardware_concurrency());
+};
+
+// the config of a fixture with one boolean flag set
+inline std::string with_flag(const std::string& config_json, const char* flag, bool value) {
+	rapidjson::Document d;
+	d.Parse(config_json.c_str());
+	d.RemoveMember(flag);
+	d.AddMember(rapidjson::StringRef(flag), value, d.GetAllocator());
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	d.Accept(writer);
+	return buffer.GetString();
+}
+
+inline bool has_child(const rapidjson::Value& span, const char* name) {
+	const auto& children = span["children"];
+	for (rapidjson::SizeType i = 0; i < children.Size(); i++) {
+		if (std::string(children[i]["name"].GetString()) == name) return true;
+	}
+	return false;
+}
+
+TEST_CASE("stage timings are added to the global result on request", "[integration]") {
+	const std::string dir = fixture_dir("budget_decision_partial_vote_with_xors");
+	const std::string decision_json = file2str(dir + "/decision.json");
+	const std::string influents_json = file2str(dir + "/influents.json");
+	const std::string weights_json = file2str(dir + "/weights.json");
+	const std::string config_json = file2str(dir + "/config.json");
+
+	rapidjson::Document d;
+	d.Parse(interface::solve(decision_json, influents_json, weights_json, with_flag(config_json, "timings", true)).c_str());
+	REQUIRE(d[0].HasMember("timings"));
+
+	const auto& timings = d[0]["timings"];
+	REQUIRE(std::string(timings["name"].GetString()) == "solve");
+	REQUIRE(timings["seconds"].GetDouble() >= 0.0);
+	for (auto stage : {"parse", "preproc", "load_votes", "configure", "global_outcome", "serialize"}) {
+		REQUIRE(has_child(timings, stage));
+	}
+	for (size_t i = 1; i < d.Size(); i++) {
+		REQUIRE_FALSE(d[i].HasMember("timings"));
+	}
+
+	d.Parse(interface::solve(decision_json, influents_json, weights_json, with_flag(config_json, "timings", false)).c_str());
+	REQUIRE_FALSE(d[0].HasMember("timings"));
+};
+
+inline const rapidjson::Value& child(const rapidjson::Value& span, const char* name) {
+	const auto& children = span["children"];
+	for (rapidjson::SizeType i = 0; i < children.Size(); i++) {
+		if (std::string(children[i]["name"].GetString()) == name) return children[i];
+	}
+	FAIL("no span " << name);
+	return span;
+}
+
+TEST_CASE("memory figures are added to the timings on request", "[integration]") {
+	const std::string dir = fixture_dir("budget_decision_partial_vote_with_xors");
+	const std::string decision_json = file2str(dir + "/decision.json");
+	const std::string influents_json = file2str(dir + "/influents.json");
+	const std::string weights_json = file2str(dir + "/weights.json");
+	const std::string config_json = file2str(dir + "/config.json");
+
+	rapidjson::Document d;
+	d.Parse(interface::solve(decision_json, influents_json, weights_json, with_flag(config_json, "memory", true)).c_str());
+	REQUIRE(d[0].HasMember("memory"));
+	REQUIRE(d[0].HasMember("timings"));
+
+	// preproc translates the constraints into LinExp leaves while the census is on
+	const auto& memory = d[0]["memory"];
+	REQUIRE(memory["nodes"]["LinExp"]["peak"].GetInt64() > 0);
+	REQUIRE(memory["linexp_coef_bytes"]["peak"].GetInt64() > 0);
+	REQUIRE(memory["matrix_bytes"].GetUint64() > 0);
+	REQUIRE(memory["peak_rss_bytes"].GetUint64() > 0);
+
+	const auto& preproc = child(d[0]["timings"], "preproc");
+	REQUIRE(preproc["memory"]["var_mask_depth"].GetDouble() >= 1.0);
+	REQUIRE(preproc["memory"]["rss_bytes"].GetDouble() > 0.0);
+	REQUIRE(child(d[0]["timings"], "load_votes")["memory"]["matrix_bytes"].GetDouble() > 0.0);
+
+	// without the flag the spans carry no memory figures
+	d.Parse(interface::solve(decision_json, influents_json, weights_json, with_flag(config_json, "timings", true)).c_str());
+	REQUIRE_FALSE(d[0].HasMember("memory"));
+	REQUIRE_FALSE(child(d[0]["timings"], "preproc").HasMember("memory"));
+};
+
+TEST_CASE("solver metrics are added to each scenario on request", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "carbon_budget"}) {
+		const std::string dir = fixture_dir(fixture_name);
+		const std::string decision_json = file2str(dir + "/decision.json");
+		const std::string influents_json = file2str(dir + "/influents.json");
+		const std::string weights_json = file2str(dir + "/weights.json");
+		const std::string config_json = file2str(dir + "/config.json");
+
+		rapidjson::Document d;
+		d.Parse(interface::solve(decision_json, influents_json, weights_json, with_flag(config_json, "metrics", true)).c_str());
+		REQUIRE(d.Size() > 1);
+		REQUIRE_FALSE(d[0].HasMember("metrics"));
+		for (rapidjson::SizeType i = 1; i < d.Size(); i++) {
+			REQUIRE(d[i].HasMember("metrics"));
+			const auto& metrics = d[i]["metrics"];
+			const std::string solver = metrics["solver"].GetString();
+			REQUIRE((solver == "cbc" || solver == "bonmin" || solver == "enumeration"));
+			REQUIRE(metrics["seconds"].GetDouble() >= 0.0);
+			REQUIRE(metrics["model"]["columns"].GetUint64() > 0);
+			REQUIRE(metrics["model"]["columns"].GetUint64() >= metrics["model"]["rlt_variables"].GetUint64());
+		}
+
+		d.Parse(interface::solve(decision_json, influents_json, weights_json, config_json).c_str());
+		for (rapidjson::SizeType i = 0; i < d.Size(); i++) {
+			REQUIRE_FALSE(d[i].HasMember("metrics"));
+		}
+	}
+};
+
+#ifdef ETHELO_PROFILING
+TEST_CASE("the profiler records translation on every thread", "[integration]") {
+	const std::string decision_json = file2str(fixture_dir("budget_decision_partial_vote_with_xors") + "/decision.json");
+
+	thread_pool::configure(4);
+	span_timer timer;
+	profiler::start(timer, false);
+	interface::preproc(decision_json);
+	profiler::stop();
+	thread_pool::configure(std::thread::hardware_concurrency());
+
+	size_t translated = 0;
+	for (const auto& rec : timer.records()) {
+		REQUIRE_FALSE(rec.open);
+		if (rec.name == "translate_constraint") translated++;
+	}
+	REQUIRE(translated > 0);
+
+	std::ostringstream trace;
+	profiler::write_trace(timer, trace);
+	rapidjson::Document d;
+	d.Parse(trace.str().c_str());
+	REQUIRE_FALSE(d.HasParseError());
+	REQUIRE(d["traceEvents"].Size() == timer.records().size());
+};
+#endif
+
+// an admin-style edit: reword the first constraint, change one detail value and drop the last display
+inline std::string edit_decision(const std::string& decision_json) {
+	rapidjson::Document d;
+	d.Parse(decision_json.c_str());
+
+	auto& constraints = d["constraints"];
+	if (constraints.Size() > 0) {
+		std::string code = std::string(constraints[0]["code"].GetString()) + " ";
+		constraints[0]["code"].SetString(code.c_str(), code.size(), d.GetAllocator());
+	}
+	auto& details = d["options"][0]["details"];
+	if (details.Size() > 0) {
+		details[0]["value"].SetDouble(details[0]["value"].GetDouble() + 1.0);
+	}
+	if (d.HasMember("displays") && d["displays"].Size() > 0) {
+		d["displays"].PopBack();
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	d.Accept(writer);
+	return buffer.GetString();
+}
+
+TEST_CASE("incremental preproc matches a full preproc", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "tax_assessment_personal_partial_vote", "carbon_budget", "granting_process"}) {
+		const std::string decision_json = file2str(fixture_dir(fixture_name) + "/decision.json");
+		const std::string edited_json = edit_decision(decision_json);
+		const std::string old_data = interface::preproc(decision_json);
+
+		SECTION(std::string("unchanged decision: ") + fixture_name) {
+			REQUIRE(interface::preproc_update(old_data, decision_json) == old_data);
+		}
+
+		SECTION(std::string("edited decision: ") + fixture_name) {
+			REQUIRE(interface::preproc_update(old_data, edited_json) == interface::preproc(edited_json));
+		}
+
+		SECTION(std::string("artifact without hashes: ") + fixture_name) {
+			const std::string stripped = old_data.substr(0, old_data.find("hashes\n"));
+			REQUIRE(interface::preproc_update(stripped, edited_json) == interface::preproc(edited_json));
+		}
+	}
+};
+
+inline std::vector<arma::vec> random_points(size_t n_var, size_t count) {
+	arma::arma_rng::set_seed(42);
+	std::vector<arma::vec> points;
+	for (size_t k = 0; k < count; k++) {
+		points.push_back(arma::round(arma::randu<arma::vec>(n_var)));
+	}
+	return points;
+}
+
+TEST_CASE("expression tapes evaluate like the expression trees", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "tax_assessment_personal_partial_vote", "carbon_budget", "granting_process"}) {
+		decision dec = deserialize<decision>("json", "decision", file2str(fixture_dir(fixture_name) + "/decision.json"));
+		std::unique_ptr<MathProgram> MP = testing_interface::preproc_MP(dec);
+
+		const auto& consList = MP->getConsList();
+		const auto& displayList = MP->getDisplayList();
+		for (const auto& x : random_points(MP->n_var(), 20)) {
+			std::vector<double> cons = MP->getConsTape()->evaluate(arma::conv_to<std::vector<double>>::from(x));
+			std::vector<double> disp = MP->getDisplayTape()->evaluate(arma::conv_to<std::vector<double>>::from(x));
+
+			REQUIRE(cons.size() == consList.size());
+			for (size_t i = 0; i < cons.size(); i++) {
+				REQUIRE(cons[i] == Approx(consList[i].expr->evaluate(x)).margin(1e-9));
+			}
+			REQUIRE(disp.size() == displayList.size());
+			for (size_t i = 0; i < disp.size(); i++) {
+				REQUIRE(disp[i] == Approx(displayList[i]->evaluate(x)).margin(1e-9));
+			}
+		}
+	}
+};
+
+TEST_CASE("batched tape evaluation matches point by point evaluation", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "carbon_budget", "granting_process"}) {
+		decision dec = deserialize<decision>("json", "decision", file2str(fixture_dir(fixture_name) + "/decision.json"));
+		std::unique_ptr<MathProgram> MP = testing_interface::preproc_MP(dec);
+		std::shared_ptr<const ExprTape> tape = MP->getConsTape();
+
+		const auto points = random_points(MP->n_var(), 13);
+		const size_t m = points.size();
+		std::vector<double> x(MP->n_var() * m), out(tape->n_outputs() * m), stack(tape->stack_size() * m);
+		for (size_t p = 0; p < m; p++) {
+			for (size_t v = 0; v < MP->n_var(); v++) x[v * m + p] = points[p][v];
+		}
+		tape->evaluate_batch(x.data(), m, out.data(), stack.data());
+
+		std::vector<double> single(tape->n_outputs()), single_stack(tape->stack_size());
+		for (size_t p = 0; p < m; p++) {
+			tape->evaluate(points[p].memptr(), single.data(), single_stack.data());
+			for (size_t i = 0; i < single.size(); i++) {
+				REQUIRE(out[i * m + p] == single[i]);
+			}
+		}
+	}
+};
+
+// the option sets of the scenario results of solve, as scenarios_json
+inline std::string solved_scenarios(const rapidjson::Document& d) {
+	rapidjson::Document scenarios;
+	scenarios.SetArray();
+	for (rapidjson::SizeType i = 1; i < d.Size(); i++) {
+		if (std::string(d[i]["status"].GetString()) != "success") continue;
+		rapidjson::Value options(d[i]["options"], scenarios.GetAllocator());
+		scenarios.PushBack(options, scenarios.GetAllocator());
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	scenarios.Accept(writer);
+	return buffer.GetString();
+}
+
+inline void require_same_values(const rapidjson::Value& expected, const rapidjson::Value& actual) {
+	REQUIRE(expected.Size() == actual.Size());
+	for (rapidjson::SizeType k = 0; k < expected.Size(); k++) {
+		REQUIRE(std::string(expected[k]["name"].GetString()) == actual[k]["name"].GetString());
+		REQUIRE(actual[k]["value"].GetDouble() == Approx(expected[k]["value"].GetDouble()).margin(1e-9));
+	}
+}
+
+TEST_CASE("evaluate scores the scenarios found by solve like solve", "[integration]") {
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "carbon_budget"}) {
+		const std::string dir = fixture_dir(fixture_name);
+		const std::string decision_json = file2str(dir + "/decision.json");
+		const std::string influents_json = file2str(dir + "/influents.json");
+		const std::string weights_json = file2str(dir + "/weights.json");
+		const std::string config_json = file2str(dir + "/config.json");
+
+		rapidjson::Document solved;
+		solved.Parse(interface::solve(decision_json, influents_json, weights_json, config_json).c_str());
+		const std::string scenarios_json = solved_scenarios(solved);
+
+		rapidjson::Document evaluated;
+		evaluated.Parse(interface::evaluate(decision_json, influents_json, weights_json, config_json, "", scenarios_json).c_str());
+		REQUIRE(evaluated[0]["config"]["global"].GetBool());
+		REQUIRE(evaluated[0]["stats"].HasMember("options"));
+
+		rapidjson::SizeType j = 1;
+		for (rapidjson::SizeType i = 1; i < solved.Size(); i++) {
+			if (std::string(solved[i]["status"].GetString()) != "success") continue;
+			REQUIRE(j < evaluated.Size());
+			const auto& expected = solved[i];
+			const auto& actual = evaluated[j++];
+
+			REQUIRE(actual["objective"].GetDouble() == Approx(expected["objective"].GetDouble()).margin(1e-9));
+			require_same_values(expected["constraints"], actual["constraints"]);
+			require_same_values(expected["displays"], actual["displays"]);
+			REQUIRE(actual["stats"]["global"]["support"].GetDouble() == Approx(expected["stats"]["global"]["support"].GetDouble()));
+			REQUIRE_FALSE(actual["stats"].HasMember("options"));
+		}
+		REQUIRE(j == evaluated.Size());
+
+		// the preprocessed decision gives the same scores
+		rapidjson::Document preprocessed;
+		preprocessed.Parse(interface::evaluate(decision_json, influents_json, weights_json, config_json, interface::preproc(decision_json), scenarios_json).c_str());
+		REQUIRE(preprocessed.Size() == evaluated.Size());
+		for (rapidjson::SizeType i = 1; i < evaluated.Size(); i++) {
+			REQUIRE(preprocessed[i]["objective"].GetDouble() == Approx(evaluated[i]["objective"].GetDouble()).margin(1e-9));
+			require_same_values(evaluated[i]["constraints"], preprocessed[i]["constraints"]);
+		}
+	}
+};
+
+TEST_CASE("evaluate applies the timings and metrics options", "[integration]") {
+	const std::string dir = fixture_dir("budget_decision_partial_vote_with_xors");
+	const std::string decision_json = file2str(dir + "/decision.json");
+	const std::string influents_json = file2str(dir + "/influents.json");
+	const std::string weights_json = file2str(dir + "/weights.json");
+	const std::string config_json = with_flag(with_flag(file2str(dir + "/config.json"), "timings", true), "metrics", true);
+
+	rapidjson::Document solved;
+	solved.Parse(interface::solve(decision_json, influents_json, weights_json, config_json).c_str());
+	const std::string scenarios_json = solved_scenarios(solved);
+
+	rapidjson::Document d;
+	d.Parse(interface::evaluate(decision_json, influents_json, weights_json, config_json, "", scenarios_json).c_str());
+	REQUIRE(d.Size() > 1);
+	REQUIRE(std::string(d[0]["timings"]["name"].GetString()) == "evaluate");
+	for (auto stage : {"parse", "preproc", "load_votes", "global_outcome", "evaluate_scenarios"})
+		REQUIRE(has_child(d[0]["timings"], stage));
+	for (rapidjson::SizeType i = 1; i < d.Size(); i++) {
+		REQUIRE_FALSE(d[i].HasMember("timings"));
+		REQUIRE(std::string(d[i]["metrics"]["solver"].GetString()) == "evaluation");
+		REQUIRE(d[i]["metrics"]["nodes"].GetUint64() == d.Size() - 1);
+	}
+};
+
+TEST_CASE("evaluate rejects unknown options", "[integration]") {
+	const std::string dir = fixture_dir("budget_decision_partial_vote_with_xors");
+	const std::string decision_json = file2str(dir + "/decision.json");
+	const std::string influents_json = file2str(dir + "/influents.json");
+	const std::string weights_json = file2str(dir + "/weights.json");
+	const std::string config_json = file2str(dir + "/config.json");
+
+	REQUIRE_THROWS_AS(interface::evaluate(decision_json, influents_json, weights_json, config_json, "", "[[\"no such option\"]]"), interface::parameter_error);
+	REQUIRE_THROWS_AS(interface::evaluate(decision_json, influents_json, weights_json, config_json, "", "[\"not a scenario\"]"), interface::parameter_error);
+	REQUIRE_THROWS_AS(interface::evaluate(decision_json, "", weights_json, config_json, "", "[[]]"), interface::parameter_error);
+};
+
+TEST_CASE("expression tape evaluation benchmark", "[.benchmark]") {
+	const int repetitions = 200;
+	for (auto fixture_name : {"budget_decision_partial_vote_with_xors", "tax_assessment_personal_partial_vote", "carbon_budget", "granting_process"}) {
+		decision dec = deserialize<decision>("json", "decision", file2str(fixture_dir(fixture_name) + "/decision.json"));
+		std::unique_ptr<MathProgram> MP = testing_interface::preproc_MP(dec);
+		const auto points = random_points(MP->n_var(), 50);
+		std::shared_ptr<const ExprTape> tape = MP->getConsTape();
+
+		double checksum_tree = 0.0, checksum_tape = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repetitions; r++) {
+			for (const auto& x : points) {
+				for (const auto& cons : MP->getConsList()) checksum_tree += cons.expr->evaluate(x);
+			}
+		}
+		auto tree_time = std::chrono::steady_clock::now() - start;
+
+		std::vector<double> out(tape->n_outputs()), stack(tape->stack_size());
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repetitions; r++) {
+			for (const auto& x : points) {
+				tape->evaluate(x.memptr(), out.data(), stack.data());
+				for (double v : out) checksum_tape += v;
+			}
+		}
+		auto tape_time = std::chrono::steady_clock::now() - start;
+
+		using std::chrono::microseconds;
+		std::cout << fixture_name << ": " << MP->getConsList().size() << " constraints, "
+			<< tape->n_instr() << " tape instructions; tree "
+			<< std::chrono::duration_cast<microseconds>(tree_time).count() << "us, tape "
+			<< std::chrono::duration_cast<microseconds>(tape_time).count() << "us" << std::endl;
+		REQUIRE(checksum_tape == Approx(checksum_tree));
+	}
+};
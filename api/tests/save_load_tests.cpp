@@ -15,7 +15,7 @@ using namespace ethelo;
 
 class testing_interface: public interface{
 	public:
-	static MathProgram* preproc_MP(decision& dec){
+	static std::unique_ptr<MathProgram> preproc_MP(decision& dec){
 		return interface::preproc_MP(dec);
 	}
 };
@@ -23,7 +23,7 @@ class testing_interface: public interface{
 inline void saveLoadTest(decision& dec){
 	const string temp_dec_ID="TEST_DEC";
 	const string temp_code_ver = "TEST_CODE";
-	const MathProgram* MP0 = testing_interface::preproc_MP(dec);
+	std::unique_ptr<const MathProgram> MP0 = testing_interface::preproc_MP(dec);
 	
 	// save
 	std::ostringstream oss;
@@ -31,7 +31,7 @@ inline void saveLoadTest(decision& dec){
 	
 	// load
 	std::istringstream iss(oss.str());
-	const MathProgram* MP1 = MathProgram::loadFromStream(iss, dec, temp_dec_ID, temp_code_ver);
+	std::unique_ptr<const MathProgram> MP1 = MathProgram::loadFromStream(iss, dec, temp_dec_ID, temp_code_ver);
 	
 	// check if MP0,MP1 are the same
 	// number of variable
@@ -72,9 +72,6 @@ inline void saveLoadTest(decision& dec){
 			REQUIRE(dispLS0[i]->is_similar(dispLS1[i]));
 		}
 	}
-
-	delete MP0;
-	delete MP1;
 }
 
 /*======== TEST CASES ========*/
@@ -91,7 +88,7 @@ TEST_CASE("Invalid preproc data", "[SaveLoad]"){
 		arma::mat(), // exclusion
 		0.0 // CI
 	);
-	const MathProgram* MP0 = testing_interface::preproc_MP(dec);
+	std::unique_ptr<const MathProgram> MP0 = testing_interface::preproc_MP(dec);
 	std::ostringstream oss;
 	MP0->save(oss, "Hash", "CodeVer");
 	
@@ -21,6 +21,22 @@ namespace ethelo
             return error("semantic_error", ex.what());
         }
     }
+
+    ETERM* engine_processor::evaluate(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data, const std::string& scenarios_json) {
+        try {
+            auto result = interface::evaluate(decision_json, influents_json, weights_json, config_json, preproc_data, scenarios_json);
+            return erl::as_term(std::tuple<erl::atom, std::string>("ok", result));
+        }
+        catch(const interface::parameter_error& ex) {
+            return error("parameter_error", ex.what());
+        }
+        catch(const syntax_error& ex) {
+            return error("syntax_error", ex.what());
+        }
+        catch(const semantic_error& ex) {
+            return error("semantic_error", ex.what());
+        }
+    }
 	
 	ETERM* engine_processor::preproc(const std::string& decision_json){
 		// mimics engine_processor::solve
@@ -33,6 +49,17 @@ namespace ethelo
 		}
 	}
 
+	ETERM* engine_processor::preproc_update(const std::string& old_preproc_data, const std::string& decision_json){
+		// mimics engine_processor::preproc
+		try{
+			auto result = interface::preproc_update(old_preproc_data, decision_json);
+			return erl::as_term(std::tuple<erl::atom, std::string>("ok", result));
+		}
+		catch(const std::invalid_argument& e){
+			return error("invalid_argument", e.what());
+		}
+	}
+
     static ETERM* validate(const erl::atom& type, const std::string& code) {
         try { interface::validate(type, code); }
         catch(const interface::parameter_error& ex) {
@@ -59,7 +86,9 @@ namespace ethelo
 	
     engine_processor::engine_processor() {
         bind("solve", &engine_processor::solve, this);
+        bind("evaluate", &engine_processor::evaluate, this);
 		bind("preproc", &engine_processor::preproc, this);
+		bind("preproc_update", &engine_processor::preproc_update, this);
         bind("validate", &validate);
 		bind("hash", &hash);
         bind("version", &version);
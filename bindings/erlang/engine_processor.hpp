@@ -5,8 +5,10 @@ namespace ethelo
     class engine_processor : public processor
     {
         ETERM* solve(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data="");
+        ETERM* evaluate(const std::string& decision_json, const std::string& influents_json, const std::string& weights_json, const std::string& config_json, const std::string& preproc_data, const std::string& scenarios_json);
 		
 		ETERM* preproc(const std::string& decision_json);
+		ETERM* preproc_update(const std::string& old_preproc_data, const std::string& decision_json);
 
     public:
         engine_processor();
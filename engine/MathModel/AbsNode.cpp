@@ -43,6 +43,16 @@ AD AbsNode::evaluate(ADvector& x) const{
 	return CppAD::abs(this->arg->evaluate(x)) * (negated? -1.0: 1.0);
 }
 
+void AbsNode::compile(ExprTape& tape) const{
+	this->arg->compile(tape);
+	tape.emit_abs(negated);
+}
+
+ExprSparsity AbsNode::sparsity() const{
+	// abs is piecewise linear, so it adds no curvature to its argument
+	return this->arg->sparsity();
+}
+
 /*void AbsNode::predict_bound(double& lb, double& ub) const{
 	double temp_lb, temp_ub;
 	arg->predict_bound(temp_lb, temp_ub);
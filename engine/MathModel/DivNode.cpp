@@ -62,6 +62,22 @@ AD DivNode::evaluate(ADvector& x) const{
 	return CondExpEq(denum, AD(0.0), AD(0.0), num/denum);
 }
 
+void DivNode::compile(ExprTape& tape) const{
+	this->arg1->compile(tape);
+	this->arg2->compile(tape);
+	tape.emit_div();
+}
+
+ExprSparsity DivNode::sparsity() const{
+	// besides the terms of a product, f/g has curvature dg dg^T in g
+	ExprSparsity out = this->arg1->sparsity();
+	const ExprSparsity s2 = this->arg2->sparsity();
+	out.add_cross(out.support, s2.support);
+	out.add_cross(s2.support, s2.support);
+	out.merge(s2);
+	return out;
+}
+
 bool DivNode::is_fraction() const{
 	return (this->arg1->is_linear()) && (this->arg2->is_linear());
 }
@@ -25,12 +25,14 @@ class DivNode: public MathExprNode{
 	virtual void print(std::ostream& out) const override;
 	virtual double evaluate( const arma::vec& x) const override;
 	virtual AD evaluate( ADvector& x) const override;
+	virtual void compile(ExprTape& tape) const override;
+	virtual ExprSparsity sparsity() const override;
 
 	virtual bool is_fraction() const override;
 	virtual std::string getName() const override{ return "DivNode";}
 
-	virtual MathExprNode* deepcopy() const override{
-		return new DivNode{arg1->deepcopy(), arg2->deepcopy()};
+	virtual MathExprNode* copy_to(const VarMask* VM) const override{
+		return new DivNode{arg1->copy_to(VM), arg2->copy_to(VM)};
 	}
 
 	
@@ -0,0 +1,199 @@
+#include "../mathModelling.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace ethelo{
+
+ExprTape::ExprTape(const std::vector<const MathExprNode*>& exprs){
+	for (const MathExprNode* expr : exprs){
+		if (expr == nullptr){
+			emit_linear(nullptr, 0, 0.0);
+		}else{
+			expr->compile(*this);
+		}
+		push(Out, n_out++, 0, 0.0, -1);
+	}
+	assert(depth == 0);
+}
+
+void ExprTape::push(OpCode op, uint32_t a, uint32_t b, double k, int pushed){
+	code.push_back(Instr{op, a, b, k});
+	depth += pushed;
+	if (depth > max_depth){ max_depth = depth;}
+}
+
+void ExprTape::emit_linear(const double* a, size_t n, double b){
+	uint32_t begin = var.size();
+	for (size_t i = 0; i < n; i++){
+		if (a[i] == 0.0){ continue;}
+		var.push_back(i);
+		coef.push_back(a[i]);
+	}
+	push(Lin, begin, var.size(), b, 1);
+}
+
+void ExprTape::emit_add(size_t n_args){
+	assert(depth >= n_args);
+	push(Add, n_args, 0, 0.0, 1 - static_cast<int>(n_args));
+}
+
+void ExprTape::emit_mult(){
+	assert(depth >= 2);
+	push(Mul, 0, 0, 0.0, -1);
+}
+
+void ExprTape::emit_div(){
+	assert(depth >= 2);
+	push(Div, 0, 0, 0.0, -1);
+}
+
+void ExprTape::emit_abs(bool negated){
+	assert(depth >= 1);
+	push(Abs, 0, 0, (negated ? -1.0 : 1.0), 0);
+}
+
+void ExprTape::emit_sqrt(bool negated){
+	assert(depth >= 1);
+	push(Sqrt, 0, 0, (negated ? -1.0 : 1.0), 0);
+}
+
+/* The helpers below repeat the arithmetic of the double and AD overloads of
+	MathExprNode::evaluate, so both ways of evaluating give the same values.
+*/
+static inline double linear(const double* x, const uint32_t* var, const double* coef, uint32_t n, double b){
+	double sum = 0.0;
+	for (uint32_t j = 0; j < n; j++){
+		sum += coef[j] * x[var[j]];
+	}
+	return sum + b;
+}
+
+static inline AD linear(const AD* x, const uint32_t* var, const double* coef, uint32_t n, double b){
+	AD sum(b);
+	for (uint32_t j = 0; j < n; j++){
+		if (coef[j] == 1.0){       sum += x[var[j]];}
+		else if (coef[j] == -1.0){ sum -= x[var[j]];}
+		else{                      sum += coef[j] * x[var[j]];}
+	}
+	return sum;
+}
+
+static inline double divide(const double& num, const double& denum){
+	return (denum == 0.0 ? 0.0 : num / denum);
+}
+
+static inline AD divide(const AD& num, const AD& denum){
+	return CondExpEq(denum, AD(0.0), AD(0.0), num/denum);
+}
+
+static inline double absolute(const double& v, double k){ return k * std::abs(v);}
+static inline AD absolute(const AD& v, double k){ return CppAD::abs(v) * k;}
+static inline double square_root(const double& v, double k){ return k * std::sqrt(v);}
+static inline AD square_root(const AD& v, double k){ return k * CppAD::sqrt(v);}
+
+template<typename T>
+void ExprTape::evaluate(const T* x, T* out, T* stack) const{
+	T* top = stack; // one past the top of the stack
+
+	for (const Instr& in : code){
+		switch (in.op){
+			case Lin:
+				*top++ = linear(x, var.data() + in.a, coef.data() + in.a, in.b - in.a, in.k);
+				break;
+			case Add:{
+				T sum(0.0);
+				for (T* arg = top - in.a; arg != top; arg++){
+					sum += *arg;
+				}
+				top -= in.a;
+				*top++ = sum;
+				break;
+			}
+			case Mul:
+				top--;
+				top[-1] = top[-1] * top[0];
+				break;
+			case Div:
+				top--;
+				top[-1] = divide(top[-1], top[0]);
+				break;
+			case Abs:
+				top[-1] = absolute(top[-1], in.k);
+				break;
+			case Sqrt:
+				top[-1] = square_root(top[-1], in.k);
+				break;
+			case Out:
+				out[in.a] = *--top;
+				break;
+		}
+	}
+}
+
+template void ExprTape::evaluate<double>(const double* x, double* out, double* stack) const;
+template void ExprTape::evaluate<AD>(const AD* x, AD* out, AD* stack) const;
+
+std::vector<double> ExprTape::evaluate(const std::vector<double>& x) const{
+	std::vector<double> out(n_out), stack(max_depth);
+	evaluate(x.data(), out.data(), stack.data());
+	return out;
+}
+
+void ExprTape::evaluate_batch(const double* x, size_t m, double* out, double* stack) const{
+	double* top = stack; // one past the top of the stack, which holds m values per entry
+
+	for (const Instr& in : code){
+		switch (in.op){
+			case Lin:
+				// same order as linear(): the terms in turn, then the constant
+				std::fill(top, top + m, 0.0);
+				for (uint32_t j = in.a; j < in.b; j++){
+					const double c = coef[j];
+					const double* xv = x + var[j] * m;
+					for (size_t p = 0; p < m; p++){ top[p] += c * xv[p];}
+				}
+				for (size_t p = 0; p < m; p++){ top[p] += in.k;}
+				top += m;
+				break;
+			case Add:{
+				double* args = top - in.a * m;
+				for (size_t p = 0; p < m; p++){
+					double sum = 0.0;
+					for (uint32_t arg = 0; arg < in.a; arg++){ sum += args[arg * m + p];}
+					args[p] = sum;
+				}
+				top = args + m;
+				break;
+			}
+			case Mul:{
+				top -= m;
+				double* lhs = top - m;
+				for (size_t p = 0; p < m; p++){ lhs[p] = lhs[p] * top[p];}
+				break;
+			}
+			case Div:{
+				top -= m;
+				double* lhs = top - m;
+				for (size_t p = 0; p < m; p++){ lhs[p] = divide(lhs[p], top[p]);}
+				break;
+			}
+			case Abs:{
+				double* arg = top - m;
+				for (size_t p = 0; p < m; p++){ arg[p] = absolute(arg[p], in.k);}
+				break;
+			}
+			case Sqrt:{
+				double* arg = top - m;
+				for (size_t p = 0; p < m; p++){ arg[p] = square_root(arg[p], in.k);}
+				break;
+			}
+			case Out:
+				top -= m;
+				std::copy(top, top + m, out + in.a * m);
+				break;
+		}
+	}
+}
+
+} // namespace ethelo
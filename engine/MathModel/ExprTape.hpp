@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../ADShorthands.hpp"
+
+namespace ethelo{
+
+class MathExprNode;
+
+/*
+	ExprTape is a flat, postfix encoding of a list of MathExprNodes, evaluated
+	  with a value stack instead of walking the trees.
+
+	Every node appends its instructions through MathExprNode::compile():
+	  LinExp leaves become sparse dot products over their nonzero coefficients,
+	  inner nodes pop their operands and push the result. Each compiled tree
+	  ends with an Out instruction that stores the value in its output slot.
+
+	Evaluation follows the same arithmetic as MathExprNode::evaluate, and does
+	  not allocate when the caller provides the stack (see stack_size()).
+*/
+
+class ExprTape{
+  public:
+	enum OpCode : uint8_t {
+		Lin,	// push k + sum_{j in [a,b)} coef[j] * x[var[j]]
+		Add,	// pop a values, push their sum
+		Mul,	// pop 2, push product
+		Div,	// pop 2, push quotient (0 when the denominator is 0)
+		Abs,	// replace top v by k * |v|
+		Sqrt,	// replace top v by k * sqrt(v)
+		Out		// pop into output slot a
+	};
+
+	struct Instr{
+		OpCode op;
+		uint32_t a, b;
+		double k;
+	};
+
+  private:
+	std::vector<Instr> code;
+	std::vector<uint32_t> var;
+	std::vector<double> coef;
+	size_t n_out = 0;
+	size_t depth = 0, max_depth = 0;
+
+	void push(OpCode op, uint32_t a, uint32_t b, double k, int pushed);
+
+  public:
+	ExprTape() {}
+	// compiles exprs[i] into output slot i; a nullptr expression evaluates to 0
+	ExprTape(const std::vector<const MathExprNode*>& exprs);
+
+	/* Emitters used by MathExprNode::compile() */
+	void emit_linear(const double* a, size_t n, double b);
+	void emit_add(size_t n_args);
+	void emit_mult();
+	void emit_div();
+	void emit_abs(bool negated);
+	void emit_sqrt(bool negated);
+
+	size_t n_outputs() const { return n_out;}
+	size_t n_instr() const { return code.size();}
+	size_t stack_size() const { return max_depth;}
+
+	/* evaluate(x, out, stack) writes the value of expression i to out[i].
+		stack needs room for stack_size() values.
+		Instantiated for double and AD.
+	*/
+	template<typename T>
+	void evaluate(const T* x, T* out, T* stack) const;
+
+	// convenience wrapper allocating its own stack
+	std::vector<double> evaluate(const std::vector<double>& x) const;
+
+	/* evaluate_batch(x, m, out, stack) evaluates m points at once, running
+		every instruction over all of them: x[v*m + p] is variable v at
+		point p, and the value of expression i at point p goes to
+		out[i*m + p] (i.e. column-major m-row matrices). stack needs room
+		for stack_size()*m values. Gives the same values as evaluate().
+	*/
+	void evaluate_batch(const double* x, size_t m, double* out, double* stack) const;
+};
+
+} // namespace ethelo
@@ -5,15 +5,37 @@
 
 namespace ethelo{
 
+// coef_vector(node, n) makes room for the coefficients of a LinExp under
+//   construction, in the arena the node was placed in when it has one. The
+//   vector is not strict, so resizing it moves it to the heap
+static arma::vec coef_vector(const LinExp* node, size_t n){
+	NodeArena* arena = NodeArena::arena_of(node);
+	if (arena == nullptr || n == 0){
+		return arma::vec(n);
+	}
+	return arma::vec(static_cast<double*>(NodeArena::allocate_node(arena, n * sizeof(double))), n, false, false);
+}
+
 LinExp::LinExp(const VarMask* VM, const arma::vec& a, double b):
-	MathExprNode(NodeType::LinearExp,VM), a{a}, b{b}
-	{}
+	MathExprNode(NodeType::LinearExp,VM), a{coef_vector(this, a.n_elem)}, b{b}
+	{
+		this->a = a;
+		if (counted){ node_census::coef_bytes(this->a.n_elem * sizeof(double));}
+	}
 
 LinExp::LinExp(const VarMask* VM, double c):
 	MathExprNode(NodeType::LinearExp, VM),
-	a{arma::zeros(VM->n_var())},
+	a{coef_vector(this, VM->n_var())},
 	b{c}
-	{}
+	{
+		a.zeros();
+		if (counted){ node_census::coef_bytes(a.n_elem * sizeof(double));}
+	}
+
+LinExp::~LinExp(){
+	if (counted){ node_census::coef_bytes(-static_cast<int64_t>(a.n_elem * sizeof(double)));}
+	if (a.mem_state == 1){ NodeArena::free_node(a.memptr());} // still in the arena
+}
 
 
 void LinExp::operator += (const LinExp& other){
@@ -62,6 +84,18 @@ AD LinExp::evaluate(ADvector& x) const{
 	return sum;
 }
 
+void LinExp::compile(ExprTape& tape) const{
+	tape.emit_linear(a.memptr(), a.n_elem, b);
+}
+
+ExprSparsity LinExp::sparsity() const{
+	ExprSparsity out;
+	for (size_t i=0; i<a.n_elem; i++){
+		if (a[i] != 0.0){ out.support.insert(i);}
+	}
+	return out;
+}
+
 void LinExp::predict_bound(double& lb, double& ub) const{
 	lb = b; ub = b;
 	double temp1,temp2;
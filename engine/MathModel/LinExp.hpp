@@ -11,7 +11,7 @@ class QuadExprNode;
 class LinExp: public MathExprNode{
 	// This represents the expression (a^T * x + b) with variable x
 
-	arma::vec a;
+	arma::vec a; // in the NodeArena of the node when it has one
 	double b;
 	
 	virtual void save_content(std::ostream& out) const override;
@@ -19,6 +19,7 @@ class LinExp: public MathExprNode{
   public:
 	LinExp(const VarMask* VM, const arma::vec& a, double b);
 	LinExp(const VarMask* VM, double b);
+	~LinExp();
 
 	void operator += (const LinExp& other);
 
@@ -31,13 +32,15 @@ class LinExp: public MathExprNode{
 	virtual void print(std::ostream& out) const override;
 	virtual double evaluate( const arma::vec& x) const override;
 	virtual AD evaluate( ADvector& x) const override;
+	virtual void compile(ExprTape& tape) const override;
+	virtual ExprSparsity sparsity() const override;
 	virtual void predict_bound(double& lb, double& ub) const override;
 	virtual bool is_linear() const override{	return true; }
 	virtual bool is_quadratic() const override{	return true; }
 	virtual bool is_leaf() const override{		return true; }
 	virtual std::string getName() const override{ return "LinExp";}
 
-	virtual MathExprNode* deepcopy() const override{
+	virtual MathExprNode* copy_to(const VarMask* VM) const override{
 		return new LinExp(VM, a, b);
 	}
 	
@@ -4,13 +4,48 @@
 
 namespace ethelo{
 using std::vector;
-MathExprNode::MathExprNode(NodeType T, const VarMask* VM): Type{T}, VM{VM} {}
+static_assert(MathExprNode::NodeType::QuadExprNode + 1 == node_census::num_types, "node_census needs one count per NodeType");
 
-MathExprNode::~MathExprNode(){}
+MathExprNode::MathExprNode(NodeType T, const VarMask* VM): Type{T}, VM{VM}, counted{node_census::enabled()} {
+	if (counted){ node_census::added(T);}
+}
+
+MathExprNode::~MathExprNode(){
+	if (counted){ node_census::removed(Type);}
+}
+
+void* MathExprNode::operator new(size_t bytes){
+	return NodeArena::allocate_node(NodeArena::current(), bytes);
+}
+
+void MathExprNode::operator delete(void* ptr){
+	NodeArena::free_node(ptr);
+}
 
 void MathExprNode::print(std::ostream& out) const{
 	throw std::invalid_argument("MathExprNode: Printing for "+this->getName()+" has yet been implemented");
 }
+void MathExprNode::compile(ExprTape& tape) const{
+	throw std::invalid_argument("MathExprNode: Compiling for "+this->getName()+" has yet been implemented");
+}
+
+ExprSparsity MathExprNode::sparsity() const{
+	throw std::invalid_argument("MathExprNode: Sparsity for "+this->getName()+" has yet been implemented");
+}
+
+void ExprSparsity::merge(const ExprSparsity& other){
+	support.insert(other.support.begin(), other.support.end());
+	hessian.insert(other.hessian.begin(), other.hessian.end());
+}
+
+void ExprSparsity::add_cross(const std::set<size_t>& s1, const std::set<size_t>& s2){
+	for (size_t i : s1){
+		for (size_t j : s2){
+			hessian.insert(i >= j ? std::make_pair(i, j) : std::make_pair(j, i));
+		}
+	}
+}
+
 /*double MathExprNode::evaluate( const arma::vec& x) const{
 	throw std::invalid_argument("MathExprNode: Evaluation for "+this->getName()+" has yet been implemented");
 }*/
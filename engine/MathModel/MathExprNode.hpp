@@ -1,5 +1,6 @@
 #pragma once
 #include <armadillo>
+#include <set>
 #include <string>
 #include <utility>
 #include "../ADShorthands.hpp"
@@ -16,6 +17,22 @@
 namespace ethelo{
 	
 class VarMask;
+class ExprTape;
+
+/* ExprSparsity is the structural sparsity of an expression: the variables
+	it depends on (support), and the entries (i,j) with i >= j of its Hessian
+	that are not identically zero. It only depends on the shape of the tree,
+	so it holds at every point.
+*/
+struct ExprSparsity{
+	std::set<size_t> support;
+	std::set<std::pair<size_t,size_t>> hessian;
+
+	// merge(other) adds the pattern of other to this one
+	void merge(const ExprSparsity& other);
+	// add_cross(s1, s2) adds the entries {i,j} with i in s1 and j in s2
+	void add_cross(const std::set<size_t>& s1, const std::set<size_t>& s2);
+};
 
 class MathExprNode{
 
@@ -27,6 +44,9 @@ class MathExprNode{
 	const NodeType Type;
 	const VarMask* VM;
 	
+  protected:
+	const bool counted; // whether node_census counts this node, fixed at construction
+	
   private:
 	// save_content is used as subprocess in save() function below,
 	// it prints content of a node to out, without node type
@@ -39,7 +59,10 @@ class MathExprNode{
   public:
 	// Pure Virtual methods
 	virtual MathExprNode* scale(double k) = 0; //multiply by constant
-	virtual MathExprNode* deepcopy() const = 0;
+	MathExprNode* deepcopy() const { return copy_to(VM); }
+	// copy_to(VM) is a deepcopy associated with VM, which must have as many
+	//   variables as this->VM
+	virtual MathExprNode* copy_to(const VarMask* VM) const = 0;
 	
 	/* decouple(code, args) destroyes current structure and returns
 		its subnodes in args and assigns a status code to code for 
@@ -49,6 +72,11 @@ class MathExprNode{
 	
 	virtual ~MathExprNode();
 	
+	// nodes are placed in the NodeArena installed on the constructing thread,
+	//   if any, see NodeArena.hpp. Nodes are only created with new
+	static void* operator new(size_t bytes);
+	static void operator delete(void* ptr);
+	
 	/* print(out) prints the MathExprNode in human-readable format,
 		evaluate(x) evaluates the expression at given point x,
 		save(out) saves the MathExprNode into file via out
@@ -59,6 +87,14 @@ class MathExprNode{
 	virtual AD evaluate( ADvector& x) const = 0;
 	void save(std::ostream& out) const;
 	
+	// compile(tape) appends the postfix instructions of this node to tape,
+	//   see ExprTape.hpp. Throws exceptions unless being override
+	virtual void compile(ExprTape& tape) const;
+
+	// sparsity() returns the structural sparsity of this node.
+	//   Throws exceptions unless being override
+	virtual ExprSparsity sparsity() const;
+	
 	// predict_bound sets ub/lb to estimated upper/lower bound of expression.
 	// By default, it sets lb=-INFTY, ub=INFTY unless being override
 	virtual void predict_bound(double& lb, double& ub) const;
@@ -30,35 +30,69 @@ bool MathProgram::MathCons::operator ==(const MathProgram::MathCons& other) cons
 }
 /*=============== MathProgram =====================*/
 MathProgram::MathProgram(const problem& p):
-	VM{nullptr}, p{p}, excl_added{false}
+	VM{nullptr}, p{p}, excl_added{false}, arena{new NodeArena()}
 		{}
 		
 MathProgram::MathProgram(const FixVar_Mask& VM, const problem& p, bool autofill, bool includeExcl):
 	VM{VM.deepcopy()}, p{p}, 
-	excl_added{autofill && includeExcl}
+	excl_added{autofill && includeExcl},
+	arena{new NodeArena()}
 	{
 	if (autofill){
-		fillWithEval(includeExcl);
+		try {
+			fillWithEval(includeExcl);
+		}
+		catch (...) {
+			delete this->VM; // the destructor does not run
+			throw;
+		}
 	}
 }
 	
 
 void MathProgram::fillWithEval(bool includeExcl){
 	evaluator eval(p);
-	const auto& cons = p.constraints();
-	const auto& epsilon = MathProgram::epsilon;
+	const FixVar_Mask* FVmask = static_cast<FixVar_Mask*>(this->VM);
+	
+	const size_t n_cons = p.constraints().size();
+	const size_t n_excl = includeExcl ? p.exclusions().n_rows : 0;
+	const size_t n_disp = p.displays().size();
 	
-	std::vector<MathExprNode*> ExprList;
-	detail_sets.clear();
+	// Constraints, exclusions and displays are independent of each other, so
+	// they are translated as one batch on the thread pool. Every task owns
+	// one slot of ExprList, which keeps the result in declaration order.
+	std::vector<MathExprNode*> ExprList(n_cons + n_excl + n_disp, nullptr);
+	detail_sets.assign(n_cons, std::set<std::string>());
+	
+	try {
+		thread_pool::global().parallel_for(ExprList.size(), [&](size_t i){
+			NodeArena::Scope scope(arena.get());
+			if (i < n_cons){
+				ExprList[i] = eval.translate_constraint(FVmask, i, detail_sets[i]);
+			}else if (i < n_cons + n_excl){
+				ExprList[i] = eval.translate_exclusion(FVmask, i - n_cons);
+			}else{
+				ExprList[i] = eval.translate_display(FVmask, i - n_cons - n_excl);
+			}
+		});
+	}
+	catch (...) {
+		for (auto expr : ExprList){ delete expr;}
+		throw;
+	}
 	
-	eval.translate(static_cast<FixVar_Mask*>(this->VM), ExprList,detail_sets);
+	assemble(ExprList, n_excl);
+}
+
+void MathProgram::assemble(const std::vector<MathExprNode*>& ExprList, size_t n_excl){
+	const size_t n_cons = p.constraints().size();
+	assert(ExprList.size() == n_cons + n_excl + p.displays().size());
 	
-	// ConsList.resize(ExprList.size());
+	resetTapes();
 	ConsList.clear();
 
-	for (int i = 0; i < p.constraints().size(); i++) {
+	for (int i = 0; i < n_cons; i++) {
 		const auto& cons = p.constraints()[i];
-		// bool encountered_blacklisted_detail = false;
 		
 		if (ExprList[i] == nullptr){
 			continue;
@@ -73,22 +107,41 @@ void MathProgram::fillWithEval(bool includeExcl){
 				);
 	}
 	//Extract Trees for exclusions
-	for (int i = p.constraints().size(); i < p.constraints().size() + p.exclusions().n_rows; i++){
-		if (includeExcl){
-			ConsList.push_back(	MathCons(ExprList[i], 1.0, MathProgram::INFTY, -1));
-		}
-		else{
-			delete ExprList[i];
-			ExprList[i] = nullptr;
-		}
+	for (size_t i = n_cons; i < n_cons + n_excl; i++){
+		ConsList.push_back(	MathCons(ExprList[i], 1.0, MathProgram::INFTY, -1));
 	}
 	
 	// fill out display values
-	displayList.clear();
-	eval.translate_displays(static_cast<FixVar_Mask*>(this->VM),displayList);
+	displayList.assign(ExprList.begin() + n_cons + n_excl, ExprList.end());
 	
 }
 
+void MathProgram::resetTapes(){
+	std::lock_guard<std::mutex> lock(tapeMutex);
+	consTape.reset();
+	displayTape.reset();
+}
+
+std::shared_ptr<const ExprTape> MathProgram::getConsTape() const{
+	std::lock_guard<std::mutex> lock(tapeMutex);
+	if (!consTape){
+		std::vector<const MathExprNode*> exprs;
+		for (const auto& cons : ConsList){
+			exprs.push_back(cons.expr);
+		}
+		consTape.reset(new ExprTape(exprs));
+	}
+	return consTape;
+}
+
+std::shared_ptr<const ExprTape> MathProgram::getDisplayTape() const{
+	std::lock_guard<std::mutex> lock(tapeMutex);
+	if (!displayTape){
+		displayTape.reset(new ExprTape(std::vector<const MathExprNode*>(displayList.begin(), displayList.end())));
+	}
+	return displayTape;
+}
+
 void MathProgram::print(std::ostream& out) const{
 	
 	out << "======== Printing MathProgram Tree ... =======";
@@ -108,6 +161,8 @@ void MathProgram::print(std::ostream& out) const{
 }
 
 void MathProgram::apply_mask(VarMask* mask){
+	ETHELO_PROFILE_SPAN("apply_mask");
+	NodeArena::Scope scope(arena.get());
 	
 	assert(mask->is_clean());
 	assert(mask->n_var_orig() == this->getVM()->n_var());
@@ -120,6 +175,7 @@ void MathProgram::apply_mask(VarMask* mask){
 	
 	mask->addToFront(VM);
 	VM = mask;
+	resetTapes();
 
 }
 
@@ -177,6 +233,7 @@ bool MathProgram::is_linear() const{
 
 void MathProgram::linearize(bool easy){
 	if (is_linear()){ return;}
+	NodeArena::Scope scope(arena.get());
 	
 
 	const int n = this->n_var();
@@ -212,6 +269,7 @@ void MathProgram::linearize(bool easy){
 	std::swap(ConsList, OrigConsList);
 
 	ConsList.clear();
+	resetTapes();
 	// First handle Linear constraints
 	for (auto i: Linear_id){
 		// double lb,ub;
@@ -374,7 +432,7 @@ void MathProgram::save(ostream& fout, const std::string& decHashed, const std::s
 	}
 }
 
-MathProgram* MathProgram::loadFromStream(istream& fin, const problem& p, const string& decHashed, const string& codeVer){
+std::unique_ptr<MathProgram> MathProgram::loadFromStream(istream& fin, const problem& p, const string& decHashed, const string& codeVer){
 	// ifstream fin(path);
 	// Assert versions
 	string line;
@@ -391,7 +449,8 @@ MathProgram* MathProgram::loadFromStream(istream& fin, const problem& p, const s
 	fin >> n_var;
 	assert(n_var == p.dim());
 	FixVar_Mask temp_VM(n_var);
-	MathProgram* MP = new MathProgram(temp_VM, p, false, false);
+	std::unique_ptr<MathProgram> MP(new MathProgram(temp_VM, p, false, false));
+	NodeArena::Scope scope(MP->arena.get());
     
 	// load details
 	int n_detailSet, tempInt;
@@ -430,16 +489,61 @@ MathProgram* MathProgram::loadFromStream(istream& fin, const problem& p, const s
 	return MP;
 }
 	
-MathProgram* MathProgram::createImage(const FixVar_Mask& VM_new) const{
+std::unique_ptr<MathProgram> MathProgram::update(const MathProgram& old, const problem& p, const std::vector<int>& cons_from, const std::vector<int>& disp_from){
+	assert(old.VM->is_identity());
+	assert(!old.excl_added);
+	assert(old.n_var() == p.dim());
+	assert(cons_from.size() == p.constraints().size());
+	assert(disp_from.size() == p.displays().size());
+	
+	FixVar_Mask temp_VM(p.dim());
+	std::unique_ptr<MathProgram> MP(new MathProgram(temp_VM, p, false, false));
+	const FixVar_Mask* FVmask = static_cast<FixVar_Mask*>(MP->VM);
+	evaluator eval(p);
+	
+	const size_t n_cons = cons_from.size();
+	std::vector<MathExprNode*> ExprList(n_cons + disp_from.size(), nullptr);
+	MP->detail_sets.assign(n_cons, std::set<std::string>());
+	
+	try {
+		thread_pool::global().parallel_for(ExprList.size(), [&](size_t i){
+			NodeArena::Scope scope(MP->arena.get());
+			if (i < n_cons){
+				if (cons_from[i] < 0){
+					ExprList[i] = eval.translate_constraint(FVmask, i, MP->detail_sets[i]);
+				}else{
+					const MathCons& cons = old.ConsList.at(cons_from[i]);
+					ExprList[i] = cons.expr->copy_to(MP->VM);
+					MP->detail_sets[i] = old.detail_sets.at(cons.detail_set_id);
+				}
+			}else{
+				int j = disp_from[i - n_cons];
+				ExprList[i] = (j < 0 ?
+					eval.translate_display(FVmask, i - n_cons) :
+					old.displayList.at(j)->copy_to(MP->VM));
+			}
+		});
+	}
+	catch (...) {
+		for (auto expr : ExprList){ delete expr;}
+		throw;
+	}
+	
+	MP->assemble(ExprList, 0);
+	return MP;
+}
+	
+std::unique_ptr<MathProgram> MathProgram::createImage(const FixVar_Mask& VM_new) const{
 	assert(!excl_added);
 	assert(this->VM->getName()=="FixVar_Mask" && this->VM->is_simple() ); // only to be called on preproc_MP
 	// assert(this->VM->n_var_orig() == VM_new.n_var());
 	
-	MathProgram* tempMP = new MathProgram(*static_cast<FixVar_Mask*>(this->VM), p, false);
+	std::unique_ptr<MathProgram> tempMP(new MathProgram(*static_cast<FixVar_Mask*>(this->VM), p, false));
 	
 	tempMP->detail_sets = this->detail_sets;
 	
-	// filter constraints
+	// filter constraints, copying them into the arena of tempMP
+	NodeArena::Scope scope(tempMP->arena.get());
 	for ( const auto& cons: ConsList ){
 		bool skipCons = false;
 		if (cons.is_relaxable && cons.detail_set_id != -1){
@@ -464,12 +568,16 @@ MathProgram* MathProgram::createImage(const FixVar_Mask& VM_new) const{
 	tempMP->apply_mask(VM_new.deepcopy());
 	
 	// add exclusions
-	tempMP->addExcl();
+	{
+		ETHELO_PROFILE_SPAN("add_exclusions");
+		tempMP->addExcl();
+	}
 	return tempMP;
 }
 
 void MathProgram::addExcl(){
 	assert( !excl_added);
+	NodeArena::Scope scope(arena.get());
 	
 	const FixVar_Mask* revMask;
 	if (VM->n_var() == p.dim()){
@@ -484,6 +592,7 @@ void MathProgram::addExcl(){
 	}
 	
 	excl_added = true;
+	resetTapes();
 	// procedure below should mimic behavior in evaluate::translate_expr
 	for (int i = 0; i < p.exclusions().n_rows; i++){			
 		arma::vec excl = arma::vectorise(arma::mat(p.exclusions().row(i)));
@@ -514,7 +623,14 @@ void MathProgram::addExcl(){
 	}
 }
 
+size_t MathProgram::arena_bytes() const{
+	return arena->bytes_used();
+}
+
 MathProgram::~MathProgram(){
+	// destructors of the nodes still run (they own vectors), but their
+	//   memory is only released with the arena, after the body
+	
 	// delete constraints
 	for (auto& cons : ConsList){
 		delete cons.expr;
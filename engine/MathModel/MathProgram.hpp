@@ -3,6 +3,8 @@
 #include <vector>
 #include <set>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 namespace ethelo{
 
@@ -10,6 +12,8 @@ class MathExprNode;
 class problem;
 class evaluator;
 class FixVar_Mask;
+class ExprTape;
+class NodeArena;
 
 /*
 	MathProgram is a structure that is intended to be used for reformulating a problem.
@@ -18,6 +22,8 @@ class FixVar_Mask;
 	Invariants:
 	  - VM != nullptr, VM->n_orig_var() == p.dim()
 	  - All expressions in constraints corrsponds to the VarMask VM at all time
+	  - All expressions are built while arena is installed (see NodeArena.hpp),
+	    so freeing the program releases their memory in a few chunks
 */
 
 class MathProgram{
@@ -51,14 +57,23 @@ class MathProgram{
 	std::vector<MathExprNode*> displayList; // list of display values 
 	std::vector<std::set<std::string>> detail_sets;
 	std::vector<int> bridge;
+	std::unique_ptr<NodeArena> arena; // memory of the expressions
+	
+	// flat copies of the constraint and display trees, built on first use
+	mutable std::shared_ptr<const ExprTape> consTape, displayTape;
+	mutable std::mutex tapeMutex;
 	
 	/* member functions */
 	
 	// prints() prints structure in human-readable format
 	void print(std::ostream& out) const;
 	
-	void fillWithEval(bool includeExcl);	// fill structure by calling evaluator::translate
+	void fillWithEval(bool includeExcl);	// fill structure by translating constraints and displays on the thread pool
+	// assemble(ExprList, n_excl) takes ownership of translated constraints, n_excl exclusions
+	//   and displays, in that order, and fills ConsList and displayList with them
+	void assemble(const std::vector<MathExprNode*>& ExprList, size_t n_excl);
 	void apply_mask(VarMask* mask);
+	void resetTapes(); // to be called whenever ConsList or displayList changes
 	
 	void addExcl(); // add exclusion constraints
   public:
@@ -71,6 +86,9 @@ class MathProgram{
 	
 	~MathProgram(); // this deletes VM and dynamically allocated fields in ConsList
 	
+	MathProgram(const MathProgram&) = delete;
+	MathProgram& operator=(const MathProgram&) = delete;
+	
 	
 	const size_t n_var() const 		{	return VM->n_var();}
 	const VarMask* getVM() const 	{	return VM;}
@@ -81,7 +99,17 @@ class MathProgram{
 	const std::vector<std::set<std::string>>& getDetailSets() const{
 		return detail_sets;
 	}
+	
+	/* getConsTape()/getDisplayTape() return the constraint/display expressions
+		compiled into an ExprTape, whose output i is ConsList[i].expr
+		(resp. displayList[i]). Compiled once, safe to call from several threads.
+		A returned tape stays valid when the program changes afterwards; it
+		then describes the expressions as they were when it was returned.
+	*/
+	std::shared_ptr<const ExprTape> getConsTape() const;
+	std::shared_ptr<const ExprTape> getDisplayTape() const;
 	const problem* getProblem() const{ return &p;}
+	size_t arena_bytes() const; // bytes taken by the expressions so far
 	bool is_linearizable() const;
 	bool is_linear() const;
 	
@@ -94,7 +122,17 @@ class MathProgram{
 	
 	// void save(std::string path);
 	void save(std::ostream& fout, const std::string& decHashed, const std::string& codeVer) const;
-	static MathProgram* loadFromStream(std::istream& fin, const problem& p, const std::string& decHashed, const std::string& codeVer); // caller is responsible for freeing returned object
+	static std::unique_ptr<MathProgram> loadFromStream(std::istream& fin, const problem& p, const std::string& decHashed, const std::string& codeVer);
+	
+	/*
+		update(old, p, cons_from, disp_from) creates the preprocessed MathProgram of p
+		while reusing translations from [old], another preprocessed MathProgram
+		over the same options:
+		1. Constraint i is copied from old constraint cons_from[i], together with
+			its detail set, or translated from p when cons_from[i] is -1
+		2. Display i is handled the same way through disp_from[i]
+	*/
+	static std::unique_ptr<MathProgram> update(const MathProgram& old, const problem& p, const std::vector<int>& cons_from, const std::vector<int>& disp_from);
 	
 	/*
 		createImage(allowedSig, VM_new) create a new MathProgram(MP) by:
@@ -102,9 +140,11 @@ class MathProgram{
 			at the moment of call
 		2. Copy remaining constraints to new MP and call apply_mask(VM_new) in new MP
 		3. Add exclusion constraints to new MP by calling addExcl()
-		** Note that caller is responsible for freeing returned object
+		The expressions of the new MP are copied into its own arena, whose
+		chunks are recycled from programs freed earlier (e.g. the previous
+		scenario's image).
 	*/
-	MathProgram* createImage(const FixVar_Mask& VM_new) const;
+	std::unique_ptr<MathProgram> createImage(const FixVar_Mask& VM_new) const;
 	
 	
 	void assert_similar(const MathProgram& other) const;
@@ -51,6 +51,21 @@ AD MultNode::evaluate( ADvector& x) const{
 	return (this->arg1->evaluate(x)) * (this->arg2 -> evaluate(x));
 }
 
+void MultNode::compile(ExprTape& tape) const{
+	this->arg1->compile(tape);
+	this->arg2->compile(tape);
+	tape.emit_mult();
+}
+
+ExprSparsity MultNode::sparsity() const{
+	// d2(fg) = g d2f + f d2g + df dg^T + dg df^T
+	ExprSparsity out = this->arg1->sparsity();
+	const ExprSparsity s2 = this->arg2->sparsity();
+	out.add_cross(out.support, s2.support);
+	out.merge(s2);
+	return out;
+}
+
 bool MultNode::is_quadratic() const {
 	return (this->arg1->is_linear()) && (this->arg2->is_linear());
 }
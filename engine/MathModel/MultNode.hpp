@@ -21,12 +21,14 @@ class MultNode: public MathExprNode{
 	virtual MathExprNode* scale(double k) override;
 	virtual double evaluate( const arma::vec& x) const override;
 	virtual AD evaluate(ADvector& x) const override;
+	virtual void compile(ExprTape& tape) const override;
+	virtual ExprSparsity sparsity() const override;
 	virtual void print(std::ostream& out) const override;
 	virtual bool is_quadratic() const override;
 	virtual std::string getName() const override{ return "MultNode";}
 
-	virtual MathExprNode* deepcopy() const override{
-		return new MultNode{arg1->deepcopy(), arg2->deepcopy()};
+	virtual MathExprNode* copy_to(const VarMask* VM) const override{
+		return new MultNode{arg1->copy_to(VM), arg2->copy_to(VM)};
 	}
 
 	friend MathExprNode* MExprMult(MathExprNode* arg1, MathExprNode* arg2);
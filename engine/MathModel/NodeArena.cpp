@@ -0,0 +1,223 @@
+#include "NodeArena.hpp"
+#include <new>
+
+namespace ethelo{
+
+namespace{
+	// blocks handed to nodes start with the arena they came from (nullptr: heap)
+	//   and their size, which keeps the node 16-byte aligned
+	struct Header{
+		NodeArena* arena;
+		size_t bytes;
+	};
+	const size_t header_size = 16;
+	static_assert(sizeof(Header) <= header_size, "block header does not fit");
+	const size_t max_pooled = 256; // chunks kept for reuse, 16 MiB
+
+	thread_local NodeArena* current_arena = nullptr;
+
+	size_t round_up(size_t bytes){
+		return (bytes + 15) & ~static_cast<size_t>(15);
+	}
+
+	// chunks of chunk_size released by arenas. Arenas destroyed after the
+	//   pool during static destruction free their chunks directly
+	bool pool_closed = false;
+
+	struct ChunkPool{
+		std::mutex mutex;
+		std::vector<char*> free;
+
+		~ChunkPool(){
+			std::lock_guard<std::mutex> lock(mutex);
+			for (char* data : free){
+				::operator delete(data);
+			}
+			free.clear();
+			pool_closed = true;
+		}
+	};
+
+	ChunkPool& pool(){
+		static ChunkPool instance;
+		return instance;
+	}
+
+	char* take_chunk(){
+		if (pool_closed){
+			return static_cast<char*>(::operator new(NodeArena::chunk_size));
+		}
+		ChunkPool& p = pool();
+		{
+			std::lock_guard<std::mutex> lock(p.mutex);
+			if (!p.free.empty()){
+				char* data = p.free.back();
+				p.free.pop_back();
+				return data;
+			}
+		}
+		return static_cast<char*>(::operator new(NodeArena::chunk_size));
+	}
+
+	void give_chunk(char* data){
+		if (pool_closed){
+			::operator delete(data);
+			return;
+		}
+		ChunkPool& p = pool();
+		{
+			std::lock_guard<std::mutex> lock(p.mutex);
+			if (p.free.size() < max_pooled){
+				p.free.push_back(data);
+				return;
+			}
+		}
+		::operator delete(data);
+	}
+}
+
+NodeArena::~NodeArena(){
+	release();
+}
+
+void* NodeArena::allocate(size_t bytes){
+	bytes = round_up(bytes);
+
+	if (bytes > chunk_size / 4){
+		// large blocks get a chunk of their own, leaving head for the small ones
+		std::lock_guard<std::mutex> lock(mutex);
+		Chunk* chunk = new Chunk(static_cast<char*>(::operator new(bytes)), bytes);
+		chunk->used = bytes;
+		chunks.push_back(chunk);
+		return chunk->data;
+	}
+
+	while (true){
+		Chunk* chunk = head.load(std::memory_order_acquire);
+		if (chunk != nullptr){
+			size_t offset = chunk->used.fetch_add(bytes, std::memory_order_relaxed);
+			if (offset + bytes <= chunk->size){
+				return chunk->data + offset;
+			}
+		}
+		add_chunk(chunk);
+	}
+}
+
+void NodeArena::add_chunk(Chunk* full){
+	std::lock_guard<std::mutex> lock(mutex);
+	if (head.load(std::memory_order_relaxed) != full){
+		return; // another thread replaced the full chunk already
+	}
+	Chunk* chunk = new Chunk(take_chunk(), chunk_size);
+	chunks.push_back(chunk);
+	head.store(chunk, std::memory_order_release);
+}
+
+char* NodeArena::reuse(size_t bytes){
+	if (n_recycled.load(std::memory_order_relaxed) == 0){
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = recycled.find(bytes);
+	if (it == recycled.end() || it->second.empty()){
+		return nullptr;
+	}
+	char* block = it->second.back();
+	it->second.pop_back();
+	n_recycled.fetch_sub(1, std::memory_order_relaxed);
+	return block;
+}
+
+void NodeArena::recycle(char* block, size_t bytes){
+	std::lock_guard<std::mutex> lock(mutex);
+	recycled[bytes].push_back(block);
+	n_recycled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NodeArena::release(){
+	recycled.clear();
+	n_recycled.store(0, std::memory_order_relaxed);
+	for (Chunk* chunk : chunks){
+		if (chunk->size == chunk_size){
+			give_chunk(chunk->data);
+		}else{
+			::operator delete(chunk->data);
+		}
+		delete chunk;
+	}
+	chunks.clear();
+	head.store(nullptr, std::memory_order_release);
+}
+
+void NodeArena::reset(){
+	std::lock_guard<std::mutex> lock(mutex);
+	release();
+}
+
+size_t NodeArena::bytes_used() const{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t total = 0;
+	for (const Chunk* chunk : chunks){
+		size_t used = chunk->used.load(std::memory_order_relaxed);
+		total += (used < chunk->size ? used : chunk->size);
+	}
+	return total;
+}
+
+size_t NodeArena::bytes_reserved() const{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t total = 0;
+	for (const Chunk* chunk : chunks){
+		total += chunk->size;
+	}
+	return total;
+}
+
+/*================ Scope =============*/
+NodeArena::Scope::Scope(NodeArena* arena): previous{current_arena}{
+	current_arena = arena;
+}
+
+NodeArena::Scope::~Scope(){
+	current_arena = previous;
+}
+
+NodeArena* NodeArena::current(){
+	return current_arena;
+}
+
+/*================ node blocks =============*/
+void* NodeArena::allocate_node(NodeArena* arena, size_t bytes){
+	bytes = round_up(bytes) + header_size;
+	char* block = nullptr;
+	if (arena != nullptr){
+		block = arena->reuse(bytes);
+		if (block == nullptr){
+			block = static_cast<char*>(arena->allocate(bytes));
+		}
+	}else{
+		block = static_cast<char*>(::operator new(bytes));
+	}
+	Header* header = reinterpret_cast<Header*>(block);
+	header->arena = arena;
+	header->bytes = bytes;
+	return block + header_size;
+}
+
+void NodeArena::free_node(void* ptr){
+	if (ptr == nullptr){ return;}
+	char* block = static_cast<char*>(ptr) - header_size;
+	const Header* header = reinterpret_cast<const Header*>(block);
+	if (header->arena == nullptr){
+		::operator delete(block);
+	}else{
+		header->arena->recycle(block, header->bytes);
+	}
+}
+
+NodeArena* NodeArena::arena_of(const void* ptr){
+	return reinterpret_cast<const Header*>(static_cast<const char*>(ptr) - header_size)->arena;
+}
+
+} // namespace ethelo
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ethelo{
+
+/*
+	NodeArena is a bump allocator for the MathExprNodes of one MathProgram and
+	  their LinExp coefficients. Memory is carved out of large chunks and only
+	  given back to the heap all at once, when the arena is reset or destroyed.
+	  Blocks of deleted nodes and coefficients are kept by size and reused by
+	  the next block of the same size, so rewriting expressions in place
+	  (apply_mask, linearize) does not grow the arena.
+
+	Chunks given back go to a process-wide pool, so the program built for the
+	  next scenario reuses the memory of the previous one instead of asking
+	  the heap again.
+
+	Nodes are placed in an arena while it is installed on the constructing
+	  thread with NodeArena::Scope; otherwise they come from the heap as
+	  before. A LinExp puts its coefficients in the arena of its own block.
+	  Allocation is thread-safe, so the thread pool can translate into a
+	  shared arena.
+
+	Invariant: an arena outlives every node allocated from it. MathProgram
+	  destroys its trees before its arena, and nodes never move from one
+	  program to another (createImage and update copy them).
+*/
+
+class NodeArena{
+  public:
+	NodeArena() = default;
+	~NodeArena();	// returns the chunks to the pool
+
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator=(const NodeArena&) = delete;
+
+	// allocate(bytes) returns 16-byte aligned memory owned by the arena
+	void* allocate(size_t bytes);
+
+	// reset() forgets everything allocated so far; nothing allocated from
+	//   this arena may be used afterwards
+	void reset();
+
+	size_t bytes_used() const;		// handed out since the last reset
+	size_t bytes_reserved() const;	// held in chunks
+
+	// Scope installs an arena on the calling thread for its lifetime
+	class Scope{
+		NodeArena* previous;
+	  public:
+		explicit Scope(NodeArena* arena);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// the arena installed on the calling thread, or nullptr
+	static NodeArena* current();
+
+	/* allocate_node/free_node back MathExprNode::operator new/delete and the
+		LinExp coefficients: blocks come from arena, or the heap when it is
+		nullptr. free_node releases heap blocks and gives arena blocks back
+		to their arena for reuse.
+	*/
+	static void* allocate_node(NodeArena* arena, size_t bytes);
+	static void free_node(void* ptr);
+
+	// arena_of(ptr) returns the arena of a block from allocate_node, nullptr
+	//   for the heap
+	static NodeArena* arena_of(const void* ptr);
+
+	// size of the chunks that are pooled; larger requests get their own
+	static const size_t chunk_size = 64 * 1024;
+
+  private:
+	struct Chunk{
+		char* data;
+		size_t size;
+		std::atomic<size_t> used;
+
+		Chunk(char* data, size_t size): data{data}, size{size}, used{0} {}
+	};
+
+	std::atomic<Chunk*> head{nullptr};	// chunk allocations are bumped in
+	std::vector<Chunk*> chunks;			// every chunk, guarded by mutex
+	std::unordered_map<size_t, std::vector<char*>> recycled; // freed blocks by size, guarded by mutex
+	std::atomic<size_t> n_recycled{0};
+	mutable std::mutex mutex;
+
+	void add_chunk(Chunk* full);	// replaces head unless it is no longer full
+	char* reuse(size_t bytes);		// a freed block of that size, or nullptr
+	void recycle(char* block, size_t bytes);
+	void release();
+};
+
+} // namespace ethelo
@@ -64,6 +64,11 @@ QuadExprNode::QuadExprNode (const QuadExprNode& other):
 	A{other.A}, b{other.b}, c{other.c}
 		{}
 
+QuadExprNode::QuadExprNode (const QuadExprNode& other, const VarMask* VM):
+	MathExprNode{other.Type, VM},
+	A{other.A}, b{other.b}, c{other.c}
+		{}
+
 void QuadExprNode::add_linear(const LinExp* expr){
 	b += expr->get_coef();
 	c += expr->get_const();
@@ -119,4 +124,22 @@ AD QuadExprNode::evaluate( ADvector& x) const{
 	throw std::runtime_error{"QuadExprNode not supposed to be evaluated with AD"};
 } 
 
+ExprSparsity QuadExprNode::sparsity() const{
+	// x^T A x only depends on the symmetric part of A
+	ExprSparsity out;
+	for (size_t i=0; i<b.n_elem; i++){
+		if (b[i] != 0.0){ out.support.insert(i);}
+	}
+	for (size_t i=0; i<A.n_rows; i++){
+		for (size_t j=0; j<=i; j++){
+			if (A(i,j) + A(j,i) != 0.0){
+				out.support.insert(i);
+				out.support.insert(j);
+				out.hessian.insert(std::make_pair(i, j));
+			}
+		}
+	}
+	return out;
+}
+
 }// namespace ethelo
\ No newline at end of file
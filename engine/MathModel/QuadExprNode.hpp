@@ -24,6 +24,7 @@ class QuadExprNode: public MathExprNode{
   public :
 	QuadExprNode (MathExprNode* expr); // Also deletes expr
 	QuadExprNode (const QuadExprNode& other);
+	QuadExprNode (const QuadExprNode& other, const VarMask* VM);
 	
 	void add_linear(const LinExp* expr);
 	void add_product(const LinExp* expr1, const LinExp* expr2);
@@ -38,13 +39,14 @@ class QuadExprNode: public MathExprNode{
 	virtual NodeType decouple(int& code, std::vector<MathExprNode*> &args) override;
 	virtual MathExprNode* scale(double k) override; //multiply by constant
 	
-	virtual MathExprNode* deepcopy() const override{
-		return new QuadExprNode(*this);
+	virtual MathExprNode* copy_to(const VarMask* VM) const override{
+		return new QuadExprNode(*this, VM);
 	}
 	virtual bool is_similar(const MathExprNode* other) const override;
 	
 	virtual double evaluate( const arma::vec& x) const override; 
 	virtual AD evaluate( ADvector& x) const override; 
+	virtual ExprSparsity sparsity() const override;
 };
 
 } //namespace ethelo
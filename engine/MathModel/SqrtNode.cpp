@@ -42,6 +42,18 @@ AD SqrtNode::evaluate(ADvector& x) const{
 	return (negated? -1.0 : 1.0) * CppAD::sqrt(this->arg->evaluate(x));
 	}
 
+void SqrtNode::compile(ExprTape& tape) const{
+	this->arg->compile(tape);
+	tape.emit_sqrt(negated);
+}
+
+ExprSparsity SqrtNode::sparsity() const{
+	// d2 sqrt(f) = (d2f - df df^T / (2f)) / (2 sqrt(f))
+	ExprSparsity out = this->arg->sparsity();
+	out.add_cross(out.support, out.support);
+	return out;
+}
+
 
 
 void SqrtNode::save_content(std::ostream& out) const{
@@ -24,9 +24,11 @@ class SqrtNode: public MathExprNode{
 	virtual void print(std::ostream& out) const override;
 	virtual double evaluate( const arma::vec& x) const override;
 	virtual AD evaluate( ADvector& x) const override;
+	virtual void compile(ExprTape& tape) const override;
+	virtual ExprSparsity sparsity() const override;
 	virtual std::string getName() const override{ return "SqrtNode";}
-	virtual MathExprNode* deepcopy() const override{
-		return new SqrtNode(arg->deepcopy(), negated);
+	virtual MathExprNode* copy_to(const VarMask* VM) const override{
+		return new SqrtNode(arg->copy_to(VM), negated);
 	}
 	virtual bool is_similar(const MathExprNode* other) const override;
 	
@@ -57,6 +57,21 @@ AD SumNode::evaluate( ADvector& x) const{
 	
 }
 
+void SumNode::compile(ExprTape& tape) const{
+	for (MathExprNode* arg: this->argList){
+		arg->compile(tape);
+	}
+	tape.emit_add(argList.size());
+}
+
+ExprSparsity SumNode::sparsity() const{
+	ExprSparsity out;
+	for (MathExprNode* arg: this->argList){
+		out.merge(arg->sparsity());
+	}
+	return out;
+}
+
 bool SumNode::is_quadratic() const {
 	for (MathExprNode* arg: this->argList){
 		if (!(arg->is_quadratic())) { return false;}
@@ -81,10 +96,10 @@ MathExprNode::NodeType SumNode::decouple(int& code, std::vector<MathExprNode*> &
 	return MathExprNode::NodeType::SumNode;
 }
 
-MathExprNode* SumNode::deepcopy() const{
+MathExprNode* SumNode::copy_to(const VarMask* VM) const{
 	vector<MathExprNode*> tempArgs(this->argList.size());
 	for (int i=0; i<argList.size(); i++){
-		tempArgs[i] = this->argList[i]->deepcopy();
+		tempArgs[i] = this->argList[i]->copy_to(VM);
 	}
 	
 	return new SumNode(std::move(tempArgs));
@@ -21,11 +21,13 @@ class SumNode : public MathExprNode{
 	virtual void print(std::ostream& out) const override;
 	virtual double evaluate( const arma::vec& x) const override;
 	virtual AD evaluate( ADvector& x) const override;
+	virtual void compile(ExprTape& tape) const override;
+	virtual ExprSparsity sparsity() const override;
 	virtual bool is_quadratic() const override;
 	virtual NodeType decouple(int& code, std::vector<MathExprNode*> &args) override;
 	virtual std::string getName() const override{ return "SumNode";}
 	
-	virtual MathExprNode* deepcopy() const override;
+	virtual MathExprNode* copy_to(const VarMask* VM) const override;
 	
 	// expr should be treated as invalid after calling appendTerm(expr)
 	void appendTerm(MathExprNode* expr);// may destroy expr
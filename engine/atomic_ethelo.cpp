@@ -51,12 +51,24 @@ namespace ethelo
 			}
 			assert(pos == x_dim);
 		}
+		
+		x_expanded = x_init;
+		grad.resize(x_dim);
+		hess.resize(x_dim * (x_dim + 1) / 2);
+	}
+
+	void atomic_ethelo::expand(const vector<double>& tx, size_t n_order){
+		// copies into the existing storage of x_expanded
+		x_expanded = x_init;
+		for (int i=0;i<x_dim;i++){
+			x_expanded[expand_mask[i]] = tx[i*n_order+0];
+		}
 	}
 
 	double atomic_ethelo::evaluate(const arma::vec& x){
 		assert(x.n_elem == x_dim);
 		
-		arma::vec x_expanded(x_init);
+		x_expanded = x_init;
 		for (int i=0;i<x_dim; i++){
 			x_expanded[expand_mask[i]] = x[i];
 		}
@@ -70,19 +82,9 @@ namespace ethelo
                                 const vector<double>&    tx ,
                                 vector<double>&          ty )
     {
-        double eps = 10.0 * std::numeric_limits<double>::epsilon();
-
         // Set up some dimensions
         size_t n_order  = q + 1;             // number of Taylor coefficients
-        size_t n = p_->dim();      // number of active options
         assert(x_dim == tx.size() / n_order);      // number of variables
-        size_t m = ty.size() / n_order;      // range (should be scalar)
-
-        // Extract the relevant influent matrix and configuration
-        auto influents = p_->influents();
-        auto config = p_->config();
-
-        size_t N = influents.n_rows;   // number of respondents
 
         // return flag
         bool ok = q <= 1;
@@ -100,14 +102,10 @@ namespace ethelo
         // Extract the point of evaluation, dimension should be same 
 		//   as number of active options 
         // Note that the Taylor coefficients are strided uf q>0
-
-		arma::vec x(x_init);
-		for (int i=0;i<x_dim;i++){
-			x[expand_mask[i]] = tx[i*n_order+0]; 
-		}
+		expand(tx, n_order);
 
 		// compute ethelo value
-		const double ethelo = evalCore.eval(x, true);
+		const double ethelo = evalCore.eval(x_expanded, true);
 
         // Now the atomic AD function stuff:
 
@@ -122,20 +120,19 @@ namespace ethelo
         // This case needed if first order forward mode is used.
         // y^1 = f'( x^0 ) x^1
 
-        // Here we need the dot product of the gradient of Ethelo and x^1
-
-		arma::vec x1(n, arma::fill::zeros);
-		for (int i=0;i<x_dim;i++){
-			x1[expand_mask[i]] = tx[i*n_order+1];
-		}
-
-		// compute gradient, x was seen by evalCore in ethelo value computation
-		const arma::vec grad = evalCore.gradient(x, false);
+		// compute gradient wrt. the free variables, x was seen by evalCore 
+		//   in ethelo value computation
+		evalCore.gradient(x_expanded, false, expand_mask, grad.data());
 
         // More of the atomic AD stuff: compute the dot product of the
-        // gradient with x^1
-        if( p <= 1 )
-          ty[0*n_order+1] = arma::dot(grad,x1); // f'( x^0 ) * x^1
+        // gradient with x^1; fixed variables have no x^1 component
+        if( p <= 1 ){
+			double dot = 0.0;
+			for (int i=0;i<x_dim;i++){
+				dot += grad[i] * tx[i*n_order+1];
+			}
+			ty[0*n_order+1] = dot; // f'( x^0 ) * x^1
+		}
         if( q <= 1 )
             return ok;
 
@@ -150,54 +147,44 @@ namespace ethelo
                                 vector<double>&             px ,
                                 const vector<double>&       py )
     {
-        double eps = 10.0 * std::numeric_limits<double>::epsilon();
-
         // Set up some dimensions
         size_t n_order  = q + 1;
-		size_t n = p_->dim();
 		assert(x_dim == tx.size() / n_order);
-        size_t m = ty.size() / n_order;
-
-        // Extract the relevant influent matrix and configuration
-        auto influents = p_->influents();
-        auto config = p_->config();
-
-        size_t N = influents.n_rows;   // number of respondents
 
         // Return flag
         bool ok = q <= 1;
 
-        // Extract the point of evaluation and the first order X(t) sensitivities
-		
-		arma::vec x(x_init), x1(n, arma::fill::zeros);
-		for (int i=0;i<x_dim;i++){
-			x[expand_mask[i]] = tx[i*n_order + 0];
-			if (q>0){
-				x1[expand_mask[i]]= tx[i*n_order + 1];
-			}
-		}
+        // Extract the point of evaluation
+		expand(tx, n_order);
 		
-		// compute gradient
-		const arma::vec grad = evalCore.gradient(x, true);
+		// compute gradient wrt. the free variables
+		evalCore.gradient(x_expanded, true, expand_mask, grad.data());
 
         // Now for the atomic AD stuff
         switch(q) {
         case 0:
             // Zero-th order reverse mode
 			for (int i=0;i<x_dim;i++){
-				px[i] = py[0]*grad[expand_mask[i]];
+				px[i] = py[0]*grad[i];
 			}
             assert(ok);
             break;
 			
         case 1: 
 			// First order reverse mode
-			// also compute hessian; x was seen by evalCore in gradient computation
-			const arma::mat hess = evalCore.hessian(x, false);
+			// also compute the lower triangle of the hessian; x was seen by 
+			//   evalCore in gradient computation
+			evalCore.hessian(x_expanded, false, expand_mask, 1.0, hess.data());
 			
 			for (int j=0;j<x_dim;j++){
-				px[j*n_order+0] = py[0]*grad[expand_mask[j]] + py[1]*arma::dot(hess.row(expand_mask[j]), x1);
-				px[j*n_order+1] = py[1]*grad[expand_mask[j]];
+				// row j of the hessian times the first order sensitivities x^1
+				double hx1 = 0.0;
+				for (int i=0;i<x_dim;i++){
+					const double h = (i <= j) ? hess[j*(j+1)/2 + i] : hess[i*(i+1)/2 + j];
+					hx1 += h * tx[i*n_order + 1];
+				}
+				px[j*n_order+0] = py[0]*grad[j] + py[1]*hx1;
+				px[j*n_order+1] = py[1]*grad[j];
 			}
 
             assert(ok);
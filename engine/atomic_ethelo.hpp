@@ -12,7 +12,14 @@ namespace ethelo
 		arma::vec x_init;
 		nuclear_ethelo evalCore;
 		
+		// work buffers, sized once in initialize() so that forward and
+		//   reverse sweeps do not allocate
+		arma::vec x_expanded;
+		std::vector<double> grad, hess;
+		
 		void initialize(const MathProgram* MP=nullptr);
+		// expand(tx, n_order) copies the zero order coefficients into x_expanded
+		void expand(const CppAD::vector<double>& tx, size_t n_order);
 		
     public:
         // constructor
@@ -11,7 +11,8 @@ namespace ethelo
                       bool support_only = false,
                       bool per_option_satisfaction = false,
                       bool normalize_influents = false,
-                      size_t histogram_bins = 5)
+                      size_t histogram_bins = 5,
+                      size_t enumeration_limit = 18)
           : collective_identity(collective_identity),
             tipping_point(tipping_point),
             minimize(minimize),
@@ -19,7 +20,8 @@ namespace ethelo
             support_only(support_only),
             per_option_satisfaction(per_option_satisfaction),
             normalize_influents(normalize_influents),
-            histogram_bins(histogram_bins)
+            histogram_bins(histogram_bins),
+            enumeration_limit(enumeration_limit)
         {};
 
         double collective_identity;
@@ -30,5 +32,6 @@ namespace ethelo
         bool per_option_satisfaction;
         bool normalize_influents;
         size_t histogram_bins;
+        size_t enumeration_limit;   // most free options solved by enumeration instead of CBC/Bonmin
     };
 }
@@ -8,58 +8,59 @@ namespace ethelo
 
     constraint::constraint(const std::string& name, const std::string& source, const bool &relaxable)
         : expression(CONSTRAINT, name, source), relaxable_(relaxable)
-    { compile();};
+    {};
 
     constraint::constraint(const constraint& other)
         : expression(other), relaxable_(other.relaxable_)
-    { compile();}
+    {}
 
     constraint::constraint(constraint&& other)
-        : expression(std::move(other)), relaxable_(std::move(other.relaxable_)),lbound_(std::move(other.lbound_)), ubound_(std::move(other.ubound_))
+        : expression(std::move(other)), relaxable_(std::move(other.relaxable_))
     {}
 
     constraint& constraint::operator=(const constraint& other)
-    { expression::operator=(other); compile(); return *this; }
-
-    void constraint::compile()
     {
-        if (!valid()) return;
+        expression::operator=(other);
+        relaxable_ = other.relaxable_;
+        return *this;
+    }
 
-        auto root = ast();
-        if (root->getType(root) != TOK_INEQ)
-            throw syntax_error(*this, root, "TypeError", "expected constraint expression");
+    void constraint::compile(const expression& expr, const syntax_node* root, bound& lower, bound& upper)
+    {
+        lower = bound();
+        upper = bound();
 
-        for (int i = 0; i < root->getChildCount(root); i++)
+        for (size_t i = 0; i < root->child_count(); i++)
         {
-            auto child = (pANTLR3_BASE_TREE)root->getChild(root, i);
-            auto type = child->getType(child);
+            auto child = root->child(i);
+            auto type = child->type();
             if (type == TOK_LEQ || type == TOK_GEQ || type == TOK_EQ)
-                compile_bound(child);
+                compile_bound(expr, child, lower, upper);
         }
 
-        if (!lbound_ && !ubound_)
-            throw semantic_error(*this, root, "NoBound", "expression is unbounded");
+        if (!lower && !upper)
+            throw semantic_error(expr, root, "NoBound", "expression is unbounded");
     }
 
-    void constraint::compile_bound(pANTLR3_BASE_TREE node)
+    void constraint::compile_bound(const expression& expr, const syntax_node* node, bound& lower, bound& upper)
     {
-        if (node->getChildCount(node) <= 0) return;
-        double value = expression::to_float((pANTLR3_BASE_TREE)node->getChild(node, 0));
+        if (node->child_count() <= 0) return;
+        double value = expression::to_float(node->child(0));
 
-        switch (node->getType(node))
+        switch (node->type())
         {
         case TOK_GEQ:
-            if (lbound_) throw semantic_error(*this, node, "DuplicateBound", "duplicate lower bound");
-            lbound_.set(value);
+            if (lower) throw semantic_error(expr, node, "DuplicateBound", "duplicate lower bound");
+            lower.set(value);
             break;
         case TOK_LEQ:
-            if (ubound_) throw semantic_error(*this, node, "DuplicateBound", "duplicate upper bound");
-            ubound_.set(value);
+            if (upper) throw semantic_error(expr, node, "DuplicateBound", "duplicate upper bound");
+            upper.set(value);
             break;
         case TOK_EQ:
-            if (lbound_ || ubound_) throw semantic_error(*this, node, "DuplicateBound", "equality mixed with inequality");
-            lbound_.set(value);
-            ubound_.set(value);
+            if (lower || upper) throw semantic_error(expr, node, "DuplicateBound", "equality mixed with inequality");
+            lower.set(value);
+            upper.set(value);
             break;
 
         default:
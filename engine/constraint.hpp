@@ -2,24 +2,15 @@
 
 namespace ethelo
 {
-    struct bound
-    {
-        double value = 0.0;
-        bool enabled = false;
-
-        void set(double value) { this->value = value; enabled = true; }
-
-        operator bool() const { return enabled; }
-        double get() const { return value; }
-    };
-
     class constraint : public expression
     {
+        friend class expression;
+
         bool relaxable_;
-        bound lbound_, ubound_;
 
-        void compile();
-        void compile_bound(pANTLR3_BASE_TREE node);
+        // called by expression::parse before the tree is published
+        static void compile(const expression& expr, const syntax_node* root, bound& lower, bound& upper);
+        static void compile_bound(const expression& expr, const syntax_node* node, bound& lower, bound& upper);
 
     public:
         constraint();
@@ -29,8 +20,8 @@ namespace ethelo
         virtual ~constraint() {};
         constraint& operator=(const constraint& other);
 
-        const bound& lbound() const { return lbound_; }
-        const bound& ubound() const { return ubound_; }
+        const bound& lbound() const { return lower_bound(); }
+        const bound& ubound() const { return upper_bound(); }
         bool is_relaxable() const { return relaxable_; }
     };
 }
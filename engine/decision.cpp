@@ -30,10 +30,10 @@ namespace ethelo
 
     decision::decision(decision&& other)
         : problem(std::move(other)),
-          criteria_(std::move(other.criteria_)),
-          influents_(std::move(other.influents_)),
-          weights_(std::move(other.weights_)),
-          local_weights_(std::move(other.local_weights_)),
+          criteria_(other.criteria_),
+          influents_(other.influents_),
+          weights_(other.weights_),
+          local_weights_(other.local_weights_),
           sat_range_(other.sat_range_),
           sat_min_(other.sat_min_),
           sat_max_(other.sat_max_)
@@ -66,9 +66,9 @@ namespace ethelo
             throw std::invalid_argument("a decision must have at least one option");
 
         if (criteria.size() != 0)
-            criteria_.load(criteria);
+            criteria_.reset().load(criteria);
         else
-            criteria_.load({criterion("default")});
+            criteria_.reset().load({criterion("default")});
         
         // Load & configure problem and load influents & weights
         problem::operator=(problem(options, fragments, constraints, displays));
@@ -122,6 +122,11 @@ namespace ethelo
     }
 
     void decision::load(const arma::mat& influents, const arma::mat& weights)
+    {
+        load(influents, null_bitmap(influents, null_vote), weights);
+    }
+
+    void decision::load(const arma::mat& influents, const null_bitmap& nulls, const arma::mat& weights)
     {
         size_t num_options = options().size();
         size_t num_criteria = criteria().size();
@@ -137,7 +142,6 @@ namespace ethelo
             if (weights.n_rows != influents.n_rows)
                 throw std::invalid_argument("number of weight matrix rows does not match number of influent matrix rows");
             weights_ = arma::mat(arma::normalise(arma::clamp(arma::mat(weights), 0.0, 1.0), 1, 1));
-            local_weights_ = arma::mat(arma::normalise(arma::clamp(arma::mat(transform_weights(influents, weights)), 0.0, 1.0), 1, 1));
         }
 
         if (influents.size() == 0) {
@@ -148,15 +152,20 @@ namespace ethelo
         else {
             if (influents.n_cols != num_options * num_criteria)
                 throw std::invalid_argument("number of influent matrix columns does not match [number of options] * [number of criteria]");
+            if (nulls.n_rows() != influents.n_rows || nulls.n_cols() != influents.n_cols)
+                throw std::invalid_argument("null vote bitmap does not match the influent matrix");
 
             // Transform the null votes to zero (among other things)
-            influents_ = arma::clamp(transform_nullvotes(influents), -1.0, 1.0);
+            arma::mat masked_weights;
+            influents_ = transform_votes(influents, nulls, weights, masked_weights);
+            if (weights.size() != 0)
+                local_weights_ = arma::mat(arma::normalise(arma::clamp(masked_weights, 0.0, 1.0), 1, 1));
 
             arma::mat problem_influents(influents_.n_rows, num_options);
             for (size_t i = 0; i < num_options; i++)
                 problem_influents.col(i)
-                    = arma::sum(weights_.cols(i * num_criteria, (i + 1) * num_criteria - 1) %
-                                influents_.cols(i * num_criteria, (i + 1) * num_criteria - 1), 1);
+                    = arma::sum(weights_->cols(i * num_criteria, (i + 1) * num_criteria - 1) %
+                                influents_->cols(i * num_criteria, (i + 1) * num_criteria - 1), 1);
 
             if (config().normalize_influents)
                 problem::load(arma::mat(arma::normalise(arma::mat(problem_influents), 1, 1)));
@@ -199,10 +208,10 @@ namespace ethelo
         arma::mat normalized_weights;
 
         if (global)
-            normalized_weights = arma::mat(weights_);
+            normalized_weights = *weights_;
         else {
-            normalized_weights = arma::mat(local_weights_);
-            normalized_weights %= arma::repmat(x.t(), local_weights_.n_rows, 1);
+            normalized_weights = *local_weights_;
+            normalized_weights %= arma::repmat(x.t(), local_weights_->n_rows, 1);
         }
 
         normalized_weights = arma::normalise(normalized_weights, 1, 1);
@@ -214,8 +223,8 @@ namespace ethelo
         if (influents().size() == 0)
             throw std::runtime_error("no influent data");
 
-        arma::mat localized_weights = arma::mat(local_weights_);
-        localized_weights %= arma::repmat(expand(x).t(), local_weights_.n_rows, 1);
+        arma::mat localized_weights = *local_weights_;
+        localized_weights %= arma::repmat(expand(x).t(), local_weights_->n_rows, 1);
         return arma::find(arma::clamp(arma::ceil(arma::vec(arma::max(arma::abs(arma::mat(localized_weights)), 1))), 0.0, 1.0));
     }
 
@@ -243,76 +252,71 @@ namespace ethelo
       return arma::find(null_voted_options_);
     }
 
-    arma::vec decision::vote_counts(const arma::mat& influents) const
+    /*
+        Null votes are replaced by the average of their column, counting the
+        null entries themselves at the replacement value (0, or 1/2 with
+        support_only); options nobody voted on get the replacement value minus
+        a small penalty. In columns holding only null and neutral votes, the
+        neutral votes are penalized the same way. Results are clamped to
+        [-1, 1], and the weights of null votes are zeroed in masked_weights
+        when weights are given.
+
+        Every column is read once for its counts, sum and neutrality and then
+        written while still in cache, without matrix-sized temporaries.
+    */
+    arma::mat decision::transform_votes(const arma::mat& influents, const null_bitmap& nulls,
+                                        const arma::mat& weights, arma::mat& masked_weights)
     {
-      arma::mat votes_status(influents);
-      votes_status.transform([](double val) {
-          return std::abs(val - null_vote) <= std::numeric_limits<double>::epsilon()
-              ? 0.0 : 1.0;
-      });
-
-      return arma::vec(arma::sum(votes_status).t());
-    }
+        const double eps = std::numeric_limits<double>::epsilon();
+        const double replacement = config().support_only
+            ? NULL_VOTE_SUPPORT_ONLY_REPLACEMENT_VALUE : NULL_VOTE_REPLACEMENT_VALUE;
+        const size_t num_rows = influents.n_rows;
+        const size_t num_columns = influents.n_cols;
+        const size_t num_criteria = criteria_->size();
+        const bool mask = weights.size() != 0;
+
+        arma::mat transformed(num_rows, num_columns);
+        if (mask) masked_weights = weights;
+        null_voted_options_.ones(num_columns / num_criteria);
+        neutral_voted_options_.set_size(num_columns);
+
+        for (size_t c = 0; c < num_columns; c++) {
+            const double* in = influents.colptr(c);
+            double* out = transformed.colptr(c);
+
+            size_t count = 0;
+            double sum = 0.0;
+            bool neutral = true;
+            for (size_t r = 0; r < num_rows; r++) {
+                double vote = replacement;
+                if (!nulls.test(r, c)) {
+                    vote = in[r];
+                    count++;
+                }
+                sum += vote;
+                neutral = neutral && std::abs(vote - replacement) <= eps;
+            }
 
-    arma::mat decision::transform_nullvotes(const arma::mat& influents)
-    {
-        // Get the (linear) indices of the null entries
-        arma::uvec inds = arma::find(arma::abs(influents - null_vote) <= std::numeric_limits<double>::epsilon());
-
-        double null_vote_replacement_value = NULL_VOTE_REPLACEMENT_VALUE;
-        if(config().support_only)
-          null_vote_replacement_value = NULL_VOTE_SUPPORT_ONLY_REPLACEMENT_VALUE;
-
-        // Copy the influents matrix and replace the null votes with
-        arma::mat votes_transformed(influents);
-        votes_transformed(inds).fill(null_vote_replacement_value);
-
-        arma::vec votes_counts = vote_counts(influents);
-
-        size_t num_criteria = criteria_.size();
-        arma::mat vote_counts_per_option = arma::sum(arma::reshape(votes_counts, num_criteria, votes_counts.size() / num_criteria));
-        null_voted_options_ = arma::vec(vote_counts_per_option.transform([](double val) {
-            return val > 0.0 ? 0.0 : 1.0; 
-        }).t());
-
-        arma::vec votes_averages = arma::vec(arma::sum(votes_transformed).t());
-        for (size_t i = 0; i < votes_averages.size(); i++) {
-            if(votes_counts(i) > 0.0) {
-                votes_averages(i) = votes_averages(i) /  votes_counts(i);
-            } else {
-                // if an option hasn't been voted on at all, adjust to prefer it less than a neutral vote 
-                votes_averages(i) = null_vote_replacement_value + NULL_VOTE_NOMINAL_PENALTY;
+            // if an option hasn't been voted on at all, adjust to prefer it less than a neutral vote
+            const double average = count > 0 ? sum / count : replacement + NULL_VOTE_NOMINAL_PENALTY;
+            if (count > 0) null_voted_options_(c / num_criteria) = 0.0;
+            neutral_voted_options_(c) = neutral;
+
+            double* w = mask ? masked_weights.colptr(c) : nullptr;
+            for (size_t r = 0; r < num_rows; r++) {
+                double vote;
+                if (nulls.test(r, c)) {
+                    vote = average;
+                    if (w) w[r] = 0.0;
+                }
+                else if (neutral)
+                    vote = replacement + NEUTRAL_VOTE_NOMINAL_PENALTY;
+                else
+                    vote = in[r];
+                out[r] = std::min(1.0, std::max(-1.0, vote));
             }
         }
-
-        // Find all neutral voted options (i.e. the original influent
-        // values equal to zero when the range is [-1,1] or 1/2 when
-        // the range is [0,1])
-        arma::umat pure_neutral_votes = arma::abs(influents-null_vote_replacement_value) <= std::numeric_limits<double>::epsilon();
-
-        // Find the mixed columns containing only null or neutral votes
-        neutral_voted_options_ = arma::all(arma::abs(votes_transformed-null_vote_replacement_value) <= std::numeric_limits<double>::epsilon()).t();
-
-        // Set the pure neutral vote columns with valid (non-null or neutral) entries to zero
-        pure_neutral_votes.cols(arma::find(neutral_voted_options_ == 0)).zeros();
-
-        // Find the remaining neutral vote (linear) indices. These are
-        // the entries that should be peanalized
-        arma::uvec mixed_neutral_null_votes = arma::find(pure_neutral_votes);
-
-        // Set the neutral voted entries to some small negative number
-        votes_transformed(mixed_neutral_null_votes).fill(null_vote_replacement_value + NEUTRAL_VOTE_NOMINAL_PENALTY);
-
-        // Replace each null vote with its column average.
-        votes_transformed(inds) = votes_averages(inds/influents.n_rows);
-        return votes_transformed;
-    }
-
-    arma::mat decision::transform_weights(const arma::mat& influents, const arma::mat& weights) const
-    {
-        arma::mat weights_transformed(weights);
-        weights_transformed(arma::find( arma::abs(influents - null_vote) <= std::numeric_limits<double>::epsilon())).zeros();
-        return weights_transformed;
+        return transformed;
     }
 
     inline double ethelo_function(double support, double dissonance, double collective_identity, double tipping_point) {
@@ -333,6 +337,7 @@ namespace ethelo
 
     stats decision::statistics(arma::vec x, bool global) const
     {
+        ETHELO_PROFILE_SPAN("statistics");
         stats statistics;
 
         // Dimensions sanity check
@@ -449,4 +454,10 @@ namespace ethelo
         PLOGD << "Solve complete";
         return s;
     }
+
+    size_t decision::matrix_bytes() const {
+        return problem::matrix_bytes()
+            + (influents_->n_elem + weights_->n_elem + local_weights_->n_elem + null_voted_options_.n_elem) * sizeof(double)
+            + neutral_voted_options_.n_elem * sizeof(arma::uword);
+    }
 }
@@ -4,10 +4,11 @@ namespace ethelo
 {
     class decision : public problem
     {
-        indexed_vector<criterion> criteria_;
-        arma::mat influents_;
-        arma::mat weights_;
-        arma::mat local_weights_;
+        // loaded data is immutable and shared between copies of a decision
+        shared<indexed_vector<criterion>> criteria_;
+        shared<arma::mat> influents_;
+        shared<arma::mat> weights_;
+        shared<arma::mat> local_weights_;
         arma::vec null_voted_options_;
         arma::uvec neutral_voted_options_;
         bool sat_range_;
@@ -33,10 +34,8 @@ namespace ethelo
         arma::vec satisfaction(arma::vec x, bool global=false) const;
 
         arma::uvec null_vote_option_indices() const;
-        arma::vec vote_counts(const arma::mat& influents) const;
-        arma::mat transform_nullvotes(const arma::mat& influents);
-        arma::mat transform_weights(const arma::mat& influents, const arma::mat& weights) const;
-        arma::uvec transform_neutralvotes(const arma::mat& influents);
+        arma::mat transform_votes(const arma::mat& influents, const null_bitmap& nulls,
+                                  const arma::mat& weights, arma::mat& masked_weights);
 
     public:
         decision();
@@ -54,15 +53,19 @@ namespace ethelo
         virtual ~decision() {};
         decision& operator=(const decision& other);
 
+        // influents holding null_vote for null entries
         void load(const arma::mat& influents, const arma::mat& weights);
+        void load(const arma::mat& influents, const null_bitmap& nulls, const arma::mat& weights);
         void configure(const configuration& config);
 
         stats statistics(arma::vec x, bool global=false) const;
         solution solve();
 
-        const indexed_vector<criterion>& criteria() const { return criteria_; }
-        const arma::mat& influents() const { return influents_; }
-        const arma::mat& weights() const { return weights_; }
+        const indexed_vector<criterion>& criteria() const { return *criteria_; }
+        const arma::mat& influents() const { return *influents_; }
+        const arma::mat& weights() const { return *weights_; }
+
+        size_t matrix_bytes() const override;
     };
 
     constexpr double null_vote = 2.0f;
@@ -0,0 +1,46 @@
+#pragma once
+
+namespace ethelo
+{
+    // detail_table stores the details of a list of options by column: every
+    // detail name is interned once and maps to a dense column of values over
+    // the options, 0 for options without that detail
+    class detail_table
+    {
+        std::unordered_map<std::string, size_t> index_;
+        std::vector<std::string> names_;
+        std::vector<double> values_; // column c holds values_[c * n_options_ ... (c + 1) * n_options_)
+        size_t n_options_ = 0;
+
+    public:
+        detail_table() {}
+        explicit detail_table(const indexed_vector<option>& options)
+            : n_options_(options.size())
+        {
+            for (const auto& opt : options)
+                for (const auto& d : opt.details())
+                    if (index_.emplace(d.name(), names_.size()).second)
+                        names_.push_back(d.name());
+
+            values_.assign(names_.size() * n_options_, 0.0);
+            for (size_t i = 0; i < n_options_; i++)
+                for (const auto& d : options[i].details())
+                    values_[index_[d.name()] * n_options_ + i] = d.value();
+        }
+
+        // find(name) returns the column of a detail, -1 if no option has it
+        std::ptrdiff_t find(const std::string& name) const {
+            auto iter = index_.find(name);
+            return (iter != index_.end()) ? iter->second : -1;
+        }
+
+        size_t size() const { return names_.size(); }
+        size_t n_options() const { return n_options_; }
+        const std::string& name(size_t column) const { return names_[column]; }
+        const double* column(size_t column) const { return values_.data() + column * n_options_; }
+        double value(std::ptrdiff_t column, size_t option) const {
+            return column >= 0 ? values_[column * n_options_ + option] : 0.0;
+        }
+        size_t bytes() const { return values_.size() * sizeof(double); }
+    };
+}
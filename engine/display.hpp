@@ -4,8 +4,6 @@ namespace ethelo
 {
     class display : public expression
     {
-        void compile();
-
     public:
         display();
         display(const std::string& name, const std::string& source);
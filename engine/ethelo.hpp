@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <array>
 #include <vector>
 #include <map>
@@ -19,9 +21,16 @@
 
 #include "meta.hpp"
 #include "util.hpp"
+#include "thread_pool.hpp"
+#include "span_timer.hpp"
+#include "memory_usage.hpp"
+#include "vote_store.hpp"
+#include "syntax_node.hpp"
 #include "expression.hpp"
+#include "native_parser.hpp"
 #include "detail.hpp"
 #include "option.hpp"
+#include "detail_table.hpp"
 #include "fragment.hpp"
 #include "constraint.hpp"
 #include "display.hpp"
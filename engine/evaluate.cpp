@@ -29,89 +29,41 @@ namespace ethelo
     }
 
 
-	void evaluator::translate(
-			const FixVar_Mask* FVmask,
-			std::vector<MathExprNode*>& arr,
-			std::vector<std::set<std::string>>& detail_sets) const
-		{
-			
-		if (!valid()) throw std::runtime_error("use of uninitialized evaluator");
-		assert(FVmask != nullptr && FVmask->is_simple());
-		assert(FVmask->n_var_orig() == p_->dim());
-		
-		arr.resize(p_->constraints().size() + p_->exclusions().n_rows);
-		detail_sets.resize(p_->constraints().size());
-
-		const int n = p_->dim();
-
-		// Set up x vector 
-		// ADvector x(n);
-		// for (int i=0;i<n;i++){
-			// x[i] = FVmask->get_xVec().at(i);
-		// }
-		const std::vector<double>& x =  FVmask->get_xVec();
-		// FVmask->copyX(x);
-
-		// Extract trees for constraints
-        for (int i = 0; i < p_->constraints().size(); i++) {
-            const auto& cons = p_->constraints()[i];
-            bool encountered_blacklisted_detail = false;
-			
-            arr[i] = translate_expr(Masked_context(*p_, cons, x, FVmask, detail_sets[i]),encountered_blacklisted_detail);
-			
-            // Test if we encountered a blacklisted detail, and if the constraint is relaxible, we relax the constraint.
-            if(encountered_blacklisted_detail && cons.is_relaxable()){
-				delete arr[i];
-                arr[i] = nullptr;
-            }
-        }
-		
-		//int id;
-		std::set<std::string> foo;
-		
-		//Extract Trees for exclusions
-        for (int i = 0; i < p_->exclusions().n_rows; i++){			
-            arr[p_->constraints().size() + i] = 
-				translate_exclusion(
-					Masked_context(*p_, expression(), x, FVmask,foo), 
-					arma::vectorise(arma::mat(p_->exclusions().row(i))));
-							
+	MathExprNode* evaluator::translate_constraint(const FixVar_Mask* FVmask, size_t i, std::set<std::string>& detail_set) const{
+		ETHELO_PROFILE_SPAN("translate_constraint");
+		const auto& cons = p_->constraints()[i];
+		bool encountered_blacklisted_detail = false;
+
+		MathExprNode* node = translate_expr(Masked_context(*p_, cons, FVmask->get_xVec(), FVmask, detail_set),encountered_blacklisted_detail);
+
+		// Test if we encountered a blacklisted detail, and if the constraint is relaxible, we relax the constraint.
+		if(encountered_blacklisted_detail && cons.is_relaxable()){
+			delete node;
+			node = nullptr;
 		}
+		return node;
 	}
-	
-	void evaluator::translate_displays(const FixVar_Mask* FVmask, std::vector<MathExprNode*>& arr) const{
-		if (!valid()) throw std::runtime_error("use of uninitialized evaluator");
-		assert(FVmask != nullptr && FVmask->is_simple());
-		assert(FVmask->n_var_orig() == p_->dim());
-		
-		arr.resize(p_->displays().size());
-
-		const int n = p_->dim();
 
-		// Set up x vector 
-		// ADvector x(n);
-		// for (int i=0;i<n;i++){
-			// x[i] = FVmask->get_xVec().at(i);
-		// }
-		const std::vector<double>& x =  FVmask->get_xVec();
+	MathExprNode* evaluator::translate_exclusion(const FixVar_Mask* FVmask, size_t i) const{
+		ETHELO_PROFILE_SPAN("translate_exclusion");
+		std::set<std::string> foo;
+		return translate_exclusion(
+			Masked_context(*p_, expression(), FVmask->get_xVec(), FVmask, foo),
+			arma::vectorise(arma::mat(p_->exclusions().row(i))));
+	}
 
-		// Extract trees for display values
-		
-        bool encountered_blacklisted_detail = false;
+	MathExprNode* evaluator::translate_display(const FixVar_Mask* FVmask, size_t i) const{
+		ETHELO_PROFILE_SPAN("translate_display");
+		bool encountered_blacklisted_detail = false;
 		std::set<std::string> foo;
-        for (int i = 0; i < p_->displays().size(); i++) {
-            const auto& expr = p_->displays()[i];
-			
-            arr[i] = translate_expr(Masked_context(*p_, expr, x, FVmask, foo),encountered_blacklisted_detail);
-		
-        }
+		return translate_expr(Masked_context(*p_, p_->displays()[i], FVmask->get_xVec(), FVmask, foo),encountered_blacklisted_detail);
 	}
 
-    size_t evaluator::compile_array(const context& ctx, pANTLR3_BASE_TREE node) const
+    size_t evaluator::compile_array(const context& ctx, const syntax_node* node) const
     {
         size_t index = -1;
-        auto child = (pANTLR3_BASE_TREE)node->getChild(node, 0);
-        switch (child->getType(child))
+        auto child = node->child(0);
+        switch (child->type())
         {
         case TOK_INTEGER:
             index = expression::to_integer(child);
@@ -177,32 +129,32 @@ namespace ethelo
 		return translate_expr(Mctx, Mctx.expr.ast(), encountered_blacklisted_detail);
 	}
 
-	MathExprNode* evaluator::translate_expr( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
+	MathExprNode* evaluator::translate_expr( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
 
 
-        switch (node->getType(node))
+        switch (node->type())
         {
         case TOK_INEQ:
-            return translate_expr(Mctx, (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_EXPR), encountered_blacklisted_detail);
+            return translate_expr(Mctx, node->first_child(TOK_EXPR), encountered_blacklisted_detail);
         case TOK_EXPR:
-            return translate_expr(Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 0), encountered_blacklisted_detail);
+            return translate_expr(Mctx, node->child(0), encountered_blacklisted_detail);
 
 		case TOK_PLUS:
 			return MExprAdd(
-				translate_expr( Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 0), encountered_blacklisted_detail),
-				translate_expr( Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 1), encountered_blacklisted_detail));
+				translate_expr( Mctx, node->child(0), encountered_blacklisted_detail),
+				translate_expr( Mctx, node->child(1), encountered_blacklisted_detail));
 		case TOK_MINUS:
 			return MExprSub(
-				translate_expr( Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 0), encountered_blacklisted_detail),
-				translate_expr( Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 1), encountered_blacklisted_detail));
+				translate_expr( Mctx, node->child(0), encountered_blacklisted_detail),
+				translate_expr( Mctx, node->child(1), encountered_blacklisted_detail));
 		case TOK_MUL:
 			return MExprMult(
-				translate_expr( Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 0), encountered_blacklisted_detail),
-				translate_expr( Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 1), encountered_blacklisted_detail));
+				translate_expr( Mctx, node->child(0), encountered_blacklisted_detail),
+				translate_expr( Mctx, node->child(1), encountered_blacklisted_detail));
 		case TOK_DIV:
 			return MExprDiv(
-				translate_expr(Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 0), encountered_blacklisted_detail),
-				translate_expr(Mctx, (pANTLR3_BASE_TREE)node->getChild(node, 1), encountered_blacklisted_detail));
+				translate_expr(Mctx, node->child(0), encountered_blacklisted_detail),
+				translate_expr(Mctx, node->child(1), encountered_blacklisted_detail));
 
         case TOK_TERM:
             return translate_term(Mctx, node, encountered_blacklisted_detail);
@@ -214,12 +166,12 @@ namespace ethelo
         return nullptr;
     }
 
-	MathExprNode* evaluator::translate_term( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
+	MathExprNode* evaluator::translate_term( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
 		double factor = 1.0;
 		MathExprNode* temp;
-        for (ANTLR3_UINT32 i = 0; i < node->getChildCount(node); i++) {
-            auto child = (pANTLR3_BASE_TREE)node->getChild(node, i);
-            switch (child->getType(child))
+        for (size_t i = 0; i < node->child_count(); i++) {
+            auto child = node->child(i);
+            switch (child->type())
             {
             case TOK_VAR:
                 return translate_var(Mctx, child, encountered_blacklisted_detail);
@@ -253,9 +205,9 @@ namespace ethelo
 	}
 
 
-	MathExprNode* evaluator::translate_var( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
-		std::string name = expression::to_string((pANTLR3_BASE_TREE)node->getChild(node, 0));
-        auto array = (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_ARRAY);
+	MathExprNode* evaluator::translate_var( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
+		std::string name = expression::to_string(node->child(0));
+        auto array = node->first_child(TOK_ARRAY);
 
         if (name != "x")
             throw semantic_error(Mctx.expr, node, "NameError", "use of undefined variable");
@@ -272,9 +224,9 @@ namespace ethelo
     }
 
 
-	MathExprNode* evaluator::translate_frag( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
-		std::string name = expression::to_string((pANTLR3_BASE_TREE)node->getChild(node, 0));
-        auto fragments = Mctx.p.fragments();
+	MathExprNode* evaluator::translate_frag( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
+		std::string name = expression::to_string(node->child(0));
+        const auto& fragments = Mctx.p.fragments();
         auto index = fragments.find(name);
 
         if (index >= 0)
@@ -283,10 +235,9 @@ namespace ethelo
             throw semantic_error(Mctx.expr, node, "KeyError", "unknown fragment");
 	}
 
-	MathExprNode* evaluator::translate_detail(	const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
-		std::string name = expression::to_string((pANTLR3_BASE_TREE)node->getChild(node, 0));
-        auto array = (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_ARRAY);
-        auto options = Mctx.p.options();
+	MathExprNode* evaluator::translate_detail(	const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
+		std::string name = expression::to_string(node->child(0));
+        auto array = node->first_child(TOK_ARRAY);
 		
 		Mctx.detail_set.insert(name);
         if(relaxable_constraints_ && Mctx.p.is_detail_excluded(name)){
@@ -295,52 +246,55 @@ namespace ethelo
             return new LinExp(Mctx.FVmask, 0.0);
         }
 
+        // one column lookup, then a direct read per option
+        const auto& details = Mctx.p.details();
+        const std::ptrdiff_t column = details.find(name);
         if (array){
-            return new LinExp(Mctx.FVmask, options[compile_array(Mctx, array)].get_detail(name));
+            return new LinExp(Mctx.FVmask, details.value(column, Mctx.p.original_option_index(compile_array(Mctx, array))));
         }else {
 			arma::vec coef{arma::zeros(p_->dim())};
             for (auto i : Mctx.options){
-				coef[i] = options[i].get_detail(name);
+				coef[i] = details.value(column, Mctx.p.original_option_index(i));
 			}
             return Mctx.getNode(coef);
         }
 	}
 
-	MathExprNode* evaluator::translate_func( const Masked_context& Mctx, pANTLR3_BASE_TREE node) const{
-		std::string name = expression::to_string((pANTLR3_BASE_TREE)node->getChild(node, 0));
+	MathExprNode* evaluator::translate_func( const Masked_context& Mctx, const syntax_node* node) const{
+		std::string name = expression::to_string(node->child(0));
         auto ifunc = T_functions_.find(name);
         if (ifunc == T_functions_.end())
             throw semantic_error(Mctx.expr, node, "KeyError", "unknown function");
 
-        std::vector<pANTLR3_BASE_TREE> arguments;
-        for (ANTLR3_UINT32 i = 1; i < node->getChildCount(node); i++)
-            arguments.push_back((pANTLR3_BASE_TREE)node->getChild(node, i));
+        std::vector<const syntax_node*> arguments;
+        for (size_t i = 1; i < node->child_count(); i++)
+            arguments.push_back(node->child(i));
 
         return ifunc->second(Mctx, node, arguments);
 	}
 
-	MathExprNode* evaluator::translate_aggregate( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
-		std::string name = expression::to_string((pANTLR3_BASE_TREE)node->getChild(node, 0));
+	MathExprNode* evaluator::translate_aggregate( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
+		std::string name = expression::to_string(node->child(0));
         auto iagg = T_aggregates_.find(name);
         if (iagg == T_aggregates_.end())
             throw semantic_error(Mctx.expr, node, "KeyError", "unknown aggregate");
 
         std::vector<size_t> subset;
-        auto options = Mctx.p.options();
-        std::string variable = expression::to_string((pANTLR3_BASE_TREE)node->getChild(node, 1));
-        auto node_detail = (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_DETAIL);
-        auto node_expr = (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_EXPR);
+        std::string variable = expression::to_string(node->child(1));
+        auto node_detail = node->first_child(TOK_DETAIL);
+        auto node_expr = node->first_child(TOK_EXPR);
 
         if (!node_detail)
             for (auto i : Mctx.options)
                 subset.push_back(i);
         else {
-            if (node_detail->getFirstChildWithType(node_detail, TOK_ARRAY))
+            if (node_detail->first_child(TOK_ARRAY))
                 throw semantic_error(Mctx.expr, node_detail, "TypeError", "expected detail array");
 
-            std::string detail = expression::to_string((pANTLR3_BASE_TREE)node_detail->getChild(node_detail, 0));
+            std::string detail = expression::to_string(node_detail->child(0));
+            const std::ptrdiff_t column = Mctx.p.details().find(detail);
             for (auto i : Mctx.options)
-                if (std::abs(options[i].get_detail(detail)) > std::numeric_limits<double>::epsilon())
+                if (std::abs(Mctx.p.details().value(column, Mctx.p.original_option_index(i))) > std::numeric_limits<double>::epsilon())
                     subset.push_back(i);
         }
 
@@ -354,18 +308,19 @@ namespace ethelo
 
 	}
 
-	MathExprNode* evaluator::translate_filter( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const{
-		auto node_detail = (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_DETAIL);
-        auto node_expr = (pANTLR3_BASE_TREE)node->getFirstChildWithType(node, TOK_EXPR);
+	MathExprNode* evaluator::translate_filter( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const{
+		auto node_detail = node->first_child(TOK_DETAIL);
+        auto node_expr = node->first_child(TOK_EXPR);
 
-        if (node_detail->getFirstChildWithType(node_detail, TOK_ARRAY))
+        if (node_detail->first_child(TOK_ARRAY))
             throw semantic_error(Mctx.expr, node_detail, "TypeError", "expected detail array");
-        std::string detail = expression::to_string((pANTLR3_BASE_TREE)node_detail->getChild(node_detail, 0));
+        std::string detail = expression::to_string(node_detail->child(0));
 
         Masked_context filter_context(Mctx);
         filter_context.options.clear();
+        const std::ptrdiff_t column = Mctx.p.details().find(detail);
         for (auto i : Mctx.options)
-            if (std::abs(Mctx.p.options()[i].get_detail(detail)) > std::numeric_limits<double>::epsilon())
+            if (std::abs(Mctx.p.details().value(column, Mctx.p.original_option_index(i))) > std::numeric_limits<double>::epsilon())
                 filter_context.options.insert(i);
 
         return translate_expr(filter_context, node_expr, encountered_blacklisted_detail);
@@ -373,8 +328,8 @@ namespace ethelo
 
 	MathExprNode* evaluator::translate_func_abs(
 		const Masked_context& Mctx,
-		pANTLR3_BASE_TREE node,
-		const std::vector<pANTLR3_BASE_TREE>& arguments) const{
+		const syntax_node* node,
+		const std::vector<const syntax_node*>& arguments) const{
 		if (arguments.size() != 1)
             throw semantic_error(Mctx.expr, node, "TypeError", "abs() expects exactly 1 argument");
         bool encountered_blacklisted_detail = false;
@@ -384,8 +339,8 @@ namespace ethelo
 
 	MathExprNode* evaluator::translate_func_sqrt(
 		const Masked_context& Mctx,
-		pANTLR3_BASE_TREE node,
-		const std::vector<pANTLR3_BASE_TREE>& arguments) const{
+		const syntax_node* node,
+		const std::vector<const syntax_node*>& arguments) const{
 		if (arguments.size() != 1)
             throw semantic_error(Mctx.expr, node, "TypeError", "sqrt() expects exactly 1 argument");
         bool encountered_blacklisted_detail = false;
@@ -395,7 +350,7 @@ namespace ethelo
 
 	MathExprNode* evaluator::translate_agg_sum(
 		const Masked_context& Mctx,
-		pANTLR3_BASE_TREE node,
+		const syntax_node* node,
 		const std::vector<std::tuple<size_t, MathExprNode*>>& values) const{
 		MathExprNode* temp = nullptr;
 
@@ -410,7 +365,7 @@ namespace ethelo
 
 	MathExprNode* evaluator::translate_agg_sum_all(
 		const Masked_context& Mctx,
-		pANTLR3_BASE_TREE node,
+		const syntax_node* node,
 		const std::vector<std::tuple<size_t, MathExprNode*>>& values) const
 		{
 		MathExprNode* temp = nullptr;
@@ -423,7 +378,7 @@ namespace ethelo
 
 	MathExprNode* evaluator::translate_agg_mean(
 		const Masked_context& Mctx,
-		pANTLR3_BASE_TREE node,
+		const syntax_node* node,
 		const std::vector<std::tuple<size_t, MathExprNode*>>& values) const
 		{
 		MathExprNode* denum = nullptr;
@@ -439,7 +394,7 @@ namespace ethelo
 
 	MathExprNode* evaluator::translate_agg_mean_all(
 		const Masked_context& Mctx,
-		pANTLR3_BASE_TREE node,
+		const syntax_node* node,
 		const std::vector<std::tuple<size_t, MathExprNode*>>& values) const
 		{
 		double n = values.size();
@@ -30,11 +30,13 @@ namespace ethelo
         // void evaluate(ADvector& fg, ADvector& x);
         // void displays(ADvector& h, ADvector& x) const;
 
-		//After function call, arr[i] points to the tree corresponding to p_->constraints()[i]
-		void translate(const FixVar_Mask* FVmask, std::vector<MathExprNode*>& arr,
-		std::vector<std::set<std::string>>& detail_sets) const;
-		
-		void translate_displays(const FixVar_Mask* FVmask, std::vector<MathExprNode*>& arr) const;
+		/* Per-item translation. Each call only reads the problem, so different
+			items can be translated concurrently; MathProgram::fillWithEval
+			spreads them over thread_pool::global().
+		*/
+		MathExprNode* translate_constraint(const FixVar_Mask* FVmask, size_t i, std::set<std::string>& detail_set) const;
+		MathExprNode* translate_exclusion(const FixVar_Mask* FVmask, size_t i) const;
+		MathExprNode* translate_display(const FixVar_Mask* FVmask, size_t i) const;
 
         operator bool() const { return valid(); }
         bool valid() const { return p_ != NULL; }
@@ -54,12 +56,12 @@ namespace ethelo
             std::map<std::string, double> locals;
         };
 
-        // typedef AD evaluator_function(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<pANTLR3_BASE_TREE>& arguments);
-        // typedef AD evaluator_aggregate(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<std::tuple<size_t, AD>>& values);
+        // typedef AD evaluator_function(const context& ctx, const syntax_node* node, const std::vector<const syntax_node*>& arguments);
+        // typedef AD evaluator_aggregate(const context& ctx, const syntax_node* node, const std::vector<std::tuple<size_t, AD>>& values);
         // std::map<std::string, std::function<evaluator_function>> functions_;
         // std::map<std::string, std::function<evaluator_aggregate>> aggregates_;
 
-		/* The grammar used for generating pANTLR3_BASE_TREE is stored at engine/language/expression.g
+		/* The grammar used for generating const syntax_node* is stored at engine/language/expression.g
 			"fragment" refers to those with "@" prefix in JSON file, and
 			"detail" refers to those with "$" prefix in JSON file
 		*/
@@ -68,22 +70,22 @@ namespace ethelo
         // AD compile_ethelo(const context& ctx);
         // AD compile_exclusion(const context& ctx, arma::vec exclusion) const;
         // AD compile_expr(const context& ctx, bool& encountered_blacklisted_detail ) const;
-        // AD compile_expr(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        // AD compile_term(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        // AD compile_var(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        // AD compile_frag(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        // AD compile_detail(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        // AD compile_func(const context& ctx, pANTLR3_BASE_TREE node) const;
-        // AD compile_aggregate(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        // AD compile_filter(const context& ctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        size_t compile_array(const context& ctx, pANTLR3_BASE_TREE node) const;
-
-        // AD func_sqrt(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<pANTLR3_BASE_TREE>& arguments) const;
-        // AD func_abs(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<pANTLR3_BASE_TREE>& arguments) const;
-        // AD agg_sum(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<std::tuple<size_t, AD>>& values) const;
-        // AD agg_sum_all(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<std::tuple<size_t, AD>>& values) const;
-        // AD agg_mean(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<std::tuple<size_t, AD>>& values) const;
-        // AD agg_mean_all(const context& ctx, pANTLR3_BASE_TREE node, const std::vector<std::tuple<size_t, AD>>& values) const;
+        // AD compile_expr(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        // AD compile_term(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        // AD compile_var(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        // AD compile_frag(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        // AD compile_detail(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        // AD compile_func(const context& ctx, const syntax_node* node) const;
+        // AD compile_aggregate(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        // AD compile_filter(const context& ctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        size_t compile_array(const context& ctx, const syntax_node* node) const;
+
+        // AD func_sqrt(const context& ctx, const syntax_node* node, const std::vector<const syntax_node*>& arguments) const;
+        // AD func_abs(const context& ctx, const syntax_node* node, const std::vector<const syntax_node*>& arguments) const;
+        // AD agg_sum(const context& ctx, const syntax_node* node, const std::vector<std::tuple<size_t, AD>>& values) const;
+        // AD agg_sum_all(const context& ctx, const syntax_node* node, const std::vector<std::tuple<size_t, AD>>& values) const;
+        // AD agg_mean(const context& ctx, const syntax_node* node, const std::vector<std::tuple<size_t, AD>>& values) const;
+        // AD agg_mean_all(const context& ctx, const syntax_node* node, const std::vector<std::tuple<size_t, AD>>& values) const;
 		
 		//==================================
 		/* The below is for the translate() function. The are implemented with a similar logic to
@@ -125,8 +127,8 @@ namespace ethelo
 			LinExp* getNode(const arma::vec& coef) const;
 		};
 
-		typedef MathExprNode* translator_function(const Masked_context& Mctx, pANTLR3_BASE_TREE node, const std::vector<pANTLR3_BASE_TREE>& arguments);
-        typedef MathExprNode* translator_aggregate(const Masked_context& Mctx, pANTLR3_BASE_TREE node, const std::vector<std::tuple<size_t, MathExprNode*>>& values);
+		typedef MathExprNode* translator_function(const Masked_context& Mctx, const syntax_node* node, const std::vector<const syntax_node*>& arguments);
+        typedef MathExprNode* translator_aggregate(const Masked_context& Mctx, const syntax_node* node, const std::vector<std::tuple<size_t, MathExprNode*>>& values);
         std::map<std::string, std::function<translator_function>> T_functions_;
         std::map<std::string, std::function<translator_aggregate>> T_aggregates_;
 
@@ -134,39 +136,39 @@ namespace ethelo
         MathExprNode* translate_exclusion( const Masked_context& Mctx, arma::vec exclusion) const;
         MathExprNode* translate_expr( const Masked_context& Mctx, bool& encountered_blacklisted_detail ) const;
 
-        MathExprNode* translate_expr( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        MathExprNode* translate_term( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        MathExprNode* translate_var( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        MathExprNode* translate_frag( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        MathExprNode* translate_detail(	const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_expr( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_term( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_var( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_frag( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_detail(	const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
 
-        MathExprNode* translate_func( const Masked_context& Mctx, pANTLR3_BASE_TREE node) const;
-        MathExprNode* translate_aggregate( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
-        MathExprNode* translate_filter( const Masked_context& Mctx, pANTLR3_BASE_TREE node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_func( const Masked_context& Mctx, const syntax_node* node) const;
+        MathExprNode* translate_aggregate( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
+        MathExprNode* translate_filter( const Masked_context& Mctx, const syntax_node* node, bool& encountered_blacklisted_detail ) const;
 
         MathExprNode* translate_func_abs(
 			const Masked_context& Mctx,
-			pANTLR3_BASE_TREE node,
-			const std::vector<pANTLR3_BASE_TREE>& arguments) const;
+			const syntax_node* node,
+			const std::vector<const syntax_node*>& arguments) const;
 		MathExprNode* translate_func_sqrt(
 			const Masked_context& Mctx,
-			pANTLR3_BASE_TREE node,
-			const std::vector<pANTLR3_BASE_TREE>& arguments) const;
+			const syntax_node* node,
+			const std::vector<const syntax_node*>& arguments) const;
         MathExprNode* translate_agg_sum(
 			const Masked_context& Mctx,
-			pANTLR3_BASE_TREE node,
+			const syntax_node* node,
 			const std::vector<std::tuple<size_t, MathExprNode*>>& values) const;
         MathExprNode* translate_agg_sum_all(
 			const Masked_context& Mctx,
-			pANTLR3_BASE_TREE node,
+			const syntax_node* node,
 			const std::vector<std::tuple<size_t, MathExprNode*>>& values) const;
         MathExprNode* translate_agg_mean(
 			const Masked_context& Mctx,
-			pANTLR3_BASE_TREE node,
+			const syntax_node* node,
 			const std::vector<std::tuple<size_t, MathExprNode*>>& values) const;
         MathExprNode* translate_agg_mean_all(
 			const Masked_context& Mctx,
-			pANTLR3_BASE_TREE node,
+			const syntax_node* node,
 			const std::vector<std::tuple<size_t, MathExprNode*>>& values) const;
     };
 }
@@ -39,15 +39,17 @@ namespace ethelo
     public:
         syntax_error(const expression& expr, pANTLR3_EXCEPTION ex)
             : compile_error(expr, ex->line, ex->charPositionInLine, (const char*) ex->name, (const char*) ex->message) {}
-        syntax_error(const expression& expr, pANTLR3_BASE_TREE node, const std::string& type, const std::string& message)
-            : compile_error(expr, node->getLine(node), node->getCharPositionInLine(node), type, message) {}
+        syntax_error(const expression& expr, const syntax_node* node, const std::string& type, const std::string& message)
+            : compile_error(expr, node->line(), node->position(), type, message) {}
+        syntax_error(const expression& expr, uint32_t line, int32_t position, const std::string& type, const std::string& message)
+            : compile_error(expr, line, position, type, message) {}
     };
 
     class semantic_error : public compile_error
     {
     public:
-        semantic_error(const expression& expr, pANTLR3_BASE_TREE node, const std::string& type, const std::string& message)
-            : compile_error(expr, node->getLine(node), node->getCharPositionInLine(node), type, message) {}
+        semantic_error(const expression& expr, const syntax_node* node, const std::string& type, const std::string& message)
+            : compile_error(expr, node->line(), node->position(), type, message) {}
     };
 
     class unknown_function : public std::invalid_argument
@@ -11,61 +11,137 @@ namespace ethelo
     {};
 
     expression::expression(expression_type type, const std::string& name, const std::string& source)
-        : name_(name), type_(type)
-    { parse(source); }
+        : name_(name), type_(type), state_(new parse_state(source))
+    { if (!defer_parsing_) parse(); }
 
     expression::expression(const std::string& name, const std::string& source)
-        : name_(name), type_(EXPRESSION)
-    { parse(source); }
+        : name_(name), type_(EXPRESSION), state_(new parse_state(source))
+    { if (!defer_parsing_) parse(); }
 
     expression::expression(const expression& other)
-        : name_(other.name_), type_(other.type_)
-    { if (other.source_) parse(*other.source_); }
+        : name_(other.name_), type_(other.type_), state_(other.state_)
+    {}
 
     expression::expression(expression&& other)
         : name_(std::move(other.name_)),
           type_(std::move(other.type_)),
-          source_(std::move(other.source_)),
-          input_(std::move(other.input_)),
-          lexer_(std::move(other.lexer_)),
-          tokens_(std::move(other.tokens_)),
-          parser_(std::move(other.parser_))
+          state_(std::move(other.state_))
     {}
 
     expression& expression::operator=(const expression& other)
-    { name_ = other.name_; if (other.source_) parse(*other.source_); return *this; }
+    { name_ = other.name_; state_ = other.state_; return *this; }
 
-    void expression::parse(const std::string& source)
+    static expression::parser_type default_parser()
     {
-        source_.reset(new std::string(source));
-        input_.reset(antlr3StringStreamNew((pANTLR3_UINT8)source_->c_str(), ANTLR3_ENC_8BIT, source_->size(), (pANTLR3_UINT8)name_.c_str()));
-        lexer_.reset(expressionLexerNew(input_.get()));
-        tokens_.reset(antlr3CommonTokenStreamSourceNew(ANTLR3_SIZE_HINT, TOKENSOURCE(lexer_.get())));
-        parser_.reset(expressionParserNew(tokens_.get()));
-        lexer_->pLexer->rec->displayRecognitionError = display_recognition_error;
-        parser_->pParser->rec->displayRecognitionError = display_recognition_error;
-        lexer_->pLexer->super = this;
-        parser_->pParser->super = this;
-        ast_ = parser_->start(parser_.get()).tree;
+        const char* parser = std::getenv("ENGINE_EXPRESSION_PARSER");
+        if (parser != NULL && std::string(parser) == "antlr")
+            return expression::ANTLR_PARSER;
+        return expression::NATIVE_PARSER;
     }
 
-    void expression::error(pANTLR3_BASE_RECOGNIZER recognizer, pANTLR3_UINT8* tokenNames)
+    std::atomic<uint64_t> expression::parse_count_(0);
+    std::atomic<expression::parser_type> expression::parser_(default_parser());
+    thread_local bool expression::defer_parsing_ = false;
+
+    expression::deferred_parsing::deferred_parsing(bool enable)
+        : previous_(defer_parsing_)
+    { defer_parsing_ = previous_ || enable; }
+
+    expression::deferred_parsing::~deferred_parsing()
+    { defer_parsing_ = previous_; }
+
+    void expression::parse() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->parsed) return;
+
+        parse_count_++;
+        std::unique_ptr<syntax_node> root = (parser_ == ANTLR_PARSER) ? parse_antlr() : native_parser::parse(*this, state_->source);
+
+        if (root) switch (type_)
+        {
+        case CONSTRAINT:
+            if (root->type() != TOK_INEQ)
+                throw syntax_error(*this, root.get(), "TypeError", "expected constraint expression");
+            constraint::compile(*this, root.get(), state_->lbound, state_->ubound);
+            break;
+        case FRAGMENT:
+            if (root->type() != TOK_EXPR)
+                throw syntax_error(*this, root.get(), "TypeError", "expected fragment expression");
+            break;
+        case DISPLAY:
+            if (root->type() != TOK_EXPR)
+                throw syntax_error(*this, root.get(), "TypeError", "expected display expression");
+            break;
+
+        default:
+            break;
+        }
+
+        state_->ast = std::move(root);
+        state_->parsed = true;
+    }
+
+    const bound& expression::lower_bound() const
+    {
+        static const bound none;
+        return valid() ? state_->lbound : none;
+    }
+
+    const bound& expression::upper_bound() const
+    {
+        static const bound none;
+        return valid() ? state_->ubound : none;
+    }
+
+    static std::unique_ptr<syntax_node> convert(pANTLR3_BASE_TREE node)
+    {
+        pANTLR3_STRING text = node->getText(node);
+        std::unique_ptr<syntax_node> result(new syntax_node(
+            node->getType(node),
+            text ? std::string((const char*)text->chars) : std::string(),
+            node->getLine(node),
+            node->getCharPositionInLine(node)));
+
+        for (ANTLR3_UINT32 i = 0; i < node->getChildCount(node); i++)
+            result->add_child(convert((pANTLR3_BASE_TREE)node->getChild(node, i)));
+        return result;
+    }
+
+    std::unique_ptr<syntax_node> expression::parse_antlr() const
+    {
+        const std::string& source = state_->source;
+        std::unique_ptr<ANTLR3_INPUT_STREAM, deleter> input(antlr3StringStreamNew((pANTLR3_UINT8)source.c_str(), ANTLR3_ENC_8BIT, source.size(), (pANTLR3_UINT8)name_.c_str()));
+        std::unique_ptr<expressionLexer, deleter> lexer(expressionLexerNew(input.get()));
+        std::unique_ptr<ANTLR3_COMMON_TOKEN_STREAM, deleter> tokens(antlr3CommonTokenStreamSourceNew(ANTLR3_SIZE_HINT, TOKENSOURCE(lexer.get())));
+        std::unique_ptr<expressionParser, deleter> parser(expressionParserNew(tokens.get()));
+        lexer->pLexer->rec->displayRecognitionError = display_recognition_error;
+        parser->pParser->rec->displayRecognitionError = display_recognition_error;
+        lexer->pLexer->super = (void*)this;
+        parser->pParser->super = (void*)this;
+
+        // the tree belongs to the parser, copy it out before everything is freed
+        auto tree = parser->start(parser.get()).tree;
+        return tree ? convert(tree) : std::unique_ptr<syntax_node>();
+    }
+
+    void expression::error(pANTLR3_BASE_RECOGNIZER recognizer, pANTLR3_UINT8* tokenNames) const
     {
         throw syntax_error(*this, recognizer->state->exception);
     }
 
     void expression::display_recognition_error(pANTLR3_BASE_RECOGNIZER recognizer, pANTLR3_UINT8* tokenNames)
     {
-        expression* instance = NULL;
+        const expression* instance = NULL;
 
         switch  (recognizer->type)
         {
         case ANTLR3_TYPE_LEXER:
-            instance = (expression*)((pANTLR3_LEXER)recognizer->super)->super;
+            instance = (const expression*)((pANTLR3_LEXER)recognizer->super)->super;
             break;
 
         case ANTLR3_TYPE_PARSER:
-            instance = (expression*)((pANTLR3_PARSER)recognizer->super)->super;
+            instance = (const expression*)((pANTLR3_PARSER)recognizer->super)->super;
             break;
 
         default:
@@ -76,44 +152,59 @@ namespace ethelo
             instance->error(recognizer, tokenNames);
     }
 
-    std::string expression::to_string(pANTLR3_BASE_TREE node)
+    static void collect_references(const syntax_node* node, std::set<std::string>& fragments, std::set<std::string>& details)
+    {
+        if (!node) return;
+        if (node->type() == TOK_FRAG)
+            fragments.insert(expression::to_string(node->child(0)));
+        else if (node->type() == TOK_DETAIL)
+            details.insert(expression::to_string(node->child(0)));
+
+        for (size_t i = 0; i < node->child_count(); i++)
+            collect_references(node->child(i), fragments, details);
+    }
+
+    void expression::references(std::set<std::string>& fragments, std::set<std::string>& details) const
     {
-        switch(node->getType(node))
+        collect_references(ast(), fragments, details);
+    }
+
+    std::string expression::to_string(const syntax_node* node)
+    {
+        switch(node->type())
         {
         case TOK_ID:
-            return std::string((const char*)node->getText(node)->chars);
-        case TOK_STRING: {
-            std::string str((const char*)node->getText(node)->chars);
-            return str.substr(1, str.size() - 2);
-        }
+            return node->text();
+        case TOK_STRING:
+            return node->text().substr(1, node->text().size() - 2);
 
         default:
             return std::string();
         }
     }
 
-    uint64_t expression::to_integer(pANTLR3_BASE_TREE node)
+    uint64_t expression::to_integer(const syntax_node* node)
     {
-        switch(node->getType(node))
+        switch(node->type())
         {
         case TOK_INTEGER:
-            return strtol((const char*)node->getText(node)->chars, NULL, 10);
+            return strtol(node->text().c_str(), NULL, 10);
         case TOK_FLOATING:
-            return strtod((const char*)node->getText(node)->chars, NULL);
+            return strtod(node->text().c_str(), NULL);
 
         default:
             return 0;
         }
     }
 
-    double expression::to_float(pANTLR3_BASE_TREE node)
+    double expression::to_float(const syntax_node* node)
     {
-        switch(node->getType(node))
+        switch(node->type())
         {
         case TOK_INTEGER:
-            return strtol((const char*)node->getText(node)->chars, NULL, 10);
+            return strtol(node->text().c_str(), NULL, 10);
         case TOK_FLOATING:
-            return strtod((const char*)node->getText(node)->chars, NULL);
+            return strtod(node->text().c_str(), NULL);
 
         default:
             return 0;
@@ -5,30 +5,73 @@
 
 namespace ethelo
 {
+    class syntax_node;
+
+    struct bound
+    {
+        double value = 0.0;
+        bool enabled = false;
+
+        void set(double value) { this->value = value; enabled = true; }
+
+        operator bool() const { return enabled; }
+        double get() const { return value; }
+    };
+
     class expression
     {
     public:
         enum expression_type { EXPRESSION, FRAGMENT, CONSTRAINT, DISPLAY };
+        enum parser_type { NATIVE_PARSER, ANTLR_PARSER };
+
+        // While in scope, expressions constructed on this thread are not parsed
+        // until their tree is first requested. Syntax errors surface at that point.
+        class deferred_parsing
+        {
+            bool previous_;
+
+        public:
+            deferred_parsing(bool enable = true);
+            ~deferred_parsing();
+        };
 
     private:
         static void display_recognition_error(pANTLR3_BASE_RECOGNIZER recognizer, pANTLR3_UINT8* tokenNames);
+        static std::atomic<uint64_t> parse_count_;
+        static std::atomic<parser_type> parser_;
+        static thread_local bool defer_parsing_;
 
         struct deleter {
             template<typename T>
             void operator()(T* obj) { obj->free(obj); }
         };
 
+        // Source and tree of an expression. The tree is filled in at most once
+        // and shared between copies of an expression instead of parsing again.
+        // Constraint bounds are compiled together with the tree.
+        struct parse_state {
+            std::string source;
+            std::mutex mutex;
+            std::atomic<bool> parsed;
+            std::unique_ptr<const syntax_node> ast;
+            bound lbound, ubound;
+
+            parse_state(const std::string& source)
+                : source(source), parsed(false) {}
+        };
+
         std::string name_;
         expression_type type_;
-        std::unique_ptr<std::string> source_;
-        std::unique_ptr<ANTLR3_INPUT_STREAM, deleter> input_;
-        std::unique_ptr<ANTLR3_COMMON_TOKEN_STREAM, deleter> tokens_;
-        std::unique_ptr<expressionLexer, deleter> lexer_;
-        std::unique_ptr<expressionParser, deleter> parser_;
-        pANTLR3_BASE_TREE ast_;
+        std::shared_ptr<parse_state> state_;
 
-        void parse(const std::string& source);
-        void error(pANTLR3_BASE_RECOGNIZER recognizer, pANTLR3_UINT8* tokenNames);
+        void parse() const;
+        std::unique_ptr<syntax_node> parse_antlr() const;
+        void error(pANTLR3_BASE_RECOGNIZER recognizer, pANTLR3_UINT8* tokenNames) const;
+
+    protected:
+        bool parsed() const { return state_ && state_->parsed; }
+        const bound& lower_bound() const;
+        const bound& upper_bound() const;
 
     public:
         expression();
@@ -44,11 +87,27 @@ namespace ethelo
         bool valid() const { return ast() != NULL; }
         std::string name() const { return name_; }
         expression_type type() const { return type_; }
-        std::string source() const { return source_ ? *source_ : ""; }
-        pANTLR3_BASE_TREE ast() const { return parser_ ? ast_ : NULL; }
+        std::string source() const { return state_ ? state_->source : ""; }
+        const syntax_node* ast() const
+        {
+            if (!state_) return NULL;
+            if (!state_->parsed) parse();
+            return state_->ast.get();
+        }
+
+        // adds the names of the fragments and details used directly by this expression
+        void references(std::set<std::string>& fragments, std::set<std::string>& details) const;
+
+        // number of times the parser has run in this process
+        static uint64_t parse_count() { return parse_count_; }
+
+        // Parser used for expressions parsed from now on. The native parser is
+        // the default, ENGINE_EXPRESSION_PARSER=antlr selects the generated one.
+        static void use_parser(parser_type type) { parser_ = type; }
+        static parser_type parser_in_use() { return parser_; }
 
-        static std::string to_string(pANTLR3_BASE_TREE node);
-        static uint64_t to_integer(pANTLR3_BASE_TREE node);
-        static double to_float(pANTLR3_BASE_TREE node);
+        static std::string to_string(const syntax_node* node);
+        static uint64_t to_integer(const syntax_node* node);
+        static double to_float(const syntax_node* node);
     };
 }
@@ -4,8 +4,6 @@ namespace ethelo
 {
     class fragment : public expression
     {
-        void compile();
-
     public:
         fragment();
         fragment(const std::string& name, const std::string& source);
@@ -3,6 +3,7 @@
 #include <cassert>
 
 // Nodes
+#include "MathModel/NodeArena.hpp"
 #include "MathModel/MathExprNode.hpp"
 #include "MathModel/LinExp.hpp"
 #include "MathModel/MultNode.hpp"
@@ -11,6 +12,7 @@
 #include "MathModel/SumNode.hpp"
 #include "MathModel/SqrtNode.hpp"
 #include "MathModel/QuadExprNode.hpp"
+#include "MathModel/ExprTape.hpp"
 
 // VarMasks
 #include "MathModel/VarMask.hpp"
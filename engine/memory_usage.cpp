@@ -0,0 +1,98 @@
+#include "memory_usage.hpp"
+
+#include <fstream>
+#include <mutex>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace ethelo
+{
+    namespace
+    {
+        std::array<std::atomic<int64_t>, node_census::num_types> live_;
+        std::array<std::atomic<int64_t>, node_census::num_types> peak_;
+        std::atomic<int64_t> coef_bytes_(0);
+        std::atomic<int64_t> peak_coef_bytes_(0);
+        std::mutex scope_mutex_;
+
+        void raise_peak(std::atomic<int64_t>& peak, int64_t value) {
+            int64_t current = peak.load(std::memory_order_relaxed);
+            while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+        }
+    }
+
+    process_memory process_memory::read()
+    {
+        process_memory memory;
+
+        // statm: total program size, then resident pages
+        std::ifstream statm("/proc/self/statm");
+        size_t pages = 0, resident = 0;
+        if (statm >> pages >> resident)
+            memory.rss_bytes = resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            memory.peak_rss_bytes = static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes on Linux
+
+        return memory;
+    }
+
+    const char* const node_census::type_names[node_census::num_types] = {
+        "SumNode", "MultNode", "DivNode", "AbsNode", "LinExp", "SqrtNode", "QuadExprNode"};
+
+    std::atomic<int> node_census::users_(0);
+
+    int64_t node_census::counts::total_live() const
+    {
+        int64_t total = 0;
+        for (int64_t count : live) total += count;
+        return total;
+    }
+
+    node_census::scope::scope()
+    {
+        std::lock_guard<std::mutex> lock(scope_mutex_);
+        if (users_.load() == 0) {
+            for (size_t t = 0; t < num_types; t++)
+                peak_[t] = live_[t].load();
+            peak_coef_bytes_ = coef_bytes_.load();
+        }
+        users_++;
+    }
+
+    node_census::scope::~scope()
+    {
+        std::lock_guard<std::mutex> lock(scope_mutex_);
+        users_--;
+    }
+
+    node_census::counts node_census::snapshot()
+    {
+        counts result;
+        for (size_t t = 0; t < num_types; t++) {
+            result.live[t] = live_[t].load(std::memory_order_relaxed);
+            result.peak[t] = peak_[t].load(std::memory_order_relaxed);
+        }
+        result.coef_bytes = coef_bytes_.load(std::memory_order_relaxed);
+        result.peak_coef_bytes = peak_coef_bytes_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    void node_census::added(size_t type)
+    {
+        raise_peak(peak_[type], live_[type].fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    void node_census::removed(size_t type)
+    {
+        live_[type].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void node_census::coef_bytes(int64_t delta)
+    {
+        int64_t now = coef_bytes_.fetch_add(delta, std::memory_order_relaxed) + delta;
+        if (delta > 0) raise_peak(peak_coef_bytes_, now);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ethelo
+{
+    // resident memory of the process, as reported by the kernel
+    struct process_memory
+    {
+        size_t rss_bytes = 0;       // resident set now
+        size_t peak_rss_bytes = 0;  // highest resident set so far
+
+        static process_memory read();
+    };
+
+    /*
+        node_census counts the MathExprNodes alive and their peak, by
+        NodeType, together with the bytes held by LinExp coefficient vectors.
+
+        Counting is on while at least one node_census::scope is alive; only
+        nodes created while it is on are counted (each node remembers
+        whether it was), so nodes older than the first scope never show up.
+        Counts are process-wide: concurrent requests see each other's nodes.
+        Peaks restart from the live counts whenever counting is turned on.
+    */
+    class node_census
+    {
+    public:
+        // one per MathExprNode::NodeType, in the same order
+        static const size_t num_types = 7;
+        static const char* const type_names[num_types];
+
+        struct counts {
+            std::array<int64_t, num_types> live;
+            std::array<int64_t, num_types> peak;
+            int64_t coef_bytes;
+            int64_t peak_coef_bytes;
+
+            int64_t total_live() const;
+        };
+
+        class scope
+        {
+        public:
+            scope();
+            ~scope();
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        };
+
+        static bool enabled() { return users_.load(std::memory_order_relaxed) > 0; }
+        static counts snapshot();
+
+        // called by the nodes themselves
+        static void added(size_t type);
+        static void removed(size_t type);
+        static void coef_bytes(int64_t delta);
+
+    private:
+        static std::atomic<int> users_;
+    };
+}
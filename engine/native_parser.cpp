@@ -0,0 +1,502 @@
+#include "ethelo.hpp"
+
+namespace ethelo
+{
+    namespace
+    {
+        // Literal tokens of the grammar. Their ANTLR token types are generated
+        // (T__xx) and never appear in a tree, so any distinct value will do.
+        enum literal_token
+        {
+            LIT_EOF = -1,
+            LIT_LBRACKET = -2,
+            LIT_RBRACKET = -3,
+            LIT_LPAREN = -4,
+            LIT_RPAREN = -5,
+            LIT_LBRACE = -6,
+            LIT_RBRACE = -7,
+            LIT_COMMA = -8,
+            LIT_IN = -9,
+            LIT_FILTER = -10
+        };
+
+        // Entries of the follow sets given to parser::match besides token types
+        enum follow_marker
+        {
+            FOLLOW_END_OF_RULE = -100,  // the expected token may end its rule
+            FOLLOW_EXPRESSION = -101    // any token that can start an expression
+        };
+
+        // The ANTLR3 C runtime names every error after the recognition
+        // exception base class and describes the kind of mismatch in the message.
+        const char* RECOGNITION_ERROR = "org.antlr.runtime.RecognitionException";
+        const char* MISMATCHED_TOKEN = "org.antlr.runtime.MismatchedTokenException";
+        const char* UNWANTED_TOKEN = "org.antlr.runtime.UnwantedTokenException";
+        const char* MISSING_TOKEN = "org.antlr.runtime.MissingTokenException";
+
+        struct token
+        {
+            int type;
+            size_t begin, end;
+            uint32_t line;
+            int32_t position;
+        };
+
+        bool is_digit(int c) { return c >= '0' && c <= '9'; }
+        bool is_alpha(int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+        bool is_number(int type) { return type == TOK_INTEGER || type == TOK_FLOATING; }
+        bool is_relation(int type) { return type == TOK_LEQ || type == TOK_GEQ || type == TOK_EQ; }
+        bool starts_expression(int type)
+        {
+            return type == TOK_PLUS || type == TOK_MINUS || is_number(type) || type == TOK_STRING || type == TOK_ID ||
+                   type == TOK_FRAG || type == TOK_DETAIL || type == LIT_FILTER || type == LIT_LPAREN;
+        }
+
+        class tokenizer
+        {
+            const expression& expr_;
+            const std::string& source_;
+            size_t pos_ = 0;
+            uint32_t line_ = 1;
+            int32_t column_ = 0;
+
+            int peek(size_t ahead = 0) const
+            { return pos_ + ahead < source_.size() ? (unsigned char)source_[pos_ + ahead] : -1; }
+
+            void advance()
+            {
+                if (source_[pos_] == '\n') { line_++; column_ = 0; }
+                else column_++;
+                pos_++;
+            }
+
+            [[noreturn]] void error() const
+            { throw syntax_error(expr_, line_, column_, RECOGNITION_ERROR, ""); }
+
+            void exponent()
+            {
+                advance();
+                if (peek() == '+' || peek() == '-') advance();
+                if (!is_digit(peek())) error();
+                while (is_digit(peek())) advance();
+            }
+
+            int number()
+            {
+                if (peek() == '-') advance();
+                while (is_digit(peek())) advance();
+
+                if (peek() == '.') {
+                    advance();
+                    while (is_digit(peek())) advance();
+                    if (peek() == 'e' || peek() == 'E') exponent();
+                    return TOK_FLOATING;
+                }
+
+                bool has_exponent = (peek() == 'e' || peek() == 'E') &&
+                    (is_digit(peek(1)) || ((peek(1) == '+' || peek(1) == '-') && is_digit(peek(2))));
+                if (has_exponent) {
+                    exponent();
+                    return TOK_FLOATING;
+                }
+                return TOK_INTEGER;
+            }
+
+            int identifier()
+            {
+                size_t begin = pos_;
+                while (is_alpha(peek()) || is_digit(peek())) advance();
+
+                std::string text = source_.substr(begin, pos_ - begin);
+                if (text == "in") return LIT_IN;
+                if (text == "filter") return LIT_FILTER;
+                return TOK_ID;
+            }
+
+            int string()
+            {
+                int quote = peek();
+                advance();
+                while (peek() != quote) {
+                    if (peek() < 0) error();
+                    advance();
+                }
+                advance();
+                return TOK_STRING;
+            }
+
+            int symbol(int type, size_t length = 1)
+            {
+                for (size_t i = 0; i < length; i++) advance();
+                return type;
+            }
+
+            int relation(int type)
+            {
+                advance();
+                if (peek() != '=') error();
+                advance();
+                return type;
+            }
+
+            int next_type()
+            {
+                int c = peek();
+                switch (c)
+                {
+                case -1: return LIT_EOF;
+                case '+': return symbol(TOK_PLUS);
+                case '*': return symbol(TOK_MUL);
+                case '/': return symbol(TOK_DIV);
+                case '=': return symbol(TOK_EQ);
+                case '@': return symbol(TOK_FRAG);
+                case '$': return symbol(TOK_DETAIL);
+                case '[': return symbol(LIT_LBRACKET);
+                case ']': return symbol(LIT_RBRACKET);
+                case '(': return symbol(LIT_LPAREN);
+                case ')': return symbol(LIT_RPAREN);
+                case '{': return symbol(LIT_LBRACE);
+                case '}': return symbol(LIT_RBRACE);
+                case ',': return symbol(LIT_COMMA);
+                case '<': return relation(TOK_LEQ);
+                case '>': return relation(TOK_GEQ);
+                case '"':
+                case '\'':
+                    return string();
+                case '-':
+                    return is_digit(peek(1)) ? number() : symbol(TOK_MINUS);
+
+                default:
+                    if (is_digit(c)) return number();
+                    if (is_alpha(c)) return identifier();
+                    error();
+                }
+            }
+
+        public:
+            tokenizer(const expression& expr, const std::string& source)
+                : expr_(expr), source_(source) {}
+
+            // The whole input is tokenized up front, as ANTLR's token stream does,
+            // so lexical errors are reported before syntax errors.
+            std::vector<token> tokenize()
+            {
+                std::vector<token> tokens;
+                while (true) {
+                    while (peek() == ' ' || peek() == '\t' || peek() == '\r' || peek() == '\n')
+                        advance();
+
+                    token tok;
+                    tok.begin = pos_;
+                    tok.line = line_;
+                    tok.position = column_;
+                    tok.type = next_type();
+                    tok.end = pos_;
+                    // the C runtime only sets the line of its EOF token
+                    if (tok.type == LIT_EOF) tok.position = 0;
+                    tokens.push_back(tok);
+                    if (tok.type == LIT_EOF) return tokens;
+                }
+            }
+        };
+
+        typedef std::unique_ptr<syntax_node> node_ptr;
+
+        class parser
+        {
+            const expression& owner_;
+            const std::string& source_;
+            std::vector<token> tokens_;
+            size_t index_ = 0;
+
+            const token& la(size_t k) const
+            { return tokens_[std::min(index_ + k - 1, tokens_.size() - 1)]; }
+
+            const token& next()
+            {
+                const token& tok = tokens_[index_];
+                if (tok.type != LIT_EOF) index_++;
+                return tok;
+            }
+
+            [[noreturn]] void no_viable_alternative() const
+            {
+                const token& tok = la(1);
+                throw syntax_error(owner_, tok.line, tok.position, RECOGNITION_ERROR, "");
+            }
+
+            // follows(type, follow) tells whether a token of type may come right
+            // after the expected token. When that token may end its rule, the
+            // C runtime also admits the end of any enclosing rule, which every
+            // such match nested in an expression can reach.
+            static bool follows(int type, std::initializer_list<int> follow)
+            {
+                for (int entry : follow) {
+                    if (entry == FOLLOW_END_OF_RULE || entry == type) return true;
+                    if (entry == FOLLOW_EXPRESSION && starts_expression(type)) return true;
+                }
+                return false;
+            }
+
+            // A mismatch is reported as ANTLR's recovery sees it: an unwanted
+            // token when the expected one comes next, a missing token when the
+            // current one may follow it, and a mismatched token otherwise.
+            const token& match(int type, std::initializer_list<int> follow = {})
+            {
+                if (la(1).type != type) {
+                    const token& tok = la(1);
+                    const char* kind = MISMATCHED_TOKEN;
+                    if (la(2).type == type) kind = UNWANTED_TOKEN;
+                    else if (follows(tok.type, follow)) kind = MISSING_TOKEN;
+                    throw syntax_error(owner_, tok.line, tok.position, RECOGNITION_ERROR, kind);
+                }
+                return next();
+            }
+
+            node_ptr node(const token& tok) const
+            { return node_ptr(new syntax_node(tok.type, source_.substr(tok.begin, tok.end - tok.begin), tok.line, tok.position)); }
+
+            // Imaginary nodes have no token of their own, ANTLR reports them
+            // at the position of their first child.
+            node_ptr node(int type, const char* text, std::vector<node_ptr>& children) const
+            {
+                node_ptr result(new syntax_node(type, text, children.front()->line(), children.front()->position()));
+                for (auto& child : children) result->add_child(std::move(child));
+                return result;
+            }
+
+            node_ptr node(int type, const char* text, node_ptr child) const
+            {
+                std::vector<node_ptr> children;
+                children.push_back(std::move(child));
+                return node(type, text, children);
+            }
+
+            node_ptr inequality()
+            {
+                std::vector<node_ptr> children;
+                if (la(1).type != LIT_LBRACKET) children.push_back(left_bound());
+                match(LIT_LBRACKET, {FOLLOW_EXPRESSION});
+                node_ptr body = expr();
+                // ']' may end the inequality, but only EOF follows that, which
+                // the generated follow sets cannot hold
+                match(LIT_RBRACKET, {TOK_LEQ, TOK_GEQ, TOK_EQ});
+                if (is_relation(la(1).type)) children.push_back(right_bound());
+                children.push_back(std::move(body));
+                return node(TOK_INEQ, "TOK_INEQ", children);
+            }
+
+            // a left bound is rewritten to the relation seen from the expression
+            node_ptr left_bound()
+            {
+                node_ptr value = numeric_literal();
+                const token& op = la(1);
+                switch (op.type)
+                {
+                case TOK_LEQ:
+                    next();
+                    return node(TOK_GEQ, "TOK_GEQ", std::move(value));
+                case TOK_GEQ:
+                    next();
+                    return node(TOK_LEQ, "TOK_LEQ", std::move(value));
+                case TOK_EQ: {
+                    node_ptr result = node(next());
+                    result->add_child(std::move(value));
+                    return result;
+                }
+
+                default:
+                    no_viable_alternative();
+                }
+            }
+
+            node_ptr right_bound()
+            {
+                node_ptr result = node(next());
+                result->add_child(numeric_literal());
+                return result;
+            }
+
+            node_ptr numeric_literal()
+            {
+                if (!is_number(la(1).type)) no_viable_alternative();
+                return node(next());
+            }
+
+            node_ptr expr()
+            { return node(TOK_EXPR, "TOK_EXPR", add_expression()); }
+
+            node_ptr add_expression()
+            {
+                node_ptr left = mul_expression();
+                while (la(1).type == TOK_PLUS || la(1).type == TOK_MINUS) {
+                    node_ptr op = node(next());
+                    op->add_child(std::move(left));
+                    op->add_child(mul_expression());
+                    left = std::move(op);
+                }
+                return left;
+            }
+
+            node_ptr mul_expression()
+            {
+                node_ptr left = unr_expression();
+                while (la(1).type == TOK_MUL || la(1).type == TOK_DIV) {
+                    node_ptr op = node(next());
+                    op->add_child(std::move(left));
+                    op->add_child(unr_expression());
+                    left = std::move(op);
+                }
+                return left;
+            }
+
+            node_ptr unr_expression()
+            {
+                std::vector<node_ptr> children;
+                if (la(1).type == TOK_PLUS || la(1).type == TOK_MINUS)
+                    children.push_back(node(next()));
+                children.push_back(term());
+                return node(TOK_TERM, "TOK_TERM", children);
+            }
+
+            node_ptr term()
+            {
+                switch (la(1).type)
+                {
+                case TOK_INTEGER:
+                case TOK_FLOATING:
+                case TOK_STRING:
+                    return node(next());
+                case TOK_ID:
+                    if (la(2).type == LIT_LPAREN)
+                        return function_call();
+                    if (la(2).type == LIT_LBRACKET && la(3).type == TOK_ID && la(4).type == LIT_IN)
+                        return aggregate_call();
+                    return variable();
+                case TOK_FRAG:
+                    return frag();
+                case TOK_DETAIL:
+                    return detail();
+                case LIT_FILTER:
+                    return filter_call();
+                case LIT_LPAREN: {
+                    next();
+                    node_ptr inner = expr();
+                    match(LIT_RPAREN, {FOLLOW_END_OF_RULE});
+                    return inner;
+                }
+
+                default:
+                    no_viable_alternative();
+                }
+            }
+
+            node_ptr variable()
+            {
+                std::vector<node_ptr> children;
+                children.push_back(node(match(TOK_ID)));
+                if (la(1).type == LIT_LBRACKET) children.push_back(array_element());
+                return node(TOK_VAR, "TOK_VAR", children);
+            }
+
+            node_ptr named(node_ptr result)
+            {
+                if (la(1).type == TOK_ID)
+                    result->add_child(node(next()));
+                else if (la(1).type == LIT_LPAREN) {
+                    next();
+                    result->add_child(node(match(TOK_STRING, {FOLLOW_END_OF_RULE})));
+                    match(LIT_RPAREN, {FOLLOW_END_OF_RULE});
+                }
+                else
+                    no_viable_alternative();
+                return result;
+            }
+
+            node_ptr frag()
+            { return named(node(match(TOK_FRAG))); }
+
+            node_ptr detail()
+            {
+                node_ptr result = named(node(match(TOK_DETAIL, {TOK_ID, LIT_LPAREN})));
+                if (la(1).type == LIT_LBRACKET) result->add_child(array_element());
+                return result;
+            }
+
+            node_ptr array_element()
+            {
+                match(LIT_LBRACKET);
+                int type = la(1).type;
+                if (type != TOK_ID && type != TOK_INTEGER && type != TOK_STRING) no_viable_alternative();
+                node_ptr index = node(next());
+                match(LIT_RBRACKET, {FOLLOW_END_OF_RULE});
+                return node(TOK_ARRAY, "TOK_ARRAY", std::move(index));
+            }
+
+            node_ptr function_call()
+            {
+                std::vector<node_ptr> children;
+                children.push_back(node(match(TOK_ID)));
+                match(LIT_LPAREN);
+                children.push_back(expr());
+                while (la(1).type == LIT_COMMA) {
+                    next();
+                    children.push_back(expr());
+                }
+                match(LIT_RPAREN, {FOLLOW_END_OF_RULE});
+                return node(TOK_FUNC, "TOK_FUNC", children);
+            }
+
+            node_ptr aggregate_call()
+            {
+                std::vector<node_ptr> children;
+                children.push_back(node(match(TOK_ID)));
+                match(LIT_LBRACKET);
+                children.push_back(node(match(TOK_ID)));
+                match(LIT_IN);
+                if (la(1).type == TOK_ID)
+                    children.push_back(node(next()));
+                else if (la(1).type == TOK_DETAIL)
+                    children.push_back(detail());
+                else
+                    no_viable_alternative();
+                match(LIT_RBRACKET, {LIT_LBRACE});
+                match(LIT_LBRACE, {FOLLOW_EXPRESSION});
+                children.push_back(expr());
+                match(LIT_RBRACE, {FOLLOW_END_OF_RULE});
+                return node(TOK_AGG, "TOK_AGG", children);
+            }
+
+            node_ptr filter_call()
+            {
+                std::vector<node_ptr> children;
+                match(LIT_FILTER);
+                match(LIT_LBRACKET, {TOK_DETAIL});
+                children.push_back(detail());
+                match(LIT_RBRACKET, {LIT_LBRACE});
+                match(LIT_LBRACE, {FOLLOW_EXPRESSION});
+                children.push_back(expr());
+                match(LIT_RBRACE, {FOLLOW_END_OF_RULE});
+                return node(TOK_FILT, "TOK_FILT", children);
+            }
+
+        public:
+            parser(const expression& expr, const std::string& source)
+                : owner_(expr), source_(source), tokens_(tokenizer(expr, source).tokenize()) {}
+
+            node_ptr start()
+            {
+                bool inequality_ahead = la(1).type == LIT_LBRACKET ||
+                    (is_number(la(1).type) && is_relation(la(2).type));
+                node_ptr root = inequality_ahead ? inequality() : expr();
+                match(LIT_EOF);
+                return root;
+            }
+        };
+    }
+
+    std::unique_ptr<syntax_node> native_parser::parse(const expression& expr, const std::string& source)
+    {
+        return parser(expr, source).start();
+    }
+}
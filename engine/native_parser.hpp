@@ -0,0 +1,13 @@
+#pragma once
+
+namespace ethelo
+{
+    // Hand-written recursive-descent parser for language/expression.g.
+    // Builds the same trees as the generated ANTLR parser and raises
+    // syntax_error on the first lexical or syntactic error.
+    class native_parser
+    {
+    public:
+        static std::unique_ptr<syntax_node> parse(const expression& expr, const std::string& source);
+    };
+}
@@ -4,21 +4,51 @@
 
 using namespace ethelo;
 
+// mean influent and covariance of the rows of I
+static void moments(const arma::mat& I, arma::vec& mu, arma::mat& Q){
+	const double N = I.n_rows;
+	mu = sum(I,0).t()/N; // For dense matrices, this might be better
+	Q = arma::mat(I.t()*I/N - mu*mu.t());
+}
+
+ethelo_context::ethelo_context(const arma::mat& influents){
+	N = influents.n_rows;   // number of respondents
+	n = influents.n_cols;   // number of variables
+
+	vote_store::format format;
+	if (!vote_store::configured(format)){
+		moments(influents, mu, Q);
+		return;
+	}
+	
+	// sat and the gradient are computed from the store, so mu and Q are
+	//   built from the same stored values to keep the Hessian and x'Qx
+	//   consistent with them
+	votes = std::make_shared<vote_store>(influents, format);
+	arma::mat stored(N, n);
+	for (size_t c = 0; c < n; c++){
+		for (size_t r = 0; r < N; r++){
+			stored(r, c) = votes->at(r, c);
+		}
+	}
+	moments(stored, mu, Q);
+}
+
 nuclear_ethelo::nuclear_ethelo(const problem* p_):p_{p_}{
 	assert(p_ != nullptr);
 	
-	// Extract the relevant influent matrix and configuration
-	const auto& influents = p_->influents();
+	// mu and Q are computed once per scope of the problem and shared
+	ctx = p_->context();
 	const auto& config = p_->config();
-	N = influents.n_rows;   // number of respondents
-	n = influents.n_cols;   // number of variables
-
-	mu = sum(arma::mat(influents),0).t()/N; // For dense matrices, this might be better
-	Q = arma::mat(influents.t()*influents/N - mu*mu.t());
+	N = ctx->N;
+	n = ctx->n;
 	
 	// is ethelo function linear?
 	is_linear = (config.collective_identity <= 10.0 * std::numeric_limits<double>::epsilon() || N <= 1);
 	
+	// work vectors are reused across points
+	sat.set_size(N);
+	Qx.set_size(n);
 }
 
 void nuclear_ethelo::cache_new_x(const arma::vec& x){
@@ -27,7 +57,11 @@ void nuclear_ethelo::cache_new_x(const arma::vec& x){
     const auto& config = p_->config();
 	
 	// update satisfaction
-	sat = influents * x;
+	if (ctx->votes){
+		ctx->votes->multiply(x.memptr(), sat.memptr());
+	}else{
+		sat = influents * x;
+	}
 	if (config.per_option_satisfaction) {
 		double num_options = 0.0;
 		for (int i = 0; i < n; i++)
@@ -51,8 +85,14 @@ void nuclear_ethelo::update_grad_vars(const arma::vec& x){
     const auto& config = p_->config();
 	const double tipping_point = config.tipping_point;
 	
-	// Qx update 
-	Qx = influents.t()*(sat-support)/N;
+	// Qx update, I'(sat - support)/N = I'sat/N - support*mu without a temporary
+	if (ctx->votes){
+		ctx->votes->multiply_transpose(sat.memptr(), Qx.memptr());
+	}else{
+		Qx = influents.t()*sat;
+	}
+	Qx /= N;
+	Qx -= support*ctx->mu;
 	
 	// k update
 	double k_tipping = support;
@@ -69,6 +109,40 @@ void nuclear_ethelo::update_grad_vars(const arma::vec& x){
 
 double nuclear_ethelo::eval(const arma::vec& x, bool new_x){
 	if (new_x){	cache_new_x(x);	}
+	return score(support, dissonance);
+}
+
+void nuclear_ethelo::eval_batch(const arma::mat& X, double* values) const{
+	assert(X.n_rows == n);
+	const auto& config = p_->config();
+	const size_t m = X.n_cols;
+	
+	// satisfaction of every respondent (rows) in every column of X
+	arma::mat S;
+	if (ctx->votes){
+		S.set_size(N, m);
+		for (size_t j=0; j<m; j++){
+			ctx->votes->multiply(X.colptr(j), S.colptr(j));
+		}
+	}else{
+		S = p_->influents() * X;
+	}
+	
+	for (size_t j=0; j<m; j++){
+		if (config.per_option_satisfaction) {
+			double num_options = 0.0;
+			for (int i = 0; i < n; i++)
+				num_options += X(i, j);
+			
+			for(int i = 0; i < N; i++) {
+				S(i, j) = num_options >= 1.0 ? S(i, j) / num_options : 0.0;
+			}
+		}
+		values[j] = score(arma::sum(S.col(j)) / N, arma::var(S.col(j), 1));
+	}
+}
+
+double nuclear_ethelo::score(double support, double dissonance) const{
 	double fairness = 0.0;
     const auto& config = p_->config();
 	
@@ -97,11 +171,11 @@ arma::vec nuclear_ethelo::gradient(const arma::vec& x, bool new_x){
 	
 	arma::vec dfairness(n, arma::fill::zeros);
 	if (!is_linear){
-		dfairness = config.collective_identity*denom * (-2.0*Qx*k + (tipping_point - dissonance) * mu*muk);
+		dfairness = config.collective_identity*denom * (-2.0*Qx*k + (tipping_point - dissonance) * ctx->mu*muk);
 	}
 	
 	
-	const arma::vec grad = mu + dfairness;
+	const arma::vec grad = ctx->mu + dfairness;
 	return config.minimize ? grad : -grad;
 }
 
@@ -117,7 +191,47 @@ arma::mat nuclear_ethelo::hessian(const arma::vec& x, bool new_x){
 	
     const auto& config = p_->config();
 	
-    const arma::mat hess = config.collective_identity*denom * (-2.0*Q*k + 2.0*Qx*mu.t()*muk + 2.0*mu*Qx.t()*muk);
+    const arma::mat hess = config.collective_identity*denom * (-2.0*ctx->Q*k + 2.0*Qx*ctx->mu.t()*muk + 2.0*ctx->mu*Qx.t()*muk);
 	
 	return config.minimize ? hess : -hess;
-}
\ No newline at end of file
+}
+
+void nuclear_ethelo::gradient(const arma::vec& x, bool new_x, const std::vector<int>& index, double* grad){
+	if (new_x){ cache_new_x(x);}
+	if (!layer_2_updated){ update_grad_vars(x);}
+	
+	const auto& config = p_->config();
+	const double sign = config.minimize ? 1.0 : -1.0;
+	const double c = is_linear ? 0.0 : config.collective_identity*denom;
+	const double c_mu = 1.0 + c * (config.tipping_point - dissonance) * muk;
+	
+	for (size_t i=0; i<index.size(); i++){
+		const int a = index[i];
+		grad[i] = sign * (c_mu*ctx->mu[a] - 2.0*c*k*Qx[a]);
+	}
+}
+
+void nuclear_ethelo::hessian(const arma::vec& x, bool new_x, const std::vector<int>& index, double factor, double* values){
+	if (new_x){	cache_new_x(x);}
+	
+	const size_t n_out = index.size();
+	if (is_linear){
+		std::fill(values, values + n_out*(n_out+1)/2, 0.0);
+		return;
+	}
+	
+	if (!layer_2_updated){	update_grad_vars(x);}
+	
+	const auto& config = p_->config();
+	const double c = factor * (config.minimize ? 1.0 : -1.0) * config.collective_identity*denom;
+	
+	// same terms as hessian(x, new_x): c * (-2kQ + 2muk(Qx mu' + mu Qx'))
+	size_t pos = 0;
+	for (size_t i=0; i<n_out; i++){
+		const int a = index[i];
+		for (size_t j=0; j<=i; j++){
+			const int b = index[j];
+			values[pos++] = c * (-2.0*k*ctx->Q.at(a,b) + 2.0*muk*(Qx[a]*ctx->mu[b] + ctx->mu[a]*Qx[b]));
+		}
+	}
+}
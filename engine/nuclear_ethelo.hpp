@@ -1,19 +1,43 @@
 #pragma once
 
 #include <armadillo>
+#include <memory>
 #include <vector>
 
 namespace ethelo{
 
 class problem;
+class vote_store;
+
+/* ethelo_context holds the parts of the ethelo function that only depend on
+	the influents in scope: the mean influent mu and the covariance
+	Q = I'I/N - mu mu'. It is immutable once built, and shared by every
+	evaluator of a problem through problem::context().
+
+	When ENGINE_VOTE_STORE selects a compact format, votes also holds the
+	influents in that format, and mu, Q and the products with the influents
+	in nuclear_ethelo are all computed from the stored values. Each stored
+	entry is within 6e-8 relative (float32) or max |column| / 240 absolute
+	(int8) of the double one, so the function matches the double evaluation
+	only to that tolerance, but its value, gradient and Hessian agree with
+	each other.
+*/
+class ethelo_context{
+  public:
+	size_t N, n; // number of respondents and options
+	arma::vec mu;
+	arma::mat Q;
+	std::shared_ptr<const vote_store> votes; // null unless a compact store is configured
+	
+	ethelo_context(const arma::mat& influents);
+};
 
 // specialized class for evaluating ethelo function and its derivatives
 // Does not handle masking of variables
 class nuclear_ethelo{
 	// constant fields;
 	const problem* p_;
-	arma::vec mu;
-	arma::mat Q;
+	std::shared_ptr<const ethelo_context> ctx;
 	bool is_linear;
 	size_t n,N; // number of options and respondents 
 	
@@ -35,8 +59,30 @@ class nuclear_ethelo{
   public:
 	nuclear_ethelo(const problem* p_);
 	double eval(const arma::vec& x, bool new_x);
+
+	// score(support, dissonance) is the ethelo value of a point with that
+	//   support and dissonance, signed as config().minimize asks
+	double score(double support, double dissonance) const;
+
+	/* eval_batch(X, values) writes eval(X.col(j), true) to values[j] for
+		every column of X, getting the satisfaction of all columns from one
+		matrix-matrix product with the influents. Leaves the cached point of
+		eval/gradient/hessian untouched.
+	*/
+	void eval_batch(const arma::mat& X, double* values) const;
 	arma::vec gradient(const arma::vec& x, bool new_x);
 	arma::mat hessian(const arma::vec& x, bool new_x);
+
+	/* The overloads below write into caller-owned buffers and do not allocate.
+		Output i corresponds to x[index[i]]. hessian() scales the Hessian by
+		factor and writes its lower triangle row by row, i.e. entry (i,j) with
+		j <= i goes to values[i*(i+1)/2 + j].
+	*/
+	void gradient(const arma::vec& x, bool new_x, const std::vector<int>& index, double* grad);
+	void hessian(const arma::vec& x, bool new_x, const std::vector<int>& index, double factor, double* values);
+
+	// whether the ethelo function is linear, in which case its Hessian vanishes
+	bool linear() const { return is_linear;}
 };
 /*
 inline void arma2vec(const arma::vec& x, std::vector<double>& vec){
@@ -1,5 +1,6 @@
 #include "ethelo.hpp"
 #include "MathModel/MathProgram.hpp" // for assertions in linkMathProgram
+#include "nuclear_ethelo.hpp"
 namespace ethelo
 {
     problem::problem()
@@ -21,18 +22,24 @@ namespace ethelo
           displays_(other.displays_),
           influents_(other.influents_),
           exclusions_(other.exclusions_),
+          details_(other.details_),
           config_(other.config_),
+          context_(std::atomic_load(&other.context_)),
+          ranking_(std::atomic_load(&other.ranking_)),
 		  preproc_MP(other.preproc_MP)
     {}
 
     problem::problem(problem&& other)
-        : options_(std::move(other.options_)),
-          fragments_(std::move(other.fragments_)),
-          constraints_(std::move(other.constraints_)),
-          displays_(std::move(other.displays_)),
-          influents_(std::move(other.influents_)),
-          exclusions_(std::move(other.exclusions_)),
+        : options_(other.options_),
+          fragments_(other.fragments_),
+          constraints_(other.constraints_),
+          displays_(other.displays_),
+          influents_(other.influents_),
+          exclusions_(other.exclusions_),
+          details_(other.details_),
           config_(std::move(other.config_)),
+          context_(std::move(other.context_)),
+          ranking_(std::move(other.ranking_)),
 		  preproc_MP(std::move(other.preproc_MP))
     {}
 
@@ -44,7 +51,11 @@ namespace ethelo
         displays_ = other.displays_;
         influents_ = other.influents_;
         exclusions_ = other.exclusions_;
+        details_ = other.details_;
         config_ = other.config_;
+        std::atomic_store(&context_, std::atomic_load(&other.context_));
+        std::atomic_store(&ranking_, std::atomic_load(&other.ranking_));
+        exclude(arma::uvec()); // the scope of this problem does not carry over
 		preproc_MP = other.preproc_MP;
         return *this;
     }
@@ -59,10 +70,11 @@ namespace ethelo
         if (options.size() == 0)
             throw std::invalid_argument("a problem must have at least one option");
 
-        options_.load(options);
-        fragments_.load(fragments);
-        constraints_.load(constraints);
-        displays_.load(displays);
+        options_.reset().load(options);
+        details_ = detail_table(*options_);
+        fragments_.reset().load(fragments);
+        constraints_.reset().load(constraints);
+        displays_.reset().load(displays);
         load(influents);
         exclude(exclusions);
     }
@@ -76,12 +88,17 @@ namespace ethelo
                 throw std::invalid_argument("number of influent matrix columns does not match number of options");
             influents_ = influents;
         }
+        std::atomic_store(&context_, std::shared_ptr<const ethelo_context>());
+        std::atomic_store(&context_in_scope_, std::shared_ptr<const ethelo_context>());
+        std::atomic_store(&influents_in_scope_, std::shared_ptr<const arma::mat>());
+        std::atomic_store(&ranking_, std::shared_ptr<const enumeration_ranking>());
     }
 
 
     void problem::load(const std::vector<constraint>& constraints)
     {
-        constraints_.load(constraints);
+        constraints_.reset().load(constraints);
+        std::atomic_store(&ranking_, std::shared_ptr<const enumeration_ranking>());
     }
 
     void problem::exclude(const arma::mat& exclusions)
@@ -93,67 +110,126 @@ namespace ethelo
                 throw std::invalid_argument("number of exclusion matrix columns does not match number of options");
             exclusions_ = exclusions;
         }
+        std::atomic_store(&exclusions_in_scope_, std::shared_ptr<const arma::mat>());
     }
 
     void problem::exclude(const arma::uvec& exclusions) {
         excluded_details_.clear();
+        original_option_indexes_.reset();
+        scoped_option_indexes_.reset();
+        std::atomic_store(&influents_in_scope_, std::shared_ptr<const arma::mat>());
+        std::atomic_store(&exclusions_in_scope_, std::shared_ptr<const arma::mat>());
+        std::atomic_store(&context_in_scope_, std::shared_ptr<const ethelo_context>());
 
         if(exclusions.empty()) {
-            options_in_scope_.clear();
             return;
         }
 
-        size_t whitelist_size = options_.size()-exclusions.size();
-        size_t criteria_size = influents_.n_cols / options_.size(); 
-        std::vector<option> scoped_options(whitelist_size);
-        exclusions_in_scope_ = arma::mat(exclusions_.n_rows, whitelist_size); //scenario exclusions
-        influents_in_scope_ = arma::mat(influents_.n_rows, whitelist_size*criteria_size);
-        original_option_indexes_.resize(whitelist_size);
-
-        std::map<std::string, double> included_option_detail_sums;
-        std::map<std::string, double> excluded_option_detail_sums;
-
-        size_t target_i = 0;
-        for(size_t i = 0; i < options_.size(); i++) {
-            const auto& cur_option = options_[i];
-            std::map<std::string, double>* detail_sums_ptr;
-
-            if(!arma::any(exclusions == i)) {
-                PLOGD << "Including option: " << cur_option.name();
-                exclusions_in_scope_.col(target_i) = exclusions_.col(i);
-                for(size_t j = 0; j < criteria_size; j++)
-                  influents_in_scope_.col(j*criteria_size+target_i) = influents_.col(j*criteria_size+i);
-                scoped_options[target_i] = options_[i];
-                original_option_indexes_[target_i] = i;
-
-                detail_sums_ptr = &included_option_detail_sums; 
-                target_i++;
-            } else {
-                PLOGD << "Excluding option: " << cur_option.name();
-                detail_sums_ptr = &excluded_option_detail_sums; 
-            }
+        const size_t n = options_->size();
+        std::vector<bool> excluded(n, false);
+        for (auto i : exclusions)
+            if (i < n) excluded[i] = true;
 
-            for(auto cur_detail : cur_option.details()) {
-                (*detail_sums_ptr)[cur_detail.name()] += std::abs(cur_detail.value());
+        auto original_indexes = std::make_shared<std::vector<size_t>>();
+        auto scoped_indexes = std::make_shared<std::vector<std::ptrdiff_t>>(n, -1);
+
+        for(size_t i = 0; i < n; i++) {
+            if(!excluded[i]) {
+                PLOGD << "Including option: " << (*options_)[i].name();
+                (*scoped_indexes)[i] = original_indexes->size();
+                original_indexes->push_back(i);
+            } else {
+                PLOGD << "Excluding option: " << (*options_)[i].name();
             }
         }
 
-        options_in_scope_.load(scoped_options);
+        // with every option excluded, all of them stay in scope
+        if (!original_indexes->empty()) {
+            original_option_indexes_ = original_indexes;
+            scoped_option_indexes_ = scoped_indexes;
+        }
 
         // exclude details where:
         // 1) they are not set, or are 0, for in-scope options; and
         // 2) there is an excluded option that is non-zero; constraints with these excluded details will be relaxed 
-        for (std::pair<std::string, double> excluded_sum : excluded_option_detail_sums) {
-            if(std::abs(excluded_sum.second) > std::numeric_limits<double>::epsilon() &&
-               std::abs(included_option_detail_sums[excluded_sum.first]) < std::numeric_limits<double>::epsilon()) {
-                PLOGD << "Excluding detail: " << excluded_sum.first << "(sum in excluded options: " << excluded_sum.second <<
-                         "; sum in included options: " << included_option_detail_sums[excluded_sum.first] << ")";
-                excluded_details_.insert(excluded_sum.first);
+        for (size_t column = 0; column < details_->size(); column++) {
+            const double* values = details_->column(column);
+            double included_sum = 0.0, excluded_sum = 0.0;
+            for (size_t i = 0; i < n; i++)
+                (excluded[i] ? excluded_sum : included_sum) += std::abs(values[i]);
+
+            if(std::abs(excluded_sum) > std::numeric_limits<double>::epsilon() &&
+               std::abs(included_sum) < std::numeric_limits<double>::epsilon()) {
+                PLOGD << "Excluding detail: " << details_->name(column) << "(sum in excluded options: " << excluded_sum <<
+                         "; sum in included options: " << included_sum << ")";
+                excluded_details_.insert(details_->name(column));
             } 
         }
         PLOGD << "Excluded detail count: " << excluded_details_.size();
     }
 
+    // gather(source, cols, cache) returns the columns of source in scope,
+    // copied once into cache. Concurrent first calls may both gather them, but
+    // only the first copy is published, so a returned reference is never freed
+    // by another call
+    static const arma::mat& gather(const arma::mat& source, const std::vector<size_t>& cols,
+                                   std::shared_ptr<const arma::mat>& cache) {
+        std::shared_ptr<const arma::mat> gathered = std::atomic_load(&cache);
+        if (!gathered) {
+            arma::uvec scoped_cols(cols.size());
+            for (size_t i = 0; i < cols.size(); i++)
+                scoped_cols[i] = cols[i];
+            std::shared_ptr<const arma::mat> expected;
+            gathered = std::make_shared<const arma::mat>(source.cols(scoped_cols));
+            if (!std::atomic_compare_exchange_strong(&cache, &expected, gathered))
+                gathered = expected;
+        }
+        return *gathered;
+    }
+
+    const arma::mat& problem::influents() const {
+        if (!scoped()) return *influents_;
+        return gather(*influents_, *original_option_indexes_, influents_in_scope_);
+    }
+
+    const arma::mat& problem::exclusions() const {
+        if (!scoped()) return *exclusions_;
+        return gather(*exclusions_, *original_option_indexes_, exclusions_in_scope_);
+    }
+
+    std::shared_ptr<const ethelo_context> problem::context() const {
+        // concurrent first calls may both build the context; either result is valid
+        auto& cache = scoped() ? context_in_scope_ : context_;
+        std::shared_ptr<const ethelo_context> ctx = std::atomic_load(&cache);
+        if (!ctx) {
+            ctx = std::make_shared<ethelo_context>(influents());
+            std::atomic_store(&cache, ctx);
+        }
+        return ctx;
+    }
+
+    std::shared_ptr<const enumeration_ranking> problem::ranking() const {
+        return std::atomic_load(&ranking_);
+    }
+
+    void problem::keep_ranking(std::shared_ptr<const enumeration_ranking> ranking) {
+        std::atomic_store(&ranking_, ranking);
+    }
+
+    static size_t context_bytes(const std::shared_ptr<const ethelo_context>& ctx) {
+        if (!ctx) return 0;
+        return (ctx->mu.n_elem + ctx->Q.n_elem) * sizeof(double) + (ctx->votes ? ctx->votes->bytes() : 0);
+    }
+
+    size_t problem::matrix_bytes() const {
+        size_t bytes = (influents_->n_elem + exclusions_->n_elem) * sizeof(double) + details_->bytes();
+        for (const auto& cache : {std::atomic_load(&influents_in_scope_), std::atomic_load(&exclusions_in_scope_)})
+            if (cache) bytes += cache->n_elem * sizeof(double);
+        bytes += context_bytes(std::atomic_load(&context_));
+        bytes += context_bytes(std::atomic_load(&context_in_scope_));
+        return bytes;
+    }
+
     const bool problem::is_detail_excluded(const std::string detail_name) const {
         return excluded_details_.find(detail_name) != excluded_details_.end();
     }
@@ -162,8 +238,10 @@ namespace ethelo
 		assert(MP->n_var() == original_options().size());
 		assert(MP->getConsList().size() == constraints().size()); // no exclusions
 		this->preproc_MP = MP;
+		std::atomic_store(&ranking_, std::shared_ptr<const enumeration_ranking>());
 	}
 	void problem::unlinkMathProgram(){
 		this->preproc_MP = nullptr;
+		std::atomic_store(&ranking_, std::shared_ptr<const enumeration_ranking>());
 	}
 }
@@ -3,22 +3,38 @@
 namespace ethelo
 {
 	class MathProgram;
+	class ethelo_context;
+	class enumeration_ranking;
     class problem
     {
-        indexed_vector<option> options_;
-        indexed_vector<fragment> fragments_;
-        indexed_vector<constraint> constraints_;
-        indexed_vector<display> displays_;
-        arma::mat influents_;
-        arma::mat exclusions_;
+        // loaded data is immutable and shared between copies of a problem
+        shared<indexed_vector<option>> options_;
+        shared<indexed_vector<fragment>> fragments_;
+        shared<indexed_vector<constraint>> constraints_;
+        shared<indexed_vector<display>> displays_;
+        shared<arma::mat> influents_;
+        shared<arma::mat> exclusions_;
+        shared<detail_table> details_;
         configuration config_;
 
-        indexed_vector<option> options_in_scope_;
-        arma::mat influents_in_scope_;
-        arma::mat exclusions_in_scope_;
-        std::vector<size_t> original_option_indexes_;
+        // the scope is an index over the options; nullptr when all are in scope.
+        // Influents and exclusions of the scope are gathered on first use,
+        // since the ethelo products need them contiguous
+        std::shared_ptr<const std::vector<size_t>> original_option_indexes_;
+        std::shared_ptr<const std::vector<std::ptrdiff_t>> scoped_option_indexes_;
+        mutable std::shared_ptr<const arma::mat> influents_in_scope_;
+        mutable std::shared_ptr<const arma::mat> exclusions_in_scope_;
         std::set<std::string> excluded_details_;
 
+        // shared ethelo data of all options and of the options in scope, built
+        // on first use and dropped whenever the influents or the scope change
+        mutable std::shared_ptr<const ethelo_context> context_;
+        mutable std::shared_ptr<const ethelo_context> context_in_scope_;
+
+        // ranking of the last enumeration, kept while the influents, the
+        // constraints and the preprocessed program stay the same
+        std::shared_ptr<const enumeration_ranking> ranking_;
+
         void load(const std::vector<option>& options,
                   const std::vector<fragment>& fragments,
                   const std::vector<constraint>& constraints,
@@ -50,15 +66,29 @@ namespace ethelo
         const bool is_detail_excluded(const std::string detail_name) const;
 
         size_t dim() const { return options().size(); }
-        const indexed_vector<option>& options() const { return options_in_scope_.empty() ? options_ : options_in_scope_; }
-        const indexed_vector<option>& original_options() const { return options_; }
-        const size_t original_option_index(const size_t active_index) const { return options_in_scope_.empty() ? active_index : original_option_indexes_[active_index]; }
-        const indexed_vector<fragment>& fragments() const { return fragments_; }
-        const indexed_vector<constraint>& constraints() const { return constraints_; }
-        const indexed_vector<display>& displays() const { return displays_; }
-        const arma::mat& influents() const { return options_in_scope_.empty() ? influents_ : influents_in_scope_; }
-        const arma::mat& exclusions() const { return options_in_scope_.empty() ? exclusions_ : exclusions_in_scope_; }
+        bool scoped() const { return original_option_indexes_ != nullptr; }
+        indexed_view<option> options() const { return indexed_view<option>(*options_, original_option_indexes_, scoped_option_indexes_); }
+        const indexed_vector<option>& original_options() const { return *options_; }
+        const detail_table& details() const { return *details_; } // columns over original_options()
+        const size_t original_option_index(const size_t active_index) const { return scoped() ? (*original_option_indexes_)[active_index] : active_index; }
+        const indexed_vector<fragment>& fragments() const { return *fragments_; }
+        const indexed_vector<constraint>& constraints() const { return *constraints_; }
+        const indexed_vector<display>& displays() const { return *displays_; }
+        // influents and exclusions of the options in scope; the references
+        // stay valid until the next load or exclude
+        const arma::mat& influents() const;
+        const arma::mat& exclusions() const;
         const configuration& config() const { return config_; }
+        std::shared_ptr<const ethelo_context> context() const;
+
+        // ranking() returns the ranking of the last enumeration, or nullptr;
+        // it may have been made for another scope or configuration
+        // (see enumeration_ranking::matches)
+        std::shared_ptr<const enumeration_ranking> ranking() const;
+        void keep_ranking(std::shared_ptr<const enumeration_ranking> ranking);
+
+        // bytes of the matrices held: loaded data, scoped copies and ethelo contexts
+        virtual size_t matrix_bytes() const;
 		
 		void linkMathProgram(const MathProgram* MP);
 		void unlinkMathProgram();
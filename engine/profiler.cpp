@@ -0,0 +1,154 @@
+#include "profiler.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ethelo
+{
+    namespace profiler
+    {
+        const char* const counter_names[4] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+        namespace
+        {
+            std::atomic<span_timer*> timer_(nullptr);
+            std::atomic<bool> counting_(false);
+
+            const uint64_t events_[4] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES};
+
+            // the counters of one thread, opened as a group so they are read together
+            class counter_group
+            {
+                int fds_[4];
+                int error_;
+
+            public:
+                counter_group() : error_(0) {
+                    for (int k = 0; k < 4; k++) {
+                        perf_event_attr attr;
+                        std::memset(&attr, 0, sizeof(attr));
+                        attr.size = sizeof(attr);
+                        attr.type = PERF_TYPE_HARDWARE;
+                        attr.config = events_[k];
+                        attr.read_format = PERF_FORMAT_GROUP;
+                        attr.disabled = (k == 0);
+                        attr.exclude_kernel = 1;
+                        attr.exclude_hv = 1;
+
+                        // this thread, any cpu
+                        fds_[k] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, k == 0 ? -1 : fds_[0], 0));
+                        if (fds_[k] < 0) {
+                            error_ = errno;
+                            for (int j = 0; j < k; j++) close(fds_[j]);
+                            for (int j = 0; j < 4; j++) fds_[j] = -1;
+                            return;
+                        }
+                    }
+                    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+                }
+
+                ~counter_group() {
+                    for (int k = 0; k < 4; k++)
+                        if (fds_[k] >= 0) close(fds_[k]);
+                }
+
+                counter_group(const counter_group&) = delete;
+                counter_group& operator=(const counter_group&) = delete;
+
+                int error() const { return error_; }
+
+                bool read(std::array<uint64_t, 4>& values) const {
+                    if (fds_[0] < 0) return false;
+                    uint64_t buffer[5]; // number of events, then their values
+                    if (::read(fds_[0], buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) || buffer[0] != 4)
+                        return false;
+                    for (size_t k = 0; k < 4; k++) values[k] = buffer[k + 1];
+                    return true;
+                }
+            };
+
+            counter_group& thread_counters() {
+                thread_local counter_group group;
+                return group;
+            }
+
+            void write_string(std::ostream& out, const std::string& text) {
+                out << '"';
+                for (char c : text) {
+                    if (c == '"' || c == '\\') out << '\\' << c;
+                    else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+                    else out << c;
+                }
+                out << '"';
+            }
+        }
+
+        void start(span_timer& timer, bool perf_counters)
+        {
+            if (perf_counters && thread_counters().error() != 0)
+                throw std::runtime_error(std::string("cannot open hardware counters: ") + std::strerror(thread_counters().error()));
+            counting_ = perf_counters;
+            timer_ = &timer;
+        }
+
+        void stop()
+        {
+            timer_ = nullptr;
+            counting_ = false;
+        }
+
+        span_timer* timer()
+        {
+            return timer_;
+        }
+
+        bool read_counters(std::array<uint64_t, 4>& values)
+        {
+            return counting_ && thread_counters().read(values);
+        }
+
+        void write_trace(const span_timer& timer, std::ostream& out)
+        {
+            std::vector<span_timer::record> spans = timer.records();
+
+            // threads are numbered in the order of their first span
+            std::map<std::thread::id, size_t> threads;
+            for (const auto& rec : spans)
+                threads.insert(std::make_pair(rec.thread, threads.size() + 1));
+
+            out.precision(3);
+            out << std::fixed << "{\"traceEvents\":[";
+            bool first = true;
+            for (const auto& rec : spans) {
+                out << (first ? "\n" : ",\n");
+                first = false;
+
+                out << "{\"name\":";
+                write_string(out, rec.name);
+                out << ",\"cat\":\"ethelo\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threads[rec.thread]
+                    << ",\"ts\":" << rec.start * 1e6 << ",\"dur\":" << rec.seconds * 1e6;
+                if (rec.counted) {
+                    out << ",\"args\":{";
+                    for (size_t k = 0; k < rec.counters.size(); k++)
+                        out << (k ? "," : "") << '"' << counter_names[k] << "\":" << rec.counters[k];
+                    out << "}";
+                }
+                out << "}";
+            }
+            out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        }
+    }
+}
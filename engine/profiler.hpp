@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef ETHELO_PROFILING
+#error "profiler.hpp is only available in builds configured with -DENGINE_PROFILING=ON"
+#endif
+
+#include "span_timer.hpp"
+
+#include <ostream>
+
+namespace ethelo
+{
+    /*
+        The profiler records the spans of every thread in one span_timer, on
+        top of the timers installed by span_timer::scope, and can write them
+        as a Chrome trace (chrome://tracing, https://ui.perfetto.dev).
+
+        With hardware counters on, each span also carries the cycles,
+        instructions, cache misses and branch misses of its thread over the
+        span, read with perf_event_open. Counters of a thread are opened on
+        its first span and only count user space.
+
+        Only built with -DENGINE_PROFILING=ON.
+    */
+    namespace profiler
+    {
+        // names of the hardware counters, in the order of record::counters
+        extern const char* const counter_names[4];
+
+        /* start(timer, perf_counters) records the spans of all threads in
+            timer until stop(). Throws std::runtime_error when perf_counters
+            is set but the counters cannot be opened on the calling thread,
+            e.g. under a restrictive kernel.perf_event_paranoid.
+        */
+        void start(span_timer& timer, bool perf_counters);
+        void stop();
+
+        // the timer given to start(), or nullptr
+        span_timer* timer();
+
+        // the counters of the calling thread; false when counting is off or unavailable
+        bool read_counters(std::array<uint64_t, 4>& values);
+
+        // writes the spans of timer as Chrome trace events, one track per thread
+        void write_trace(const span_timer& timer, std::ostream& out);
+    }
+}
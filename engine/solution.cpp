@@ -6,19 +6,28 @@
 namespace ethelo{
 
 void solution::fill_success(const problem& p, const double* sol){
-	this->success = true;
-	this->status = "success";
-	
 	const int n = p.dim();
 	arma::vec vx(p.options().size(), arma::fill::zeros);
 
 	for (int i = 0; i < n; i++) {
 		if (sol[i] > 0.5) {
-			this->options.insert(p.options()[i].name());
 			vx(i) = 1.0;
 		}
 	}
-	this->fgh = solution::compute_fgh(p,vx);
+	fill_success(p, vx, solution::compute_fgh(p,vx));
+}
+
+void solution::fill_success(const problem& p, const arma::vec& vx, const arma::vec& fgh){
+	this->success = true;
+	this->status = "success";
+	
+	const int n = p.dim();
+	for (int i = 0; i < n; i++) {
+		if (vx(i) > 0.5) {
+			this->options.insert(p.options()[i].name());
+		}
+	}
+	this->fgh = fgh;
 
 	// map back to original option list (with no option exclusions)
 	PLOGD << "Mapping solution with blacklisted options back to original";
@@ -61,11 +70,14 @@ arma::vec solution::compute_fgh(const problem& p, const arma::vec& x){
 	assert(nuEth.eval(x,true) == fgh[0]);*/
 	
 	
-	//computes constraint values
-	const auto& ConsList = MP->getConsList();
-	for (size_t i=0; i<n_cons; i++){
-		fgh[i+1] = ConsList[i].expr->evaluate(full_x);
-	}
+	//computes constraint values, through the flat tapes of MP
+	std::shared_ptr<const ExprTape> consTape = MP->getConsTape();
+	std::shared_ptr<const ExprTape> displayTape = MP->getDisplayTape();
+	assert(consTape->n_outputs() == n_cons);
+	assert(displayTape->n_outputs() == n_displays);
+	std::vector<double> stack(std::max(consTape->stack_size(), displayTape->stack_size()));
+	
+	consTape->evaluate(full_x.memptr(), fgh.memptr() + 1, stack.data());
 	
 	// compute exclusion values
 	// note exclusions is not computed with MP, as they are not included
@@ -82,13 +94,61 @@ arma::vec solution::compute_fgh(const problem& p, const arma::vec& x){
 	
 	// computes display values
 	displacement = 1 + n_cons + n_excl;
-	const auto& displayList = MP->getDisplayList();
-	for (int i=0; i<p.displays().size(); i++){
-		fgh[displacement + i] = displayList[i]->evaluate(full_x);
-	}
+	displayTape->evaluate(full_x.memptr(), fgh.memptr() + displacement, stack.data());
 	
 	return fgh;
 
 }
 
+arma::mat solution::compute_fgh(const problem& p, const arma::mat& X){
+	assert(p.getPreproc_MP() != nullptr);
+	assert(X.n_rows == p.dim());
+	const MathProgram* MP = p.getPreproc_MP();
+	const size_t m = X.n_cols;
+	
+	size_t n_cons = p.constraints().size();
+	size_t n_excl = p.exclusions().n_rows;
+	size_t n_displays = p.displays().size();
+	
+	arma::mat fgh(1 + n_cons + n_excl + n_displays, m, arma::fill::zeros);
+	
+	// ethelo values, the way atomic_ethelo evaluates them without a mask
+	nuclear_ethelo eth(&p);
+	arma::rowvec ethelo(m);
+	eth.eval_batch(X, ethelo.memptr());
+	fgh.row(0) = ethelo;
+	
+	// the tapes take the points variable-major: full_xt(j, v) is variable v
+	//   of point j, with excluded options left at zero
+	arma::mat full_xt(m, p.original_options().size(), arma::fill::zeros);
+	for (size_t i=0; i<X.n_rows; i++){
+		full_xt.col(p.original_option_index(i)) = X.row(i).t();
+	}
+	
+	std::shared_ptr<const ExprTape> consTape = MP->getConsTape();
+	std::shared_ptr<const ExprTape> displayTape = MP->getDisplayTape();
+	assert(consTape->n_outputs() == n_cons);
+	assert(displayTape->n_outputs() == n_displays);
+	std::vector<double> stack(std::max(consTape->stack_size(), displayTape->stack_size()) * m);
+	
+	arma::mat cons(m, n_cons), displays(m, n_displays);
+	consTape->evaluate_batch(full_xt.memptr(), m, cons.memptr(), stack.data());
+	displayTape->evaluate_batch(full_xt.memptr(), m, displays.memptr(), stack.data());
+	if (n_cons > 0){ fgh.rows(1, n_cons) = cons.t();}
+	if (n_displays > 0){ fgh.rows(1 + n_cons + n_excl, n_cons + n_excl + n_displays) = displays.t();}
+	
+	// exclusion values, not part of the preprocessed data
+	for (size_t i=0; i<n_excl; i++){
+		const arma::rowvec excl = p.exclusions().row(i);
+		for (size_t j=0; j<m; j++){
+			double& count = fgh(1 + n_cons + i, j);
+			for (size_t k=0; k<X.n_rows; k++){
+				count += std::abs(X(k, j) - excl[k]);
+			}
+		}
+	}
+	
+	return fgh;
+}
+
 } // namespace ethelo
\ No newline at end of file
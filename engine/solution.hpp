@@ -2,6 +2,23 @@
 
 namespace ethelo
 {
+    // effort of the solver call behind a solution
+    struct solver_metrics
+    {
+        std::string solver;         // "cbc", "bonmin", "enumeration" or "evaluation", empty when no solver ran
+        double seconds = 0.0;       // wall time of the solver call, or of the whole batch for evaluation
+        size_t nodes = 0;           // branch and bound nodes, or scenarios visited by enumeration or evaluated
+        size_t iterations = 0;      // LP iterations for CBC, Ipopt iterations for Bonmin
+        size_t cuts = 0;            // cuts added by CBC's cut generators
+        size_t nlp_solves = 0;      // NLP relaxations solved by Bonmin
+
+        // the model handed to the solver, after linearization
+        size_t rows = 0;
+        size_t columns = 0;
+        size_t nonzeros = 0;        // constraint matrix (CBC) or Jacobian (Bonmin) entries
+        size_t rlt_variables = 0;   // product variables added by linearization
+    };
+
     struct solution
     {
         bool success = false;
@@ -9,12 +26,16 @@ namespace ethelo
         arma::vec x;
         arma::vec fgh;
         std::set<std::string> options;
+        solver_metrics metrics;
         operator bool() const { return success; }
 		
 		// completes solution object when solver successfully returned a solution sol
 		// sol should be an array of size p.dim()
 		void fill_success(const problem& p, const double* sol);
 		
+		// same, for a 0/1 point vx over p.options() whose fgh is already computed
+		void fill_success(const problem& p, const arma::vec& vx, const arma::vec& fgh);
+		
 		// completes solution object when solver does not return a solution
 		void fill_failure(const std::string& status);
 		
@@ -22,5 +43,10 @@ namespace ethelo
 		//   and display values. It is required that problem p has 
 		//   preproc_MP attached as it will be used for computation
 		static arma::vec compute_fgh(const problem& p, const arma::vec& x);
+		
+		// compute_fgh(p,X) computes compute_fgh(p, X.col(j)) as column j for
+		//   every column of X at once, from matrix-matrix products and batched
+		//   tape evaluation
+		static arma::mat compute_fgh(const problem& p, const arma::mat& X);
     };
 }
@@ -4,9 +4,9 @@
 #include "mathModelling.hpp"
 #include "solvers/solver_bonmin.hpp"
 #include "solvers/solver_cbc.hpp"
+#include "solvers/solver_enum.hpp"
 
 #include <stdexcept>
-#include "stopwatch.hpp"
 
 namespace ethelo{
 
@@ -14,7 +14,7 @@ namespace ethelo{
 FixVar_Mask solver::formFVMask(const problem& p){
 	FixVar_Mask FV(p.dim());
 	
-	auto &opts = p.options();
+	const auto& opts = p.options();
 	auto &infl = p.influents();
 	const int n = p.dim();
 	const int n_votes=infl.n_rows;
@@ -50,16 +50,16 @@ FixVar_Mask solver::formFVMask(const problem& p){
 	return FV;
 }
 
-MathProgram* solver::formMP(const problem& p){
+std::unique_ptr<MathProgram> solver::formMP(const problem& p){
 	FixVar_Mask FV = formFVMask(p); // mask for fixing active options
 	
-	MathProgram* MP = nullptr;
+	std::unique_ptr<MathProgram> MP;
 	
 	if (p.getPreproc_MP() == nullptr){
 		// if preprocessed data not available
 		// this only happens in some legacy testcases
 		
-		MP = new MathProgram(FV, p, true, true);
+		MP.reset(new MathProgram(FV, p, true, true));
 		MP->signalBridge(FV.makeBridge());
 		return MP;
 	}
@@ -68,7 +68,7 @@ MathProgram* solver::formMP(const problem& p){
 	assert(p.getPreproc_MP() != nullptr);
 	
 	// create extra mask FV1 for fixing inactive options
-	FixVar_Mask* FV1= new FixVar_Mask(p.original_options().size());
+	std::unique_ptr<FixVar_Mask> FV1(new FixVar_Mask(p.original_options().size()));
 	
 
 	// fix all options to 0 (ie. excluded)
@@ -82,19 +82,32 @@ MathProgram* solver::formMP(const problem& p){
 	FV1->update();
 
 
-	FV.addToFront(FV1); // apply FV1 before FV
+	FV.addToFront(FV1.get()); // apply FV1 before FV
+	FV1.release(); // FV1 will be deleted in Destructor of FV
 	MP = p.getPreproc_MP() -> createImage(FV);
 	MP->signalBridge(FV.makeBridge());
 	return MP;
-
-	// delete FV1; // FV1 will be deleted in Destructor of FV2
 }
 
 
-solution solver::solve(const problem& p){
-	MathProgram* MP = formMP(p);
+solution solver::solve(problem& p){
+	std::unique_ptr<MathProgram> MP;
+	{
+		span image("create_image");
+		MP = formMP(p);
+		image.memory("var_mask_depth", MP->getVM()->get_maxDepth());
+		image.memory("arena_bytes", MP->arena_bytes());
+	}
 	assert(MP->hasBridge());
 	
+	// few free options: visit every scenario, or reuse the ranking of the
+	//   previous sweep over the same problem
+	if (solver_enum::applicable(*MP)){
+		span timed("solve_enum");
+		solver_enum enumeration(MP.get(), p);
+		return enumeration.get_solution();
+	}
+	
 	// constants for future reference
 	const auto& infl = p.influents();
 	const bool ethelo_is_linear = (infl.n_rows == 1) || (p.config().collective_identity <= 10.0 * std::numeric_limits<double>::epsilon());
@@ -104,16 +117,21 @@ solution solver::solve(const problem& p){
 	// const bool useCBC = false;
 	
 	if (useCBC){
-		solver_CBC cbc(MP);
-		delete MP;
+		span timed("solve_cbc");
+		solver_CBC cbc(MP.get());
 		return cbc.get_solution();
 	}else{
 		// use bonmin
 		solver_bonmin bonsolve;
 		
-		MP->linearize(true); // easy linearization for fractions
-		bonsolve.solve(MP);
-		delete MP;
+		const size_t n_before = MP->n_var();
+		{
+			span linearize("linearize");
+			MP->linearize(true); // easy linearization for fractions
+		}
+		span timed("solve_bonmin");
+		bonsolve.solve(MP.get());
+		bonsolve.s.metrics.rlt_variables = MP->n_var() - n_before;
 		return bonsolve.s;
 	}
 }
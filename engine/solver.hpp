@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <vector>
 namespace ethelo
 {
@@ -8,7 +9,7 @@ namespace ethelo
     {
 		FixVar_Mask formFVMask(const problem& p);
     public:
-		MathProgram* formMP(const problem& p);
-        solution solve(const problem& p);
+		std::unique_ptr<MathProgram> formMP(const problem& p);
+        solution solve(problem& p); // p keeps the ranking of an enumeration
     };
 }
@@ -3,6 +3,7 @@
 
 #include "coin/BonBonminSetup.hpp"
 #include "coin/BonCbc.hpp"
+#include "coin/BonOsiTMINLPInterface.hpp"
 
 #include "solver_bonmin.hpp"
 #include "tminlp_MP.hpp"
@@ -10,6 +11,7 @@
 
 #include <stdio.h>
 #include <iostream>
+#include <chrono>
 
 namespace ethelo
 {
@@ -49,19 +51,51 @@ namespace ethelo
         bonmin.readOptionsString("oa_log_level 0\n");
         bonmin.readOptionsString("sb yes\n");
 
+        // model dimensions as Ipopt sees them
+        solver_metrics metrics;
+        metrics.solver = "bonmin";
+        {
+            Index n, m, nnz_jac_g, nnz_h_lag;
+            TNLP::IndexStyleEnum index_style;
+            if (tminlp->get_nlp_info(n, m, nnz_jac_g, nnz_h_lag, index_style)) {
+                metrics.rows = m;
+                metrics.columns = n;
+                metrics.nonzeros = nnz_jac_g;
+            }
+        }
+
         // solution s;
+        auto start = std::chrono::steady_clock::now();
         try {
           PLOGD << "Initialize bonmin";
-          bonmin.initialize(tminlp);
+		  {
+			  ETHELO_PROFILE_SPAN("bonmin_initialize");
+			  bonmin.initialize(tminlp);
+		  }
 		  Bab bb;
-		  bb(bonmin);
+		  {
+			  ETHELO_PROFILE_SPAN("bonmin_branch_and_bound");
+			  bb(bonmin);
+		  }
           PLOGD << "Generate tminlp result";
           s = tminlp->result();
+
+		  // the branch and bound works on its own copy of the NLP interface
+		  metrics.nodes = bb.numNodes();
+		  OsiTMINLPInterface* nlp = dynamic_cast<OsiTMINLPInterface*>(bb.model().solver());
+		  if (nlp) {
+			  metrics.iterations = nlp->totalIterations();
+			  metrics.nlp_solves = nlp->nCallOptimizeTNLP();
+		  } else {
+			  metrics.iterations = bb.iterationCount();
+		  }
         } catch (...) {
           PLOGD << "Unknown error in bonmin solver";
           s.success = false;
           s.status = "unknown_solver_error";
         }
+        metrics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        s.metrics = metrics;
 
 		// return s;
     }
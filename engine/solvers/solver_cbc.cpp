@@ -8,14 +8,17 @@
 #include "coin/OsiClpSolverInterface.hpp"
 #include "coin/CoinPackedVector.hpp"
 #include "coin/CbcModel.hpp"
+#include "coin/CbcCutGenerator.hpp"
 #include "coin/CoinPackedMatrix.hpp"
 
 #include <stdio.h>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <chrono>
 
 #include "../mathModelling.hpp"
+#include "../nuclear_ethelo.hpp"
 
 #define CBC_checkImage 0
 
@@ -27,12 +30,12 @@ solver_CBC::solver_CBC(MathProgram* MP):
 	_p{*(MP->getProblem())}{
 	assert(MP->is_linearizable());
 	
-	const auto& infl = _p.influents();
 	const int n_active_options = _p.dim();
 	
 	double raw_grad_f[n_active_options];
 	
-	arma::vec temp = arma::sum(infl, 0).t() / (infl.n_rows);
+	// the objective is linear, its gradient is the mean influent
+	arma::vec temp = _p.context()->mu;
 	temp *= (_p.config().minimize? 1.0 : -1.0 );
 	
 	for (int i = 0; i<n_active_options ; i++ ){
@@ -44,13 +47,16 @@ solver_CBC::solver_CBC(MathProgram* MP):
 
 double* solver_CBC::formulate( MathProgram& MP, const double* raw_grad_f, bool force_linearize, bool included_padding){
 	
+	const size_t n_before = MP.n_var();
 	if (MP.is_linearizable()){
+		ETHELO_PROFILE_SPAN("cbc_linearize");
 		MP.linearize(false);
 	}
 	else if (!force_linearize){
 		status = solver_CBC::STATUS::Invalid;
 		return nullptr;
 	}
+	metrics.rlt_variables = MP.n_var() - n_before;
 	
 	
 	status = STATUS::Unknown;
@@ -114,6 +120,10 @@ double* solver_CBC::formulate( MathProgram& MP, const double* raw_grad_f, bool f
 	MP.getVM()->mask(grad_f, raw_grad_f,reverse_depth);
 
 
+	metrics.rows = m;
+	metrics.columns = n;
+	metrics.nonzeros = CoinM.getNumElements();
+
 	OsiClpSolverInterface _model;
 	_model.loadProblem(CoinM, collb, colub, grad_f, rowlb, rowub);
 
@@ -137,8 +147,23 @@ double* solver_CBC::solve(OsiClpSolverInterface& model, const MathProgram& MP,in
 	model_cbc.setCutoffIncrement(1e-8);
 	model_cbc.setLogLevel(0); //mute CBC
 
-	model_cbc.initialSolve();
-	model_cbc.branchAndBound();
+	auto start = std::chrono::steady_clock::now();
+	{
+		ETHELO_PROFILE_SPAN("cbc_initial_solve");
+		model_cbc.initialSolve();
+	}
+	{
+		ETHELO_PROFILE_SPAN("cbc_branch_and_bound");
+		model_cbc.branchAndBound();
+	}
+
+	metrics.solver = "cbc";
+	metrics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	metrics.nodes = model_cbc.getNodeCount();
+	metrics.iterations = model_cbc.getIterationCount();
+	for (int i = 0; i < model_cbc.numberCutGenerators(); i++){
+		metrics.cuts += model_cbc.cutGenerator(i)->numberCutsInTotal();
+	}
 
 	if (!model_cbc.isProvenOptimal()){
 		// optimal solution not found
@@ -202,6 +227,7 @@ solution solver_CBC::get_solution(){
 		} // switch case
 	} // else
 
+	solObj.metrics = metrics;
 	return solObj;
 }
 
@@ -52,6 +52,7 @@ class solver_CBC{
 
 	STATUS status = STATUS::Uninitialized;
 	double* sol = nullptr;
+	solver_metrics metrics;
 
 	const double AbsTol = std::numeric_limits<double>::epsilon();
 	
@@ -0,0 +1,304 @@
+#include "solver_enum.hpp"
+#include "../ethelo.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../mathModelling.hpp"
+#include "../nuclear_ethelo.hpp"
+
+namespace ethelo{
+
+namespace{
+	typedef enumeration_ranking::entry entry;
+
+	// slack on the constraint bounds, since the sweep updates constraint
+	//   values incrementally
+	const double tolerance = 1e-7;
+
+	// every chunk of the sweep restarts from scratch and walks at most
+	//   2^chunk_bits scenarios, which bounds the drift of the updates
+	const size_t chunk_bits = 16;
+
+	bool higher(const entry& a, const entry& b){
+		return a.ethelo > b.ethelo || (a.ethelo == b.ethelo && a.code < b.code);
+	}
+
+	bool lower(const entry& a, const entry& b){
+		return a.ethelo < b.ethelo || (a.ethelo == b.ethelo && a.code < b.code);
+	}
+
+	// whether e would be among the first kept entries of list, sorted by before
+	template<typename Before>
+	bool enters(const std::vector<entry>& list, const entry& e, size_t kept, Before before){
+		return list.size() < kept || before(e, list.back());
+	}
+
+	template<typename Before>
+	void offer(std::vector<entry>& list, const entry& e, size_t kept, Before before){
+		if (!enters(list, e, kept, before)){ return;}
+		list.insert(std::upper_bound(list.begin(), list.end(), e, before), e);
+		if (list.size() > kept){ list.pop_back();}
+	}
+
+	struct chunk_ranking{
+		std::vector<entry> best, worst;
+		size_t candidates = 0; // scenarios meeting the linear constraints
+	};
+}
+
+const size_t solver_enum::default_kept;
+const size_t solver_enum::max_variables;
+
+bool enumeration_ranking::matches(const problem& p, const MathProgram& MP) const{
+	if (preproc != p.getPreproc_MP() || bridge != MP.getBridge() || scope.size() != p.dim()){
+		return false;
+	}
+	for (size_t i=0; i<scope.size(); i++){
+		if (scope[i] != p.original_option_index(i)){ return false;}
+	}
+	const auto& config = p.config();
+	return collective_identity == config.collective_identity &&
+		tipping_point == config.tipping_point &&
+		per_option_satisfaction == config.per_option_satisfaction;
+}
+
+bool solver_enum::applicable(const MathProgram& MP){
+	const size_t limit = std::min(MP.getProblem()->config().enumeration_limit, max_variables);
+	return MP.hasBridge() && MP.n_var() <= limit;
+}
+
+solver_enum::solver_enum(const MathProgram* MP, problem& p):
+	_p{p}, MP{*MP}{
+	assert(applicable(*MP));
+}
+
+void solver_enum::unmask(uint64_t code, double* x) const{
+	const auto& bridge = MP.getBridge();
+	for (size_t i=0; i<_p.dim(); i++){
+		const int id = bridge[i];
+		x[i] = (id >= 0 ? static_cast<double>((code >> id) & 1) : (id == -2 ? 1.0 : 0.0));
+	}
+}
+
+std::shared_ptr<const enumeration_ranking> solver_enum::sweep(size_t kept){
+	ETHELO_PROFILE_SPAN("enum_sweep");
+	const size_t k = MP.n_var();
+	const size_t n = _p.dim();
+	const auto& bridge = MP.getBridge();
+	const auto& config = _p.config();
+	const auto ctx = _p.context();
+	const nuclear_ethelo eth(&_p);
+
+	PLOGD << "Enumeration: sweeping " << (uint64_t(1) << k) << " scenarios, keeping " << kept;
+
+	/* The ethelo function only depends on the support mu'x and the
+		dissonance x'Qx (divided by the number of options and its square with
+		per option satisfaction). Flipping option o by d moves them by d*mu_o
+		and 2d(Qx)_o + Q_oo, so the sweep keeps Qx over the free options.
+	*/
+	std::vector<size_t> option_of(k);
+	arma::vec base(n, arma::fill::zeros);
+	for (size_t i=0; i<n; i++){
+		if (bridge[i] >= 0){
+			option_of[bridge[i]] = i;
+		}else if (bridge[i] == -2){
+			base[i] = 1.0;
+		}
+	}
+	const arma::vec Q_base_full = ctx->Q * base;
+	const double base_support = arma::dot(ctx->mu, base);
+	const double base_dissonance = arma::dot(base, Q_base_full);
+	const double base_count = arma::sum(base);
+
+	arma::vec mu(k), Q_base(k);
+	arma::mat Q(k, k);
+	for (size_t v=0; v<k; v++){
+		mu[v] = ctx->mu[option_of[v]];
+		Q_base[v] = Q_base_full[option_of[v]];
+		for (size_t w=0; w<k; w++){
+			Q(w, v) = ctx->Q(option_of[w], option_of[v]);
+		}
+	}
+
+	// linear constraints are updated with a column of A per flip, the others
+	//   are evaluated on the tape for scenarios that would be ranked. The
+	//   exclusions of _p come last and are left to get_solution
+	const auto& ConsList = MP.getConsList();
+	const size_t n_cons = ConsList.size() - _p.exclusions().n_rows;
+	std::vector<size_t> linear, others;
+	for (size_t r=0; r<n_cons; r++){
+		if (ConsList[r].Type == MathProgram::ConsType::Linear){
+			linear.push_back(r);
+		}else if (ConsList[r].Type != MathProgram::ConsType::VOID){
+			others.push_back(r);
+		}
+	}
+
+	const size_t m = linear.size();
+	arma::mat A(m, k);
+	arma::vec c(m), lb(m), ub(m);
+	for (size_t r=0; r<m; r++){
+		const MathProgram::MathCons& cons = ConsList[linear[r]];
+		assert(cons.expr->Type == MathExprNode::NodeType::LinearExp);
+		const LinExp* expr = static_cast<const LinExp*>(cons.expr);
+		A.row(r) = expr->get_coef().t();
+		c[r] = expr->get_const();
+		lb[r] = cons.lb - tolerance;
+		ub[r] = cons.ub + tolerance;
+	}
+	std::shared_ptr<const ExprTape> tape = (others.empty() ? nullptr : MP.getConsTape());
+
+	const size_t bits = std::min(k, chunk_bits);
+	const size_t n_chunks = size_t(1) << (k - bits);
+	std::vector<chunk_ranking> chunks(n_chunks);
+
+	// chunk j walks the Gray codes of j*2^bits, ..., (j+1)*2^bits - 1; the
+	//   t-th Gray code differs from the previous one in bit ctz(t)
+	thread_pool::global().parallel_for(n_chunks, [&](size_t j){
+		chunk_ranking& res = chunks[j];
+		const uint64_t first = uint64_t(j) << bits;
+		const uint64_t last = first + (uint64_t(1) << bits);
+		uint64_t code = first ^ (first >> 1);
+
+		arma::vec x(k);
+		for (size_t v=0; v<k; v++){ x[v] = static_cast<double>((code >> v) & 1);}
+		const arma::vec Qx_free = Q * x;
+		arma::vec Qx = Q_base + Qx_free;
+		arma::vec g = c + A * x;
+		double support = base_support + arma::dot(mu, x);
+		double dissonance = base_dissonance + 2.0 * arma::dot(Q_base, x) + arma::dot(x, Qx_free);
+		double count = base_count + arma::sum(x);
+
+		std::vector<double> point(k), out, stack;
+		if (tape != nullptr){
+			out.resize(tape->n_outputs());
+			stack.resize(tape->stack_size());
+		}
+
+		auto visit = [&](){
+			for (size_t r=0; r<m; r++){
+				if (g[r] < lb[r] || g[r] > ub[r]){ return;}
+			}
+			res.candidates++;
+
+			double s = support, d = dissonance;
+			if (config.per_option_satisfaction){
+				s = (count >= 1.0 ? s / count : 0.0);
+				d = (count >= 1.0 ? d / (count * count) : 0.0);
+			}
+			const double score = eth.score(s, d);
+			const entry e{config.minimize ? score : -score, code};
+			const bool best = enters(res.best, e, kept, higher);
+			const bool worst = enters(res.worst, e, kept, lower);
+			if (!best && !worst){ return;}
+
+			if (tape != nullptr){
+				for (size_t v=0; v<k; v++){ point[v] = static_cast<double>((code >> v) & 1);}
+				tape->evaluate(point.data(), out.data(), stack.data());
+				for (size_t r : others){
+					if (out[r] < ConsList[r].lb - tolerance || out[r] > ConsList[r].ub + tolerance){ return;}
+				}
+			}
+			if (best){ offer(res.best, e, kept, higher);}
+			if (worst){ offer(res.worst, e, kept, lower);}
+		};
+
+		visit();
+		for (uint64_t t = first + 1; t < last; t++){
+			const size_t v = __builtin_ctzll(t);
+			const double d = ((code >> v) & 1 ? -1.0 : 1.0);
+			code ^= uint64_t(1) << v;
+
+			dissonance += 2.0 * d * Qx[v] + Q(v, v);
+			const double* Q_v = Q.colptr(v);
+			for (size_t w=0; w<k; w++){ Qx[w] += d * Q_v[w];}
+			support += d * mu[v];
+			count += d;
+
+			const double* A_v = A.colptr(v);
+			for (size_t r=0; r<m; r++){ g[r] += d * A_v[r];}
+
+			visit();
+		}
+	});
+
+	auto ranking = std::make_shared<enumeration_ranking>();
+	ranking->bridge = bridge;
+	ranking->scope.resize(n);
+	for (size_t i=0; i<n; i++){ ranking->scope[i] = _p.original_option_index(i);}
+	ranking->preproc = _p.getPreproc_MP();
+	ranking->collective_identity = config.collective_identity;
+	ranking->tipping_point = config.tipping_point;
+	ranking->per_option_satisfaction = config.per_option_satisfaction;
+	ranking->kept = kept;
+
+	// with no more candidates than kept, no chunk turned a feasible one away
+	size_t candidates = 0;
+	for (const auto& res : chunks){
+		candidates += res.candidates;
+		for (const auto& e : res.best){ offer(ranking->best, e, kept, higher);}
+		for (const auto& e : res.worst){ offer(ranking->worst, e, kept, lower);}
+	}
+	ranking->complete = (candidates <= kept);
+
+	metrics.nodes += uint64_t(1) << k;
+	PLOGD << "Enumeration: " << candidates << " scenarios meet the linear constraints";
+	return ranking;
+}
+
+solution solver_enum::get_solution(){
+	const auto start = std::chrono::steady_clock::now();
+	const arma::mat& exclusions = _p.exclusions();
+	const size_t n = _p.dim();
+
+	std::shared_ptr<const enumeration_ranking> ranking = _p.ranking();
+	if (!ranking || !ranking->matches(_p, MP)){
+		ranking = sweep(std::max(default_kept, static_cast<size_t>(exclusions.n_rows) + 1));
+		_p.keep_ranking(ranking);
+	}
+
+	// the first ranked scenario that is not excluded; when all of them are,
+	//   a ranking of more scenarios than there are exclusions has the answer
+	std::vector<double> x(n);
+	bool found = false;
+	while (true){
+		const auto& list = (_p.config().minimize ? ranking->worst : ranking->best);
+		for (const auto& e : list){
+			unmask(e.code, x.data());
+
+			bool excluded = false;
+			for (size_t r=0; r<exclusions.n_rows && !excluded; r++){
+				double distance = 0.0;
+				for (size_t i=0; i<n; i++){ distance += std::abs(x[i] - exclusions(r, i));}
+				excluded = (distance < 0.5);
+			}
+			if (!excluded){
+				found = true;
+				break;
+			}
+		}
+		if (found || ranking->complete || ranking->kept > exclusions.n_rows){ break;}
+
+		ranking = sweep(std::max(2 * ranking->kept, static_cast<size_t>(exclusions.n_rows) + 1));
+		_p.keep_ranking(ranking);
+	}
+
+	metrics.solver = "enumeration";
+	metrics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	metrics.rows = MP.getConsList().size();
+	metrics.columns = MP.n_var();
+
+	solution solObj;
+	if (found){
+		PLOGD << "Enumeration: Finalizing successful solution";
+		solObj.fill_success(_p, x.data());
+	}else{
+		PLOGD << "Enumeration: no feasible scenario left";
+		solObj.fill_failure("infeasible");
+	}
+	solObj.metrics = metrics;
+	return solObj;
+}
+
+} //ethelo namespace
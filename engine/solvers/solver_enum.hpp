@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../ethelo.hpp"
+
+/* The class solver_enum solves a decision by visiting every scenario of its
+    free options, which only pays off when there are few of them; see
+    solver_enum::applicable
+*/
+
+namespace ethelo{
+
+class MathProgram;
+
+/*	enumeration_ranking is the outcome of one sweep over the scenarios of a
+	problem: the feasible scenarios with the highest and with the lowest
+	ethelo values, ignoring the exclusions of the problem. The top scenarios,
+	the worst one and every later scenario with more exclusions are read from
+	it without sweeping again (see problem::ranking()).
+
+	Scenarios are codes over the free variables of the image MathProgram: bit
+	v of a code is the value of variable v.
+*/
+class enumeration_ranking{
+  public:
+	struct entry{
+		double ethelo;	// unsigned, i.e. as if maximizing
+		uint64_t code;
+	};
+
+	// what the ranking was made for
+	std::vector<int> bridge;		// see MathProgram::getBridge()
+	std::vector<size_t> scope;		// original index of every option in scope
+	const MathProgram* preproc = nullptr;
+	double collective_identity, tipping_point;
+	bool per_option_satisfaction;
+
+	size_t kept;				// most entries kept in best and worst
+	bool complete;				// whether best and worst hold every feasible scenario
+	std::vector<entry> best;	// highest ethelo first, ties by code
+	std::vector<entry> worst;	// lowest ethelo first, ties by code
+
+	// matches(p, MP) tells whether the ranking was made for p with image MP
+	bool matches(const problem& p, const MathProgram& MP) const;
+};
+
+class solver_enum{
+	problem &_p;
+	const MathProgram &MP;
+	solver_metrics metrics;
+
+	// sweep(kept) visits every scenario and ranks the feasible ones
+	std::shared_ptr<const enumeration_ranking> sweep(size_t kept);
+
+	// unmask(code, x) writes the scenario of code over the options of _p
+	void unmask(uint64_t code, double* x) const;
+
+  public:
+	// entries kept at each end of a ranking, unless more exclusions ask for more
+	static const size_t default_kept = 16;
+
+	// decisions with more free variables are never enumerated
+	static const size_t max_variables = 30;
+
+	// applicable(MP) tells whether the free variables of MP, an image formed
+	//   by solver::formMP, are few enough to enumerate under the limit of
+	//   configuration::enumeration_limit
+	static bool applicable(const MathProgram& MP);
+
+	// Constructor. MP is an image formed by solver::formMP for p, with a
+	//   bridge; rankings are kept in p
+	solver_enum(const MathProgram* MP, problem& p);
+
+	/* get_solution() returns the best scenario that is not excluded from
+		the problem (the worst one when config().minimize is set), sweeping
+		only when the ranking kept by the problem does not cover it
+	*/
+	solution get_solution();
+};
+
+}
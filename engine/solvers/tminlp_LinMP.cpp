@@ -14,40 +14,42 @@ tminlp_LinMP::lin_cons_set::lin_cons_set(const MathProgram* MP){
 	assert(MP->is_linear());
 	
 	const auto& consList = MP->getConsList();
-	const int n = MP->n_var();
 	const int m = consList.size();
 	
-	// extract A,b;
-	A.resize(m,n);
+	// extract the nonzeros of A row by row, and b
+	row_begin.resize(m+1);
 	b.resize(m);
+	row_begin[0] = 0;
 	for (int i=0;i<m;i++){
 		const LinExp* expr = static_cast<LinExp*>(consList[i].expr);
-		A.row(i) = expr->get_coef().t();
-		b.at(i) = expr->get_const();
-		
-	}
-	// extract information about jac_g
-	iRow.clear();
-	jCol.clear();
-	nnz_elem.clear();
-	for (int i=0;i<m;i++){
-		for (int j=0;j<n;j++){
-			if (A.at(i,j) == 0.0){ continue;}
-			iRow.push_back(i);
+		const arma::vec& a = expr->get_coef();
+		for (int j=0;j<a.n_elem;j++){
+			if (a[j] == 0.0){ continue;}
 			jCol.push_back(j);
-			nnz_elem.push_back(A.at(i,j));
+			nnz_elem.push_back(a[j]);
 		}
+		row_begin[i+1] = jCol.size();
+		b[i] = expr->get_const();
 	}
 	
-	iRow.shrink_to_fit();
 	jCol.shrink_to_fit();
 	nnz_elem.shrink_to_fit();
 	
 	nnz_A = nnz_elem.size();
-	assert(iRow.size() == nnz_A);
 	assert(jCol.size() == nnz_A);
 }
 
+void tminlp_LinMP::lin_cons_set::eval(const double* x, double* g) const{
+	const int m = b.size();
+	for (int i=0;i<m;i++){
+		double sum = b[i];
+		for (int pos = row_begin[i]; pos < row_begin[i+1]; pos++){
+			sum += nnz_elem[pos] * x[jCol[pos]];
+		}
+		g[i] = sum;
+	}
+}
+
 
 // ======= tminlp_LinMP functions ============
 
@@ -85,22 +87,20 @@ tminlp_LinMP::tminlp_LinMP(const MathProgram* MP):
 		}
 		assert(pos == n);
 	}
+	
+	x_expanded = x_init;
+	g_vals.resize(m);
 }
 
 void tminlp_LinMP::cache_new_x(int n, const double* x){
-	arma::vec x_vec(n);
+	// copies into the existing storage of x_expanded
 	x_expanded = x_init;
 	for (int i=0;i<n;i++){ 
-		x_vec[i] = x[i];
 		x_expanded[expand_mask[i]] = x[i];
 	}
 	
-	fg_vals = arma::zeros(m+1);
-	fg_vals[0] = eth.eval(x_expanded, true);
-	const arma::vec g_val = fun_g.A * x_vec + fun_g.b;
-	for (int i=0; i<m; i++){
-		fg_vals[i+1] = g_val[i];
-	}
+	f_val = eth.eval(x_expanded, true);
+	fun_g.eval(x, g_vals.data());
 }
 
 // =============== BONMIN functions for setup ==================
@@ -159,7 +159,7 @@ bool tminlp_LinMP::eval_f(Index n, const Number* x, bool new_x, Number& obj_valu
 {
 	if (new_x){ cache_new_x(n,x);}
 	
-	obj_value = fg_vals[0];
+	obj_value = f_val;
 	return true;
 }
 
@@ -167,12 +167,8 @@ bool tminlp_LinMP::eval_grad_f(Index n, const Number* x, bool new_x, Number* gra
 {
 	if (new_x){ cache_new_x(n,x);}
 	
-	const arma::vec grad_vec = eth.gradient(x_expanded, false);// eth updated in cache_new_x
-	
 	// Omit partials wrt. fixed variables
-	for (int i=0;i<n;i++){
-		grad_f[i] = grad_vec[expand_mask[i]];
-	}
+	eth.gradient(x_expanded, false, expand_mask, grad_f);// eth updated in cache_new_x
 	return true;
 }
 
@@ -181,7 +177,7 @@ bool tminlp_LinMP::eval_g(Index n, const Number* x, bool new_x, Index m, Number*
 	if (new_x){ cache_new_x(n,x);}
 	
 	for (int i=0;i<m;i++){ 
-		g[i] = fg_vals[i+1]; 
+		g[i] = g_vals[i]; 
 	}
 	
 	return true;
@@ -194,14 +190,15 @@ bool tminlp_LinMP::eval_jac_g(Index n, const Number* x, bool new_x,
 	if (new_x){ cache_new_x(n,x);}
 	
 	assert(nele_jac == fun_g.nnz_A);
-	assert(n == fun_g.A.n_cols);
-	assert(m == fun_g.A.n_rows);
+	assert(m == fun_g.b.size());
 	
 	if (values == nullptr){
 		// extracts positions of nonzero elements
-		for (int pos =0; pos < fun_g.nnz_A; pos++){
-			iRow[pos] = fun_g.iRow[pos];
-			jCol[pos] = fun_g.jCol[pos];
+		for (int i=0;i<m;i++){
+			for (int pos = fun_g.row_begin[i]; pos < fun_g.row_begin[i+1]; pos++){
+				iRow[pos] = i;
+				jCol[pos] = fun_g.jCol[pos];
+			}
 		}
 		return true;
 	}else{
@@ -240,18 +237,9 @@ bool tminlp_LinMP::eval_h(Index n, const Number* x, bool new_x,
 	else{
 		// compute hessian
 		// safely ignore lambdas as all constraints are linear
-	
-		const arma::mat hess = obj_factor * eth.hessian(x_expanded, false); // eth updated in cache_new_x
-		
-		// make sure to use same order of traversial as setting positions
-		// Omit partials wrt. fixed variables
-		for (int i=0;i<n;i++){
-			for (int j=0; j <= i;j++){
-				values[pos] = hess.at(expand_mask[i],expand_mask[j]);
-				pos ++;
-			}
-		}
-		assert(pos == nele_hess);
+		// writes in the same order of traversial as setting positions,
+		//   omitting partials wrt. fixed variables
+		eth.hessian(x_expanded, false, expand_mask, obj_factor, values); // eth updated in cache_new_x
 		return true;
 	}
 }
\ No newline at end of file
@@ -15,19 +15,20 @@ namespace coin {
 	
     class tminlp_LinMP : public tminlp_Base
     {
-		// structure for rewriting constraints g(x)=Ax+b
+		// structure for rewriting constraints g(x)=Ax+b, with A stored row by row
 		struct lin_cons_set{
-			arma::mat A;
-			arma::vec b;
-			
-			// info for nonzeron elements
-			int nnz_A;
-			std::vector<int> iRow, jCol;
+			// nonzeros of row i are jCol/nnz_elem[row_begin[i] .. row_begin[i+1])
+			std::vector<int> row_begin;
+			std::vector<int> jCol;
 			std::vector<double> nnz_elem;
+			std::vector<double> b;
+			int nnz_A;
 			
 			// constructor, requires all constraints in MP to be linear
 			lin_cons_set(const MathProgram* MP);
 			
+			// g = Ax + b
+			void eval(const double* x, double* g) const;
 		};
 		
 		// const MathProgram* MP;
@@ -39,9 +40,10 @@ namespace coin {
 		arma::vec x_init;
 		std::vector<int> expand_mask;
 		
-		// cache
+		// cache, sized once in the constructor so evaluations do not allocate
 		arma::vec x_expanded;
-		arma::vec fg_vals;
+		double f_val;
+		std::vector<double> g_vals;
 		
 		inline void cache_new_x(int n, const double* x);
 
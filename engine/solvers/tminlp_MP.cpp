@@ -2,94 +2,282 @@
 #include "../mathModelling.hpp"
 
 #include "tminlp_MP.hpp"
+#include <iomanip>
+
 namespace ethelo {
 namespace coin {
-	
-inline bool feq(const double& a, const double& b){
-	return fabs(a-b)<1e-8;
+
+// ===================  nonlinear_rows members ===================
+
+tminlp_MP::nonlinear_rows::nonlinear_rows(const std::string& key, const std::vector<const MathExprNode*>& exprs, size_t n):
+	key{key}{
+	const size_t m = exprs.size();
+
+	// record the rows through their flat tape
+	const ExprTape tape(exprs);
+	ADvector ax(n), ay(m);
+	std::vector<AD> stack(tape.stack_size());
+	for (size_t j=0; j<n; j++){
+		ax[j] = 0.0;
+	}
+	CppAD::Independent(ax);
+	tape.evaluate(n > 0 ? &ax[0] : nullptr, &ay[0], stack.data());
+	fun.Dependent(ax, ay);
+	fun.optimize();
+
+	// structural sparsity of every row; CppAD wants the full symmetric Hessian pattern
+	std::set<std::pair<size_t,size_t>> hes_lower;
+	jac_pattern.resize(m);
+	hes_pattern.resize(n);
+	for (size_t i=0; i<m; i++){
+		const ExprSparsity sp = exprs[i]->sparsity();
+		jac_pattern[i] = sp.support;
+		for (size_t j : sp.support){
+			jac_row.push_back(i);
+			jac_col.push_back(j);
+		}
+		for (const auto& entry : sp.hessian){
+			hes_pattern[entry.first].insert(entry.second);
+			hes_pattern[entry.second].insert(entry.first);
+		}
+		hes_lower.insert(sp.hessian.begin(), sp.hessian.end());
+	}
+	for (const auto& entry : hes_lower){
+		hes_row.push_back(entry.first);
+		hes_col.push_back(entry.second);
+	}
 }
-	
-// ===================  EvalWrapper members ===================
 
+// ===================  tape cache ===================
 
-tminlp_MP::EvalWrapper::EvalWrapper( const MathProgram* MP): 
-	MP{MP}, eth("EvalWrapper", MP){}
+std::mutex tminlp_MP::cache_mutex;
+std::list<std::unique_ptr<tminlp_MP::nonlinear_rows>> tminlp_MP::cache;
+const size_t tminlp_MP::cache_capacity = 8;
+uint64_t tminlp_MP::cache_hits = 0;
 
-void tminlp_MP::EvalWrapper::evaluate(ADvector& fg, ADvector& x){
-	// mimics evaluator::evaluate
-	assert(x.size() == MP->n_var());
-	const auto& consList = MP->getConsList();
-	fg.resize(1 + consList.size());
-	
-	ADvector temp_ethelo(1);
-	eth(x, temp_ethelo);
-	fg[0] = temp_ethelo[0];
-	
-	for (int i=0;i<consList.size();i++){
-		fg[i+1] = consList[i].expr->evaluate(x);
+std::unique_ptr<tminlp_MP::nonlinear_rows> tminlp_MP::checkout_tape(const std::string& key){
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	for (auto it = cache.begin(); it != cache.end(); it++){
+		if ((*it)->key == key){
+			std::unique_ptr<nonlinear_rows> rows = std::move(*it);
+			cache.erase(it);
+			cache_hits++;
+			return rows;
+		}
 	}
-	// exclusions are included within consList
+	return nullptr;
+}
+
+void tminlp_MP::return_tape(std::unique_ptr<nonlinear_rows> rows){
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cache.push_front(std::move(rows)); // most recently used first
+	while (cache.size() > cache_capacity){
+		cache.pop_back();
+	}
+}
+
+uint64_t tminlp_MP::tape_cache_hits(){
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return cache_hits;
+}
+
+void tminlp_MP::clear_tape_cache(){
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cache.clear();
 }
 
 // ===================  tminlp_MP members ===============
 tminlp_MP::tminlp_MP(const MathProgram* MP):
-	tminlp_Base(MP), fg_eval_(MP){
-		PLOGD << "tminlp_MP constructor";
-		const problem& p_ = *(MP->getProblem());
-		size_t n = MP->n_var();
-		xi_.resize(n);
-        xl_.resize(n);
-        xu_.resize(n);
-        for (int i = 0; i < n; i++) {
-            xi_[i] = 0.0; 
-            xl_[i] = 0.0;
-            xu_[i] = 1.0;
-        }
-		
-		// constraint bounds
-		const auto& cons = MP->getConsList();
-        size_t m = cons.size();
-        gl_.resize(m);
-        gu_.resize(m);
-        for (int i = 0; i < cons.size(); i++) {
-            gl_[i] = cons[i].lb;
-            gu_[i] = cons[i].ub;
-        }
-		
-        PLOGD << "TMINLP reset";
-        solve_callback_.reset(new CppAD::ipopt::solve_callback<Dvector, ADvector, EvalWrapper>(
-            1,
-            n,
-            m,
-            xi_,
-            xl_,
-            xu_,
-            gl_,
-            gu_,
-            fg_eval_,
-            false, // retape
-            false, // sparse_forward
-            false, // sparse_reverse
-            solve_result_
-        ));
-        PLOGD << "TMINLP constructor end";
-	
-}
-
-// For general Problems, we'll just let solve_callback_ handle everything
+	tminlp_Base(MP), eth(MP->getProblem()),
+	n{MP->n_var()}, m{MP->getConsList().size()}
+{
+	PLOGD << "tminlp_MP constructor";
+
+	// handles fixed variables, see tminlp_LinMP
+	const int expanded_dim = MP->getProblem()->dim();
+
+	expand_mask.resize(n);
+	x_init = arma::vec(expanded_dim, arma::fill::zeros);
+	if (!MP->hasBridge()){
+		for (int i=0;i<n;i++){
+			expand_mask[i]=i;
+		}
+	}else{
+		const auto& bridge = MP->getBridge();
+		assert(expanded_dim == bridge.size());
+		int pos = 0;
+		for (int i=0;i<expanded_dim;i++){
+			// check FixVar_Mask::makeBridge for interpretation of bridge vector
+			if ( bridge[i] == -1){
+				x_init[i] = 0.0;
+			}else if ( bridge[i] == -2){
+				x_init[i] = 1.0;
+			}else{
+				expand_mask[pos] = i;
+				pos ++;
+			}
+		}
+		assert(pos == n);
+	}
+
+	// split constraints into linear rows and taped rows
+	const auto& consList = MP->getConsList();
+	std::vector<const MathExprNode*> nl_exprs;
+	std::ostringstream key;
+	key << std::setprecision(17) << n << std::endl;
+
+	lin_begin.push_back(0);
+	for (size_t i=0; i<m; i++){
+		const MathExprNode* expr = consList[i].expr;
+		if (expr == nullptr || consList[i].isLinear()){
+			lin_rows.push_back(i);
+			lin_const.push_back(0.0);
+			if (expr != nullptr){
+				const LinExp* lin = static_cast<const LinExp*>(expr);
+				const arma::vec& a = lin->get_coef();
+				for (size_t j=0; j<a.n_elem; j++){
+					if (a[j] == 0.0){ continue;}
+					lin_col.push_back(j);
+					lin_val.push_back(a[j]);
+				}
+				lin_const.back() = lin->get_const();
+			}
+			lin_begin.push_back(lin_col.size());
+		}else{
+			nl_rows.push_back(i);
+			nl_exprs.push_back(expr);
+			expr->save(key);
+		}
+	}
+
+	if (!nl_rows.empty()){
+		nl = checkout_tape(key.str());
+		if (!nl){
+			PLOGD << "Taping " << nl_rows.size() << " nonlinear constraints";
+			nl.reset(new nonlinear_rows(key.str(), nl_exprs, n));
+		}
+	}
+
+	// Jacobian structure, rows in the order of consList
+	std::vector<size_t> lin_id(m, m), nl_id(m, m);
+	for (size_t k=0; k<lin_rows.size(); k++){ lin_id[lin_rows[k]] = k;}
+	for (size_t k=0; k<nl_rows.size(); k++){ nl_id[nl_rows[k]] = k;}
+
+	std::vector<size_t> nl_row_begin(nl_rows.size() + 1, 0);
+	if (nl){
+		for (size_t i : nl->jac_row){ nl_row_begin[i+1]++;}
+		for (size_t k=0; k<nl_rows.size(); k++){ nl_row_begin[k+1] += nl_row_begin[k];}
+		nl_jac_pos.resize(nl->jac_row.size());
+	}
+
+	for (size_t i=0; i<m; i++){
+		if (lin_id[i] < m){
+			const size_t k = lin_id[i];
+			for (size_t pos = lin_begin[k]; pos < lin_begin[k+1]; pos++){
+				jac_iRow.push_back(i);
+				jac_jCol.push_back(lin_col[pos]);
+				jac_vals.push_back(lin_val[pos]);
+			}
+		}else{
+			// nl->jac_row is sorted, so the nonzeros of a tape row are contiguous
+			const size_t k = nl_id[i];
+			for (size_t pos = nl_row_begin[k]; pos < nl_row_begin[k+1]; pos++){
+				nl_jac_pos[pos] = jac_vals.size();
+				jac_iRow.push_back(i);
+				jac_jCol.push_back(nl->jac_col[pos]);
+				jac_vals.push_back(0.0);
+			}
+		}
+	}
+
+	// Hessian structure
+	dense_hessian = !eth.linear();
+	if (dense_hessian){
+		for (size_t i=0; i<n; i++){
+			for (size_t j=0; j<=i; j++){
+				hes_iRow.push_back(i);
+				hes_jCol.push_back(j);
+			}
+		}
+	}
+	if (nl){
+		nl_hes_pos.resize(nl->hes_row.size());
+		for (size_t k=0; k<nl->hes_row.size(); k++){
+			const size_t i = nl->hes_row[k], j = nl->hes_col[k];
+			if (dense_hessian){
+				nl_hes_pos[k] = i*(i+1)/2 + j;
+			}else{
+				nl_hes_pos[k] = hes_iRow.size();
+				hes_iRow.push_back(i);
+				hes_jCol.push_back(j);
+			}
+		}
+	}
+
+	PLOGD << "TMINLP constructor end";
+}
+
+tminlp_MP::~tminlp_MP(){
+	if (nl){
+		return_tape(std::move(nl));
+	}
+}
+
+void tminlp_MP::cache_new_x(int n, const double* x){
+	x_vec.assign(x, x + n);
+	x_expanded = x_init;
+	for (int i=0;i<n;i++){
+		x_expanded[expand_mask[i]] = x[i];
+	}
+
+	fg_vals = arma::zeros(m+1);
+	fg_vals[0] = eth.eval(x_expanded, true);
+
+	for (size_t k=0; k<lin_rows.size(); k++){
+		double sum = 0.0;
+		for (size_t pos = lin_begin[k]; pos < lin_begin[k+1]; pos++){
+			sum += lin_val[pos] * x[lin_col[pos]];
+		}
+		fg_vals[lin_rows[k]+1] = sum + lin_const[k];
+	}
+
+	if (nl){
+		const std::vector<double> y = nl->fun.Forward(0, x_vec);
+		for (size_t k=0; k<nl_rows.size(); k++){
+			fg_vals[nl_rows[k]+1] = y[k];
+		}
+	}
+}
+
+// =============== BONMIN functions for setup ==================
 
 bool tminlp_MP::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
 								Index& nnz_h_lag, TNLP::IndexStyleEnum& index_style)
 {
-	
-	return solve_callback_->get_nlp_info(n, m, nnz_jac_g, nnz_h_lag, index_style);
-	
+	n = this->n;
+	m = this->m;
+	nnz_jac_g = jac_vals.size();
+	nnz_h_lag = hes_iRow.size();
+	index_style = TNLP::C_STYLE;
+	return true;
 }
 
 bool tminlp_MP::get_bounds_info(Index n, Number* x_l, Number* x_u,
 								   Index m, Number* g_l, Number* g_u)
 {
-	return solve_callback_->get_bounds_info(n, x_l, x_u, m, g_l, g_u);
+	assert(n == this->n);
+	assert(m == this->m);
+	for (int i=0;i<n;i++){
+		x_l[i] = 0.0;
+		x_u[i] = 1.0; // all variables are binary
+	}
+
+	const auto& consList = MP->getConsList();
+	for (int j=0;j<m;j++){
+		g_l[j] = consList[j].lb;
+		g_u[j] = consList[j].ub;
+	}
+	return true;
 }
 
 bool tminlp_MP::get_starting_point(Index n, bool init_x, Number* x,
@@ -97,29 +285,84 @@ bool tminlp_MP::get_starting_point(Index n, bool init_x, Number* x,
 									  Index m, bool init_lambda,
 									  Number* lambda)
 {
-	return solve_callback_->get_starting_point(n, init_x, x, init_z, z_L, z_U, m, init_lambda, lambda);
+	assert(init_x);
+	assert( ! init_z);
+	assert( ! init_lambda);
+
+	// initialize with point zero; this point is arbitrarily chosen
+	for (int i=0;i<n; i++){
+		x[i] = 0.0;
+	}
+	return true;
 }
 
+// ================ BONMIN Evaluation functions =============
+
 bool tminlp_MP::eval_f(Index n, const Number* x, bool new_x, Number& obj_value)
 {
-	return solve_callback_->eval_f(n, x, new_x, obj_value);
+	if (new_x){ cache_new_x(n,x);}
+
+	obj_value = fg_vals[0];
+	return true;
 }
 
 bool tminlp_MP::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f)
 {
-	return solve_callback_->eval_grad_f(n, x, new_x, grad_f);
+	if (new_x){ cache_new_x(n,x);}
+
+	const arma::vec grad_vec = eth.gradient(x_expanded, false);// eth updated in cache_new_x
+
+	// Omit partials wrt. fixed variables
+	for (int i=0;i<n;i++){
+		grad_f[i] = grad_vec[expand_mask[i]];
+	}
+	return true;
 }
 
 bool tminlp_MP::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g)
 {
-	return solve_callback_->eval_g(n, x, new_x, m, g);
+	if (new_x){ cache_new_x(n,x);}
+
+	for (int i=0;i<m;i++){
+		g[i] = fg_vals[i+1];
+	}
+	return true;
 }
 
 bool tminlp_MP::eval_jac_g(Index n, const Number* x, bool new_x,
 							  Index m, Index nele_jac, Index* iRow, Index *jCol,
 							  Number* values)
 {
-	return solve_callback_->eval_jac_g(n, x, new_x, m, nele_jac, iRow, jCol, values);
+	assert(nele_jac == jac_vals.size());
+
+	if (values == nullptr){
+		// extracts positions of nonzero elements
+		for (int pos =0; pos < nele_jac; pos++){
+			iRow[pos] = jac_iRow[pos];
+			jCol[pos] = jac_jCol[pos];
+		}
+		return true;
+	}
+
+	if (new_x){ cache_new_x(n,x);}
+
+	if (nl && !nl->jac_row.empty()){
+		std::vector<double> jac(nl->jac_row.size());
+		if (nl_rows.size() < this->n){
+			nl->fun.SparseJacobianReverse(x_vec, nl->jac_pattern, nl->jac_row, nl->jac_col, jac, nl->jac_work);
+		}else{
+			nl->fun.SparseJacobianForward(x_vec, nl->jac_pattern, nl->jac_row, nl->jac_col, jac, nl->jac_work);
+		}
+		for (size_t k=0; k<jac.size(); k++){
+			jac_vals[nl_jac_pos[k]] = jac[k];
+		}
+	}
+
+	// linear entries were filled in by the constructor
+	for (int pos =0; pos < nele_jac; pos++){
+		values[pos] = jac_vals[pos];
+	}
+	return true;
 }
 
 bool tminlp_MP::eval_h(Index n, const Number* x, bool new_x,
@@ -127,7 +370,49 @@ bool tminlp_MP::eval_h(Index n, const Number* x, bool new_x,
 						  bool new_lambda, Index nele_hess, Index* iRow,
 						  Index* jCol, Number* values)
 {
-	return solve_callback_->eval_h(n, x, new_x, obj_factor, m, lambda, new_lambda, nele_hess, iRow, jCol, values);
+	assert(nele_hess == hes_iRow.size());
+
+	if ( values == NULL){
+		// set positions
+		for (int pos=0; pos < nele_hess; pos++){
+			iRow[pos] = hes_iRow[pos];
+			jCol[pos] = hes_jCol[pos];
+		}
+		return true;
+	}
+
+	if (new_x){ cache_new_x(n,x);}
+
+	if (dense_hessian){
+		const arma::mat hess = obj_factor * eth.hessian(x_expanded, false); // eth updated in cache_new_x
+
+		// make sure to use same order of traversial as setting positions
+		// Omit partials wrt. fixed variables
+		int pos = 0;
+		for (int i=0;i<n;i++){
+			for (int j=0; j <= i;j++){
+				values[pos] = hess.at(expand_mask[i],expand_mask[j]);
+				pos ++;
+			}
+		}
+	}else{
+		for (int pos=0; pos < nele_hess; pos++){
+			values[pos] = 0.0;
+		}
+	}
+
+	// linear rows have no curvature, add the weighted Hessian of the taped rows
+	if (nl && !nl->hes_row.empty()){
+		std::vector<double> w(nl_rows.size()), hes(nl->hes_row.size());
+		for (size_t k=0; k<nl_rows.size(); k++){
+			w[k] = lambda[nl_rows[k]];
+		}
+		nl->fun.SparseHessian(x_vec, w, nl->hes_pattern, nl->hes_row, nl->hes_col, hes, nl->hes_work);
+		for (size_t k=0; k<hes.size(); k++){
+			values[nl_hes_pos[k]] += hes[k];
+		}
+	}
+	return true;
 }
 
 } // namespace coin
@@ -1,48 +1,104 @@
 #pragma once
 
-#include <cppad/ipopt/solve_result.hpp>
-#include <cppad/ipopt/solve_callback.hpp>
-
 #include "coin/BonTMINLP.hpp"
 #include "../ADShorthands.hpp"
-#include "../atomic_ethelo.hpp"
+#include "../nuclear_ethelo.hpp"
 #include "tminlp_Base.hpp"
 
+#include <list>
+#include <mutex>
+
 // BONMIN Interface for general cases
 
 namespace ethelo {
 	class MathProgram;
-	
+	class MathExprNode;
+
 namespace coin {
     using namespace Ipopt;
     using namespace Bonmin;
 
     class tminlp_MP : public tminlp_Base
     {
-		class EvalWrapper{
-		public:
-			const MathProgram* MP;
-			atomic_ethelo eth;
-			EvalWrapper(const MathProgram* MP);
-			void evaluate(ADvector& fg, ADvector& x);
-			void operator()(ADvector& fg, ADvector& x){
-				return evaluate(fg,x);
-			}
+		/* nonlinear_rows holds the CppAD tape of the nonlinear constraints of an MP,
+			optimized and with the sparsity patterns of its Jacobian and of the
+			Hessian of its weighted sum. Patterns come from the structure of the
+			expressions (see MathExprNode::sparsity) rather than from CppAD.
+
+			The tape only depends on the expressions of these rows, which are the
+			same for every scenario solved from one preprocessed MathProgram with
+			one variable mask (exclusion rows are linear and stay out of the tape).
+			Tapes are therefore kept in a small cache keyed by the saved form of
+			the expressions, and reused by later solves.
+		*/
+		struct nonlinear_rows{
+			std::string key;
+			CppAD::ADFun<double> fun;
+
+			// nonzeros of the Jacobian of fun, and of the lower triangle of its Hessian
+			std::vector<std::set<size_t>> jac_pattern, hes_pattern;
+			std::vector<size_t> jac_row, jac_col;
+			std::vector<size_t> hes_row, hes_col;
+			CppAD::sparse_jacobian_work jac_work;
+			CppAD::sparse_hessian_work hes_work;
+
+			nonlinear_rows(const std::string& key, const std::vector<const MathExprNode*>& exprs, size_t n);
 		};
-		// const MathProgram* MP;
-        Dvector xi_;
-        Dvector xl_, xu_;
-        Dvector gl_, gu_;
-		
-        EvalWrapper fg_eval_;
-        CppAD::ipopt::solve_result<Dvector> solve_result_;
-        std::unique_ptr<CppAD::ipopt::solve_callback<Dvector, ADvector, EvalWrapper>> solve_callback_;
-		
-        // solution solution_;
+
+		// Checked out tapes belong to a single tminlp_MP until they are returned,
+		//   so concurrent solves never share one
+		static std::unique_ptr<nonlinear_rows> checkout_tape(const std::string& key);
+		static void return_tape(std::unique_ptr<nonlinear_rows> rows);
+
+		static std::mutex cache_mutex;
+		static std::list<std::unique_ptr<nonlinear_rows>> cache;
+		static const size_t cache_capacity;
+		static uint64_t cache_hits;
+
+		nuclear_ethelo eth; // ethelo evaluator
+		const size_t n,m;  // # of free variables, # of constraints
+
+		// fields to accomodate fixed variables
+		arma::vec x_init;
+		std::vector<int> expand_mask;
+
+		// linear rows g_i(x) = a_i x + b_i are evaluated directly
+		std::vector<size_t> lin_rows;
+		std::vector<size_t> lin_begin; // nonzeros of lin_rows[k] are lin_col/lin_val[lin_begin[k] .. lin_begin[k+1])
+		std::vector<size_t> lin_col;
+		std::vector<double> lin_val, lin_const;
+
+		// everything else goes through the tape
+		std::vector<size_t> nl_rows;
+		std::unique_ptr<nonlinear_rows> nl;
+
+		// Jacobian structure of all rows, in the order reported to BONMIN;
+		//   entry nl_jac_pos[k] holds nonzero k of the tape Jacobian
+		std::vector<Index> jac_iRow, jac_jCol;
+		std::vector<double> jac_vals;
+		std::vector<size_t> nl_jac_pos;
+
+		// Hessian structure of the Lagrangian: the dense lower triangle unless
+		//   ethelo is linear, in which case only the taped rows contribute;
+		//   entry nl_hes_pos[k] holds nonzero k of the tape Hessian
+		bool dense_hessian;
+		std::vector<Index> hes_iRow, hes_jCol;
+		std::vector<size_t> nl_hes_pos;
+
+		// cache
+		std::vector<double> x_vec;
+		arma::vec x_expanded;
+		arma::vec fg_vals;
+
+		inline void cache_new_x(int n, const double* x);
 
     public:
         tminlp_MP(const MathProgram* MP);
-        virtual ~tminlp_MP() {};
+        virtual ~tminlp_MP();
+
+		// number of solves that reused a cached tape, and clearing of the cache
+		static uint64_t tape_cache_hits();
+		static void clear_tape_cache();
 
     protected:
 		// BONMIN setup functions
@@ -54,7 +110,7 @@ namespace coin {
                                         bool init_z, Number* z_L, Number* z_U,
                                         Index m, bool init_lambda,
                                         Number* lambda);
-		
+
 		// BONMIN evaluation functions
         virtual bool eval_f(Index n, const Number* x, bool new_x, Number& obj_value);
         virtual bool eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f);
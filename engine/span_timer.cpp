@@ -0,0 +1,181 @@
+#include "span_timer.hpp"
+#include "memory_usage.hpp"
+
+#include <plog/Log.h>
+#include <sstream>
+
+#ifdef ETHELO_PROFILING
+#include "profiler.hpp"
+#endif
+
+namespace ethelo
+{
+    namespace
+    {
+        // the installed timer and the spans of it still open on this thread
+        thread_local span_timer* installed_ = nullptr;
+        thread_local std::vector<size_t> open_spans_;
+#ifdef ETHELO_PROFILING
+        // spans of the profiler's timer still open on this thread
+        thread_local std::vector<size_t> profile_spans_;
+#endif
+    }
+
+    span_timer::span_timer()
+        : origin_(clock::now()), track_memory_(false)
+    {}
+
+    std::vector<span_timer::record> span_timer::records() const
+    {
+        clock::time_point now = clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<record> result = records_;
+        for (size_t i = 0; i < result.size(); i++)
+            if (result[i].open)
+                result[i].seconds = std::chrono::duration<double>(now - starts_[i]).count();
+        return result;
+    }
+
+    void span_timer::log() const
+    {
+        std::vector<record> spans = records();
+        std::vector<size_t> depth(spans.size(), 0);
+        for (size_t i = 0; i < spans.size(); i++) {
+            if (spans[i].parent >= 0)
+                depth[i] = depth[spans[i].parent] + 1;
+            std::ostringstream memory;
+            for (const auto& figure : spans[i].memory)
+                memory << ", " << figure.first << " " << figure.second;
+            PLOGD << std::string(2 * depth[i], ' ') << spans[i].name << ": " << spans[i].seconds << " s"
+                  << (spans[i].open ? " (open)" : "") << memory.str();
+        }
+    }
+
+    span_timer* span_timer::current()
+    {
+        return installed_;
+    }
+
+    span_timer::scope::scope(span_timer& timer)
+        : previous_timer_(installed_)
+    {
+        previous_stack_.swap(open_spans_);
+        installed_ = &timer;
+    }
+
+    span_timer::scope::~scope()
+    {
+        installed_ = previous_timer_;
+        open_spans_.swap(previous_stack_);
+    }
+
+    size_t span_timer::open(const std::string& name, ptrdiff_t parent)
+    {
+        clock::time_point now = clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.push_back({name, parent, std::chrono::duration<double>(now - origin_).count(), 0.0, true,
+                            std::this_thread::get_id()});
+        starts_.push_back(now);
+        return records_.size() - 1;
+    }
+
+    void span_timer::close(size_t index)
+    {
+        clock::time_point now = clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_[index].seconds = std::chrono::duration<double>(now - starts_[index]).count();
+        records_[index].open = false;
+    }
+
+    void span_timer::add_memory(size_t index, const std::vector<std::pair<std::string, double>>& figures)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& memory = records_[index].memory;
+        memory.insert(memory.end(), figures.begin(), figures.end());
+    }
+
+#ifdef ETHELO_PROFILING
+    void span_timer::close(size_t index, const std::array<uint64_t, 4>& counters)
+    {
+        clock::time_point now = clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_[index].seconds = std::chrono::duration<double>(now - starts_[index]).count();
+        records_[index].open = false;
+        records_[index].counters = counters;
+        records_[index].counted = true;
+    }
+#endif
+
+    span::span(const char* name)
+        : timer_(installed_), index_(0), sampled_(false), start_peak_rss_(0)
+    {
+#ifdef ETHELO_PROFILING
+        profile_ = profiler::timer();
+        profile_index_ = 0;
+        counted_ = false;
+        if (profile_ && profile_ != timer_) {
+            ptrdiff_t parent = profile_spans_.empty() ? -1 : static_cast<ptrdiff_t>(profile_spans_.back());
+            profile_index_ = profile_->open(name, parent);
+            profile_spans_.push_back(profile_index_);
+        } else {
+            profile_ = nullptr;
+        }
+#endif
+        if (timer_) {
+            ptrdiff_t parent = open_spans_.empty() ? -1 : static_cast<ptrdiff_t>(open_spans_.back());
+            index_ = timer_->open(name, parent);
+            open_spans_.push_back(index_);
+            if (timer_->tracks_memory()) {
+                sampled_ = true;
+                start_peak_rss_ = process_memory::read().peak_rss_bytes;
+            }
+        }
+#ifdef ETHELO_PROFILING
+        // read last, so the counters leave out the bookkeeping above
+        if (profile_ || (timer_ && timer_ == profiler::timer()))
+            counted_ = profiler::read_counters(counters_);
+#endif
+    }
+
+    span::~span()
+    {
+        if (sampled_) {
+            process_memory process = process_memory::read();
+            node_census::counts nodes = node_census::snapshot();
+            timer_->add_memory(index_, {
+                {"rss_bytes", static_cast<double>(process.rss_bytes)},
+                {"peak_rss_delta_bytes", static_cast<double>(process.peak_rss_bytes > start_peak_rss_ ? process.peak_rss_bytes - start_peak_rss_ : 0)},
+                {"live_nodes", static_cast<double>(nodes.total_live())},
+                {"linexp_coef_bytes", static_cast<double>(nodes.coef_bytes)}});
+        }
+#ifdef ETHELO_PROFILING
+        if (counted_) {
+            std::array<uint64_t, 4> now;
+            if (profiler::read_counters(now)) {
+                for (size_t k = 0; k < now.size(); k++)
+                    counters_[k] = now[k] - counters_[k];
+            } else {
+                counted_ = false;
+            }
+        }
+        if (profile_) {
+            if (counted_) profile_->close(profile_index_, counters_);
+            else profile_->close(profile_index_);
+            profile_spans_.pop_back();
+        }
+        if (timer_ && counted_ && timer_ == profiler::timer()) {
+            timer_->close(index_, counters_);
+            open_spans_.pop_back();
+            return;
+        }
+#endif
+        if (!timer_) return;
+        timer_->close(index_);
+        open_spans_.pop_back();
+    }
+
+    void span::memory(const char* name, double value)
+    {
+        if (sampled_) timer_->add_memory(index_, {{name, value}});
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ethelo
+{
+    /*
+        span_timer records nested wall-clock spans, e.g. the stages of one
+        request to interface::solve.
+
+        A timer only collects spans while it is installed on a thread with a
+        span_timer::scope. From then on every `span` object created on that
+        thread opens a span in it, nested under the innermost span still open
+        on the thread; without an installed timer a span does nothing. Spans
+        opened on other threads (e.g. inside thread_pool loops) are not
+        recorded unless those threads install the timer too, in which case
+        they start their own top-level spans. Recording is guarded by a
+        mutex, so one timer may be shared by several threads.
+
+        A timer that tracks memory also notes, when each of its spans
+        closes, the resident set of the process, how far the span raised its
+        peak, and the MathExprNodes and LinExp coefficient bytes counted by
+        node_census. Spans can add their own figures with span::memory().
+    */
+    class span_timer
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        struct record {
+            std::string name;
+            ptrdiff_t parent;   // index of the enclosing span, -1 for top-level spans
+            double start;       // seconds since the timer was created
+            double seconds;     // duration, or the time so far while the span is open
+            bool open;
+            std::thread::id thread;
+            std::vector<std::pair<std::string, double>> memory; // only when tracking memory
+#ifdef ETHELO_PROFILING
+            // hardware counters over the span (see profiler.hpp), valid when counted
+            std::array<uint64_t, 4> counters;
+            bool counted;
+#endif
+        };
+
+        span_timer();
+
+        span_timer(const span_timer&) = delete;
+        span_timer& operator=(const span_timer&) = delete;
+
+        // spans in the order they were opened
+        std::vector<record> records() const;
+
+        // writes the spans to the log at debug level, indented by depth
+        void log() const;
+
+        // the timer installed on the calling thread, or nullptr
+        static span_timer* current();
+
+        // memory figures for the spans opened from now on
+        void track_memory(bool on) { track_memory_ = on; }
+        bool tracks_memory() const { return track_memory_; }
+
+        // installs a timer on the calling thread for the lifetime of the scope
+        class scope
+        {
+            span_timer* previous_timer_;
+            std::vector<size_t> previous_stack_;
+
+        public:
+            explicit scope(span_timer& timer);
+            ~scope();
+        };
+
+    private:
+        friend class span;
+
+        size_t open(const std::string& name, ptrdiff_t parent);
+        void close(size_t index);
+        void add_memory(size_t index, const std::vector<std::pair<std::string, double>>& figures);
+#ifdef ETHELO_PROFILING
+        void close(size_t index, const std::array<uint64_t, 4>& counters);
+#endif
+
+        clock::time_point origin_;
+        mutable std::mutex mutex_;
+        std::vector<record> records_;
+        std::vector<clock::time_point> starts_;
+        std::atomic<bool> track_memory_;
+    };
+
+    // a span of the timer installed on this thread, from construction to destruction
+    class span
+    {
+        span_timer* timer_;
+        size_t index_;
+        bool sampled_;              // whether the timer tracks memory for this span
+        size_t start_peak_rss_;
+#ifdef ETHELO_PROFILING
+        // the same span in the profiler's timer, which sees every thread
+        span_timer* profile_;
+        size_t profile_index_;
+        bool counted_;
+        std::array<uint64_t, 4> counters_;
+#endif
+
+    public:
+        explicit span(const char* name);
+        ~span();
+
+        // adds a memory figure to the span, if its timer tracks memory
+        void memory(const char* name, double value);
+
+        span(const span&) = delete;
+        span& operator=(const span&) = delete;
+    };
+}
+
+/*
+    ETHELO_PROFILE_SPAN(name) opens a span until the end of the enclosing
+    block in builds configured with -DENGINE_PROFILING=ON, for hot paths
+    that should cost nothing otherwise.
+*/
+#ifdef ETHELO_PROFILING
+#define ETHELO_PROFILE_CONCAT_(a, b) a##b
+#define ETHELO_PROFILE_CONCAT(a, b) ETHELO_PROFILE_CONCAT_(a, b)
+#define ETHELO_PROFILE_SPAN(name) ::ethelo::span ETHELO_PROFILE_CONCAT(profile_span_, __LINE__)(name)
+#else
+#define ETHELO_PROFILE_SPAN(name) ((void)0)
+#endif
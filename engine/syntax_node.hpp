@@ -0,0 +1,46 @@
+#pragma once
+
+namespace ethelo
+{
+    // Node of a parsed expression. Node types are the TOK_* token types of
+    // language/expression.g, whichever parser produced the tree.
+    class syntax_node
+    {
+        int type_;
+        std::string text_;
+        uint32_t line_;
+        int32_t position_;
+        std::vector<std::unique_ptr<syntax_node>> children_;
+
+    public:
+        syntax_node(int type, const std::string& text, uint32_t line, int32_t position)
+            : type_(type), text_(text), line_(line), position_(position) {}
+
+        int type() const { return type_; }
+        const std::string& text() const { return text_; }
+        uint32_t line() const { return line_; }
+        int32_t position() const { return position_; }
+
+        size_t child_count() const { return children_.size(); }
+        const syntax_node* child(size_t i) const { return i < children_.size() ? children_[i].get() : NULL; }
+        const syntax_node* first_child(int type) const
+        {
+            for (const auto& child : children_)
+                if (child->type_ == type) return child.get();
+            return NULL;
+        }
+
+        void add_child(std::unique_ptr<syntax_node> child) { children_.push_back(std::move(child)); }
+
+        // LISP style dump of node types, positions and leaf text, used to compare trees
+        std::string to_string_tree() const
+        {
+            std::stringstream ss;
+            ss << "(" << type_ << ":" << line_ << ":" << position_;
+            if (children_.empty()) ss << " " << text_;
+            for (const auto& child : children_) ss << " " << child->to_string_tree();
+            ss << ")";
+            return ss.str();
+        }
+    };
+}
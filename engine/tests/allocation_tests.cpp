@@ -0,0 +1,144 @@
+#define CATCH_CONFIG_MAIN
+#include "../ethelo.hpp"
+#include "../mathModelling.hpp"
+#include "../atomic_ethelo.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace ethelo;
+
+// every heap allocation of this test executable is counted here
+static std::atomic<size_t> allocations{0};
+
+void* operator new(std::size_t size){
+	allocations++;
+	if (void* ptr = std::malloc(size > 0 ? size : 1)){ return ptr;}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept{
+	std::free(ptr);
+}
+
+TEST_CASE("atomic ethelo sweeps do not allocate", "[allocation]") {
+	// more options and voters than armadillo keeps in its local buffers
+	const size_t n_options = 20, n_voters = 24;
+	std::vector<option> options;
+	for (size_t i=0; i<n_options; i++){
+		options.push_back(option("option_" + std::to_string(i)));
+	}
+	arma::mat influents(n_voters, n_options);
+	for (size_t v=0; v<n_voters; v++){
+		for (size_t i=0; i<n_options; i++){
+			influents(v, i) = 0.5 * (double((3*v + 7*i) % 5) - 2.0);
+		}
+	}
+	decision fair_decision(
+		options,
+		{/* no criteria */},
+		{/* no fragments */},
+		{/* no constraints */},
+		{/* no displays */},
+		influents,
+		arma::mat(),
+		arma::mat(),
+		{0.5 /* CI */});
+	
+	// fix one option in and one out, so that the sweeps go through expand_mask
+	FixVar_Mask FV(n_options);
+	FV.fix_variable(3, 1.0);
+	FV.fix_variable(7, 0.0);
+	FV.update();
+	MathProgram MP(FV, fair_decision, true, true);
+	MP.signalBridge(FV.makeBridge());
+	
+	atomic_ethelo eth("allocation test atomic ethelo", &MP);
+	CppAD::atomic_base<double>& sweeps = eth; // forward and reverse are public in the base class
+	
+	const size_t n = MP.n_var();
+	REQUIRE(n == n_options - 2);
+	CppAD::vector<bool> vx, vy;
+	CppAD::vector<double> tx(2*n), ty(2), px(2*n), py(2);
+	for (size_t i=0; i<n; i++){
+		tx[2*i] = 0.05 * (i+1);
+		tx[2*i+1] = 1.0;
+	}
+	py[0] = 1.0; py[1] = 0.5;
+	
+	// warm-up
+	REQUIRE(sweeps.forward(0, 1, vx, vy, tx, ty));
+	REQUIRE(sweeps.reverse(1, tx, ty, px, py));
+	
+	SECTION("forward") {
+		const size_t before = allocations;
+		for (int k=0; k<10; k++){
+			tx[0] = 0.1 * k;
+			sweeps.forward(0, 1, vx, vy, tx, ty);
+		}
+		REQUIRE(allocations == before);
+	}
+	
+	SECTION("reverse") {
+		const size_t before = allocations;
+		for (int k=0; k<10; k++){
+			tx[0] = 0.1 * k;
+			sweeps.reverse(1, tx, ty, px, py);
+		}
+		REQUIRE(allocations == before);
+	}
+}
+
+TEST_CASE("expression nodes are placed in the installed arena", "[allocation]") {
+	FixVar_Mask VM(4);
+	VM.update();
+	const arma::vec a{1.0, -2.0, 0.0, 3.0};
+	const arma::vec x{1.0, 1.0, 0.0, 1.0};
+	
+	NodeArena arena;
+	{
+		NodeArena::Scope scope(&arena);
+		delete new LinExp(&VM, a, 0.5); // warm-up: the first chunk
+	}
+	
+	SECTION("nodes and coefficients do not touch the heap") {
+		NodeArena::Scope scope(&arena);
+		const size_t before = allocations;
+		const size_t used = arena.bytes_used();
+		for (int k=0; k<10; k++){
+			LinExp* node = new LinExp(&VM, a, 0.5);
+			REQUIRE(node->evaluate(x) == 2.5);
+			delete node;
+		}
+		REQUIRE(allocations == before);
+		REQUIRE(arena.bytes_used() == used); // each node reuses the blocks of the last one
+	}
+	
+	SECTION("nodes built without an arena come from the heap") {
+		const size_t used = arena.bytes_used();
+		const size_t before = allocations;
+		LinExp* node = new LinExp(&VM, a, 0.5);
+		REQUIRE(node->evaluate(x) == 2.5);
+		delete node;
+		REQUIRE(allocations > before);
+		REQUIRE(arena.bytes_used() == used);
+	}
+	
+	SECTION("a new arena reuses the chunks of a released one") {
+		const void* first;
+		{
+			NodeArena previous;
+			NodeArena::Scope scope(&previous);
+			LinExp* node = new LinExp(&VM, a, 0.5);
+			first = node;
+			delete node;
+		}
+		NodeArena next;
+		NodeArena::Scope scope(&next);
+		LinExp* node = new LinExp(&VM, a, 0.5);
+		REQUIRE(static_cast<const void*>(node) == first);
+		REQUIRE(node->evaluate(x) == 2.5);
+		delete node;
+	}
+}
@@ -198,4 +198,43 @@ TEST_CASE("Square Root Test", "[MP]") {
 	SECTION("0-sqrt($a)")   {REQUIRE(fgh[2] == Approx(-2));  }
 }
 
-	
\ No newline at end of file
+TEST_CASE("Structural Sparsity Test", "[MP]") {
+	decision dec (
+		{option("op1", {{"a", 1}, {"b", 0}, {"c", 0}}),
+		option("op2", {{"a", 0}, {"b", 1}, {"c", 0}}),
+		option("op3", {{"a", 0}, {"b", 0}, {"c", 2}})},
+		{/* no criteria */},
+		{/* no fragment */},
+		{constraint("cons1", "[$a * $b] >= 0"),
+		 constraint("cons2", "[$c / $b] >= 0"),
+		 constraint("cons3", "[sqrt($c)] >= 0"),
+		 constraint("cons4", "[abs($a)] >= 0"),
+		 constraint("cons5", "[$a + $b] >= 0")
+		},
+		{/* no display */},
+		arma::mat({{0.0,0.0,0.0}}), // votes
+		arma::mat(), // weights
+		arma::mat(), // exclusion
+		0.0 // CI
+	);
+	
+	FixVar_Mask VM(dec.dim());
+	MathProgram MP(VM, dec, true, false);
+	const auto& consList = MP.getConsList();
+	REQUIRE(consList.size() == 5);
+	
+	typedef std::set<size_t> support;
+	typedef std::set<std::pair<size_t,size_t>> hessian;
+	auto pattern = [&](size_t i){ return consList[i].expr->sparsity();};
+	// x0, x1, x2 select op1, op2, op3
+	SECTION("$a * $b")  {REQUIRE(pattern(0).support == support({0,1}));
+	                     REQUIRE(pattern(0).hessian == hessian({{1,0}}));}
+	SECTION("$c / $b")  {REQUIRE(pattern(1).support == support({1,2}));
+	                     REQUIRE(pattern(1).hessian == hessian({{1,1},{2,1}}));}
+	SECTION("sqrt($c)") {REQUIRE(pattern(2).support == support({2}));
+	                     REQUIRE(pattern(2).hessian == hessian({{2,2}}));}
+	SECTION("abs($a)")  {REQUIRE(pattern(3).support == support({0}));
+	                     REQUIRE(pattern(3).hessian.empty());}
+	SECTION("$a + $b")  {REQUIRE(pattern(4).support == support({0,1}));
+	                     REQUIRE(pattern(4).hessian.empty());}
+}
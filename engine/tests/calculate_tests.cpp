@@ -1,6 +1,7 @@
 #define CATCH_CONFIG_MAIN
 #include "../ethelo.hpp"
 #include "../mathModelling.hpp"
+#include "../nuclear_ethelo.hpp"
 #include <catch2/catch.hpp>
 
 using namespace ethelo;
@@ -90,3 +91,312 @@ TEST_CASE("constraint in pizza restaurant decision", "[calculator]") {
         REQUIRE(calculate(arma::vec{1, 0, 0, 0, 0, 0, 0, 1})[1] == Approx(2));
     }
 }
+
+TEST_CASE("in-place ethelo derivatives in pizza restaurant decision", "[calculator]") {
+	decision fair_decision(
+		{option("pizza_hut"),
+		 option("dominos_pizza"),
+		 option("uncle_faiths"),
+		 option("pizzeria_farina")},
+		{/* no criteria */},
+		{/* no fragments */},
+		{/* no constraints */},
+		{/* no displays */},
+		arma::mat({{1, 1, 1, -1},
+		           {1, 1, 0,  0},
+		           {1, 0, 0, -1}}),
+		arma::mat(),
+		arma::mat(),
+		{0.5 /* CI */});
+	
+	nuclear_ethelo eth(&fair_decision);
+	const arma::vec x{0.25, 1.0, 0.5, 0.75};
+	const std::vector<int> index{0, 2, 3}; // dominos_pizza is fixed
+	
+	const arma::vec grad = eth.gradient(x, true);
+	const arma::mat hess = eth.hessian(x, false);
+	
+	std::vector<double> grad_out(index.size()), hess_out(index.size()*(index.size()+1)/2);
+	eth.gradient(x, false, index, grad_out.data());
+	eth.hessian(x, false, index, 2.0, hess_out.data());
+	
+	SECTION("gradient") {
+		for (size_t i=0; i<index.size(); i++){
+			REQUIRE(grad_out[i] == Approx(grad[index[i]]).margin(1e-12));
+		}
+	}
+	
+	SECTION("lower triangle of the scaled hessian") {
+		size_t pos = 0;
+		for (size_t i=0; i<index.size(); i++){
+			for (size_t j=0; j<=i; j++){
+				REQUIRE(hess_out[pos++] == Approx(2.0*hess(index[i], index[j])).margin(1e-12));
+			}
+		}
+	}
+}
+
+TEST_CASE("ethelo context is shared within a scope", "[calculator]") {
+	decision dec(pizza_restaurant_decision);
+	const auto full = dec.context();
+	
+	SECTION("evaluators reuse the context") {
+		REQUIRE(dec.context() == full);
+		REQUIRE(decision(dec).context() == full);
+		REQUIRE(full->mu.n_elem == 8);
+		REQUIRE(full->mu[0] == Approx(1.0/8.0)); // default weights spread over 8 options
+	}
+	
+	SECTION("scoping builds its own context and restores the full one") {
+		dec.exclude(arma::uvec{0, 7});
+		const auto scoped = dec.context();
+		REQUIRE(scoped != full);
+		REQUIRE(scoped->mu.n_elem == 6);
+		
+		dec.exclude(arma::uvec());
+		REQUIRE(dec.context() == full);
+	}
+	
+	SECTION("new influents drop the context") {
+		dec.load(arma::mat(arma::mat(2, 8, arma::fill::ones)), arma::mat());
+		REQUIRE(dec.context() != full);
+		REQUIRE(dec.context()->N == 2);
+	}
+}
+
+TEST_CASE("copies of a decision share loaded data", "[calculator]") {
+	decision copy(pizza_restaurant_decision);
+	const problem& original_problem = pizza_restaurant_decision;
+	const problem& copy_problem = copy;
+	
+	SECTION("copies refer to the same storage") {
+		REQUIRE(&copy.influents() == &pizza_restaurant_decision.influents());
+		REQUIRE(&copy.weights() == &pizza_restaurant_decision.weights());
+		REQUIRE(&copy_problem.influents() == &original_problem.influents());
+		REQUIRE(&copy.original_options() == &pizza_restaurant_decision.original_options());
+		REQUIRE(&copy.constraints() == &pizza_restaurant_decision.constraints());
+	}
+	
+	SECTION("loading into a copy leaves the original untouched") {
+		copy.load(arma::mat(arma::mat(2, 8, arma::fill::ones)), arma::mat());
+		REQUIRE(copy.influents().n_rows == 2);
+		REQUIRE(pizza_restaurant_decision.influents().n_rows == 4);
+		REQUIRE(original_problem.influents().n_rows == 4);
+	}
+}
+
+TEST_CASE("option scope is a view over the options", "[calculator]") {
+	decision dec(pizza_restaurant_decision);
+	dec.exclude(arma::uvec{1, 3});
+	const problem& p = dec;
+	
+	SECTION("options in scope refer to the original options") {
+		REQUIRE(dec.dim() == 6);
+		REQUIRE(dec.options()[1].name() == "uncle_faiths");
+		REQUIRE(&dec.options()[1] == &dec.original_options()[2]);
+		REQUIRE(dec.original_option_index(1) == 2);
+		REQUIRE(dec.options().find("uncle_faiths") == 1);
+		REQUIRE(dec.options().find("dominos_pizza") == -1);
+		
+		size_t count = 0;
+		for (const auto& opt : dec.options()){
+			REQUIRE(opt.name() != "pizzeria_farina");
+			count++;
+		}
+		REQUIRE(count == 6);
+	}
+	
+	SECTION("influents in scope are the columns of the options in scope") {
+		const arma::mat& all = pizza_restaurant_decision.problem::influents();
+		REQUIRE(p.influents().n_cols == 6);
+		REQUIRE(arma::approx_equal(p.influents().col(1), all.col(2), "absdiff", 1e-12));
+		REQUIRE(&p.influents() == &p.influents());
+	}
+	
+	SECTION("clearing the scope restores all options") {
+		dec.exclude(arma::uvec());
+		REQUIRE(dec.dim() == 8);
+		REQUIRE(dec.options().find("dominos_pizza") == 1);
+	}
+}
+
+TEST_CASE("details are stored by column", "[calculator]") {
+	problem p({option("op1", {{"a", 1}, {"b", 2}}),
+	           option("op2", {{"b", 4}}),
+	           option("op3", {{"c", -1}, {"a", 3}})},
+	          {}, {}, {});
+	const auto& details = p.details();
+	
+	REQUIRE(details.size() == 3);
+	REQUIRE(details.n_options() == 3);
+	REQUIRE(details.find("d") == -1);
+	
+	const auto a = details.find("a"), b = details.find("b"), c = details.find("c");
+	REQUIRE(details.name(a) == "a");
+	REQUIRE(details.column(a)[0] == 1.0);
+	REQUIRE(details.column(a)[1] == 0.0); // op2 has no detail a
+	REQUIRE(details.column(a)[2] == 3.0);
+	REQUIRE(details.value(b, 1) == 4.0);
+	REQUIRE(details.value(c, 2) == -1.0);
+	REQUIRE(details.value(details.find("d"), 0) == 0.0);
+	
+	for (size_t i = 0; i < p.dim(); i++){
+		for (const auto& name : {"a", "b", "c", "d"}){
+			REQUIRE(details.value(details.find(name), i) == p.options()[i].get_detail(name));
+		}
+	}
+}
+
+TEST_CASE("compact vote stores match the double influents", "[calculator]") {
+	arma::arma_rng::set_seed(7);
+	arma::mat votes = arma::round(arma::randu<arma::mat>(37, 6) * 8.0 - 4.0) / 4.0; // quarters in [-1, 1]
+	votes(3, 2) = arma::datum::nan;
+	arma::mat values = votes;
+	values(3, 2) = 0.0;
+	
+	const arma::vec x = arma::linspace<arma::vec>(0.0, 1.0, 6);
+	const arma::vec v = arma::sin(arma::linspace<arma::vec>(0.0, 3.0, 37));
+	
+	for (auto format : {vote_store::format::float32, vote_store::format::int8}){
+		vote_store store(votes, format);
+		REQUIRE(store.is_null(3, 2));
+		REQUIRE(store.valid(2) == 36);
+		REQUIRE(store.bytes() < votes.n_elem * sizeof(double));
+		
+		arma::vec sat(37), Iv(6), mu(6);
+		store.multiply(x.memptr(), sat.memptr());
+		store.multiply_transpose(v.memptr(), Iv.memptr());
+		store.column_means(mu.memptr());
+		
+		// quarters are exact in both formats, so only the summation order differs
+		REQUIRE(arma::abs(sat - values * x).max() < 1e-12);
+		REQUIRE(arma::abs(Iv - values.t() * v).max() < 1e-12);
+		REQUIRE(arma::abs(mu - arma::mean(values, 0).t()).max() < 1e-12);
+	}
+	
+	// arbitrary values stay within the documented tolerances
+	arma::mat noisy = arma::randu<arma::mat>(37, 6) * 2.0 - 1.0;
+	vote_store f32(noisy, vote_store::format::float32), i8(noisy, vote_store::format::int8);
+	for (size_t c = 0; c < noisy.n_cols; c++){
+		const double step = arma::abs(noisy.col(c)).max() / 240.0;
+		for (size_t r = 0; r < noisy.n_rows; r++){
+			REQUIRE(std::abs(f32.at(r, c) - noisy(r, c)) <= 6e-8 * std::abs(noisy(r, c)));
+			REQUIRE(std::abs(i8.at(r, c) - noisy(r, c)) <= step * (1.0 + 1e-12));
+		}
+	}
+}
+
+TEST_CASE("compact vote store throughput", "[.benchmark]") {
+	arma::arma_rng::set_seed(7);
+	const arma::mat votes = arma::round(arma::randu<arma::mat>(20000, 64) * 8.0 - 4.0) / 4.0;
+	const arma::vec x = arma::randu<arma::vec>(64);
+	arma::vec sat(votes.n_rows), Iv(votes.n_cols);
+	const size_t rounds = 200;
+	
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < rounds; i++){
+		sat = votes * x;
+		Iv = votes.t() * sat;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "double: " << votes.n_elem * sizeof(double) << " bytes, "
+	          << rounds / elapsed.count() << " products/s" << std::endl;
+	
+	for (auto format : {vote_store::format::float32, vote_store::format::int8}){
+		vote_store store(votes, format);
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < rounds; i++){
+			store.multiply(x.memptr(), sat.memptr());
+			store.multiply_transpose(sat.memptr(), Iv.memptr());
+		}
+		elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << (format == vote_store::format::float32 ? "float32: " : "int8: ") << store.bytes() << " bytes, "
+		          << rounds / elapsed.count() << " products/s" << std::endl;
+	}
+}
+
+// null vote handling as it was written with whole-matrix arma expressions
+static arma::mat reference_vote_transform(const arma::mat& influents, double replacement){
+	const double eps = std::numeric_limits<double>::epsilon();
+	arma::uvec inds = arma::find(arma::abs(influents - null_vote) <= eps);
+	arma::mat votes(influents);
+	votes(inds).fill(replacement);
+	
+	arma::vec counts = arma::sum(arma::conv_to<arma::mat>::from(arma::abs(influents - null_vote) > eps)).t();
+	arma::vec averages = arma::sum(votes).t();
+	for (size_t i = 0; i < averages.size(); i++)
+		averages(i) = counts(i) > 0.0 ? averages(i) / counts(i) : replacement + NULL_VOTE_NOMINAL_PENALTY;
+	
+	arma::umat neutral = arma::abs(influents - replacement) <= eps;
+	arma::uvec neutral_columns = arma::all(arma::abs(votes - replacement) <= eps).t();
+	neutral.cols(arma::find(neutral_columns == 0)).zeros();
+	votes(arma::find(neutral)).fill(replacement + NEUTRAL_VOTE_NOMINAL_PENALTY);
+	votes(inds) = averages(inds / influents.n_rows);
+	return arma::clamp(votes, -1.0, 1.0);
+}
+
+TEST_CASE("null votes are transformed in one pass", "[calculator]") {
+	const double n = null_vote;
+	const arma::mat influents({{ 1.0, n, n, n, 0.0, 1.5},
+	                           { n,   n, n, n, n,   -0.5},
+	                           {-0.5, n, n, n, 0.0,  n},
+	                           { 0.0, n, n, n, 0.0,  0.25}});
+	const arma::mat weights({{1, 1, 1, 1, 1, 1},
+	                         {1, 2, 1, 1, 1, 1},
+	                         {1, 1, 1, 1, 1, 1},
+	                         {3, 1, 1, 1, 1, 1}});
+	const std::vector<option> options = {option("a"), option("b"), option("c")};
+	const std::vector<criterion> criteria = {criterion("one"), criterion("two")};
+	
+	decision dec(options, criteria, {}, {}, {}, influents, weights);
+	REQUIRE(arma::abs(dec.influents() - reference_vote_transform(influents, NULL_VOTE_REPLACEMENT_VALUE)).max() < 1e-15);
+	REQUIRE(dec.influents()(1, 0) == Approx(0.5 / 3.0));              // column average, nulls counted as 0
+	REQUIRE(dec.influents()(0, 4) == NEUTRAL_VOTE_NOMINAL_PENALTY);   // neutral and null only
+	REQUIRE(dec.influents()(0, 2) == NULL_VOTE_NOMINAL_PENALTY);      // nobody voted
+	
+	SECTION("a null bitmap gives the same votes as the sentinel") {
+		arma::mat values = influents;
+		null_bitmap nulls(values.n_rows, values.n_cols);
+		for (size_t c = 0; c < values.n_cols; c++)
+			for (size_t r = 0; r < values.n_rows; r++)
+				if (values(r, c) == null_vote){
+					nulls.set(r, c);
+					values(r, c) = 0.75; // ignored
+				}
+		
+		decision other(dec);
+		other.load(values, nulls, weights);
+		REQUIRE(arma::approx_equal(other.influents(), dec.influents(), "absdiff", 0.0));
+		REQUIRE(arma::approx_equal(other.problem::influents(), dec.problem::influents(), "absdiff", 0.0));
+	}
+	
+	SECTION("support only votes are replaced by one half") {
+		configuration config;
+		config.support_only = true;
+		dec.configure(config);
+		dec.load(influents, weights);
+		REQUIRE(arma::abs(dec.influents() - reference_vote_transform(influents, NULL_VOTE_SUPPORT_ONLY_REPLACEMENT_VALUE)).max() < 1e-15);
+	}
+}
+
+TEST_CASE("null vote transform throughput", "[.benchmark]") {
+	arma::arma_rng::set_seed(11);
+	const size_t rows = 50000, options = 1000;
+	arma::mat influents = arma::round(arma::randu<arma::mat>(rows, options) * 4.0 - 2.0) / 2.0;
+	influents.elem(arma::find(arma::randu<arma::mat>(rows, options) < 0.3)).fill(null_vote);
+	
+	std::vector<option> opts;
+	for (size_t i = 0; i < options; i++)
+		opts.push_back(option("o" + std::to_string(i)));
+	decision dec(opts, {}, {}, {}, {});
+	
+	auto start = std::chrono::steady_clock::now();
+	dec.load(influents, arma::mat());
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "load " << rows << " x " << options << ": " << elapsed.count() << " s" << std::endl;
+	
+	start = std::chrono::steady_clock::now();
+	reference_vote_transform(influents, NULL_VOTE_REPLACEMENT_VALUE);
+	elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "whole-matrix transform alone: " << elapsed.count() << " s" << std::endl;
+}
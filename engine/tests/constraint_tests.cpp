@@ -93,3 +93,27 @@ TEST_CASE("constraint rejects duplicate bounds", "[constraint]") {
         );
     }
 }
+
+TEST_CASE("constraint defers parsing when requested", "[constraint]") {
+    ethelo::expression::deferred_parsing defer;
+
+    SECTION("bounds are compiled on first use") {
+        uint64_t before = ethelo::expression::parse_count();
+        ethelo::constraint c("deferred", "1 <= [a + b + c] <= 10");
+        ethelo::constraint copy = c;
+        REQUIRE(ethelo::expression::parse_count() == before);
+
+        REQUIRE(c.lbound().get() == 1);
+        REQUIRE(copy.ubound().get() == 10);
+        REQUIRE(ethelo::expression::parse_count() == before + 1);
+    }
+
+    SECTION("errors are raised on first use") {
+        ethelo::constraint c("deferred_invalid", "1 <= [a + b +]");
+        REQUIRE_THROWS_AS(c.ast(), ethelo::syntax_error);
+
+        ethelo::constraint d("deferred_duplicate", "1 = [a + b + c] = 1");
+        REQUIRE_THROWS_AS(d.lbound(), ethelo::semantic_error);
+        REQUIRE_THROWS_AS(d.ast(), ethelo::semantic_error);
+    }
+}
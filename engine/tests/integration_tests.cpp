@@ -1,6 +1,7 @@
 #define CATCH_CONFIG_MAIN
 #include "../ethelo.hpp"
 #include "../mathModelling.hpp"
+#include "../solvers/tminlp_MP.hpp"
 #include <catch2/catch.hpp>
 
 using namespace ethelo;
@@ -302,3 +303,154 @@ TEST_CASE("pizza no mushroom decision", "[integration]") {
     }
 }
     
+
+inline decision nonlinear_pizza_decision(size_t enumeration_limit = 0) {
+    decision dec(
+        {option("pepperoni_mushroom", {{"cost", 18}, {"feeds", 4}}),
+         option("large_cheese",       {{"cost", 12}, {"feeds", 6}}),
+         option("regular_cheese",     {{"cost", 12}, {"feeds", 4}}),
+         option("meat_lovers",        {{"cost", 22}, {"feeds", 4}}),
+         option("veggie_lovers",      {{"cost", 18}, {"feeds", 4}})},
+        {}, // no criteria
+        {}, // no fragments
+        {constraint("near_budget", "[abs($cost - 40)] <= 8"),
+         constraint("feeds_min", "[$feeds] >= 8")},
+        {}, // no displays
+        arma::mat({{1, 0, 0, 1, 1},
+                   {1, 0, 1, 0, 1},
+                   {0, 1, 1, 0, 1},
+                   {1, 0, 0, 1, 0}}),
+        arma::mat(),
+        arma::mat(), // no exclusion
+        0.5); // CI
+
+    // solved by Bonmin unless asked otherwise, the tests below are about its tapes
+    configuration config = dec.config();
+    config.enumeration_limit = enumeration_limit;
+    dec.configure(config);
+    return dec;
+}
+
+TEST_CASE("nonlinear constraint decision", "[integration]") {
+    decision pizza_decision = nonlinear_pizza_decision();
+    FixVar_Mask FV(pizza_decision.dim());
+    MathProgram MP(FV, pizza_decision, true, false);
+    pizza_decision.linkMathProgram(&MP);
+
+    const arma::vec cost{18, 12, 12, 22, 18};
+    tminlp_MP::clear_tape_cache();
+    const uint64_t hits = tminlp_MP::tape_cache_hits();
+
+    // top-N style loop: only the exclusion rows change between solves
+    arma::mat exclusions(1, pizza_decision.dim(), arma::fill::zeros);
+    for (int k = 0; k < 3; k++) {
+        pizza_decision.exclude(exclusions);
+        auto solution = pizza_decision.solve();
+        REQUIRE(solution.status == "success");
+        REQUIRE(std::abs(arma::dot(cost, solution.x) - 40) <= 8 + 1e-6);
+        exclusions.insert_rows(exclusions.n_rows, solution.x.t());
+    }
+
+    // the constraint tape is recorded once and reused by later solves
+    REQUIRE(tminlp_MP::tape_cache_hits() - hits == 2);
+    pizza_decision.unlinkMathProgram();
+}
+
+// the best count scenarios of dec, then its worst one
+inline std::vector<solution> ranked_scenarios(decision& dec, size_t count) {
+    std::vector<solution> solutions;
+    arma::mat exclusions(1, dec.dim(), arma::fill::zeros);
+    for (size_t k = 0; k < count; k++) {
+        dec.exclude(exclusions);
+        auto solution = dec.solve();
+        if (!solution.success) break;
+        solutions.push_back(solution);
+        exclusions.insert_rows(exclusions.n_rows, solution.x.t());
+    }
+
+    configuration config = dec.config();
+    config.minimize = true;
+    dec.configure(config);
+    dec.exclude(exclusions.rows(0, 0));
+    solutions.push_back(dec.solve());
+    config.minimize = false;
+    dec.configure(config);
+    return solutions;
+}
+
+TEST_CASE("enumeration ranks scenarios like the solvers", "[integration]") {
+    // without fairness the solvers are exact as well
+    decision solved = nonlinear_pizza_decision(0);
+    decision enumerated = nonlinear_pizza_decision(24);
+    for (decision* dec : {&solved, &enumerated}) {
+        configuration config = dec->config();
+        config.collective_identity = 0.0;
+        dec->configure(config);
+    }
+
+    FixVar_Mask FV(solved.dim());
+    MathProgram solved_MP(FV, solved, true, false), enumerated_MP(FV, enumerated, true, false);
+    solved.linkMathProgram(&solved_MP);
+    enumerated.linkMathProgram(&enumerated_MP);
+
+    auto expected = ranked_scenarios(solved, 4);
+    auto actual = ranked_scenarios(enumerated, 4);
+    REQUIRE(actual.size() == expected.size());
+    for (size_t k = 0; k < actual.size(); k++) {
+        INFO("scenario " << k << ": " << actual[k].x.t() << " expected " << expected[k].x.t());
+        REQUIRE(actual[k].status == expected[k].status);
+        REQUIRE(actual[k].metrics.solver == "enumeration");
+        if (expected[k].success) {
+            REQUIRE(actual[k].fgh[0] == Approx(expected[k].fgh[0]).margin(1e-6));
+            REQUIRE(actual[k].fgh[1] <= 8 + 1e-6); // near_budget
+            REQUIRE(actual[k].fgh[2] >= 8 - 1e-6); // feeds_min
+        }
+    }
+
+    solved.unlinkMathProgram();
+    enumerated.unlinkMathProgram();
+}
+
+TEST_CASE("enumeration sweeps once for the top and worst scenarios", "[integration]") {
+    decision pizza_decision = nonlinear_pizza_decision(24);
+    FixVar_Mask FV(pizza_decision.dim());
+    MathProgram MP(FV, pizza_decision, true, false);
+    pizza_decision.linkMathProgram(&MP);
+
+    auto solutions = ranked_scenarios(pizza_decision, 3);
+    REQUIRE(solutions.size() == 4);
+    REQUIRE(solutions[0].metrics.nodes == (size_t(1) << pizza_decision.dim()));
+    for (size_t k = 1; k < solutions.size(); k++) {
+        REQUIRE(solutions[k].metrics.solver == "enumeration");
+        REQUIRE(solutions[k].metrics.nodes == 0);
+    }
+
+    // new influents need a new sweep
+    pizza_decision.load(arma::mat({{1, 1, 0, 0, 1}}), arma::mat());
+    pizza_decision.exclude(arma::mat(1, pizza_decision.dim(), arma::fill::zeros));
+    REQUIRE(pizza_decision.solve().metrics.nodes > 0);
+    pizza_decision.unlinkMathProgram();
+}
+
+TEST_CASE("nonlinear constraint solve benchmark", "[.benchmark]") {
+    decision pizza_decision = nonlinear_pizza_decision();
+    FixVar_Mask FV(pizza_decision.dim());
+    MathProgram MP(FV, pizza_decision, true, false);
+    pizza_decision.linkMathProgram(&MP);
+
+    const int repetitions = 20;
+    for (bool reuse : {false, true}) {
+        tminlp_MP::clear_tape_cache();
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; r++) {
+            if (!reuse) tminlp_MP::clear_tape_cache();
+            pizza_decision.exclude(arma::mat(1, pizza_decision.dim(), arma::fill::zeros));
+            REQUIRE(pizza_decision.solve().status == "success");
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << (reuse ? "reused tapes: " : "fresh tapes:  ")
+                  << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / repetitions
+                  << "us per solve" << std::endl;
+    }
+    pizza_decision.unlinkMathProgram();
+}
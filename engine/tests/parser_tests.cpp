@@ -0,0 +1,93 @@
+#define CATCH_CONFIG_MAIN
+#include "../ethelo.hpp"
+#include <catch2/catch.hpp>
+#include <iostream>
+
+using ethelo::expression;
+
+// cases from expression_tests and constraint_tests
+static const std::vector<std::string> expression_cases = {
+    "1", "-1", "1 + 1", "2 * 2", "4 / 2", "4 / (1 + 1) * 2", "+1 + -1", "1 + 1 +", "abs(-4+2)", "sqrt(4)",
+    "* 2 * 4", "1 /", "2 * (1 + 1", "(1 + 1))", "abs(1 2)", "alpha[0", "sum[i in x]{x[i]", "sum[i in x] x[i]",
+    "filter[x]{1}", "$a(b", "1 <= [a + b", "1 <= a + b]",
+    "(a + b) * c", "z * z * ((a + b + 10) * 100 - c) / alpha + beta", "(alpha[0] + beta[5]) * gamma + zeta['key']",
+    "1a + b", "a@b + c",
+    "($a + $b) * c", "z * $z * ((a + $b + 10) * 100 - c) / alpha + $beta", "(alpha[0] + $beta[5]) * gamma + $zeta['key']",
+    "sum[i in x]{$alpha[i] + x[i] * y[i]}", "sum[i in $group]{$alpha[i] + x[i] * y[i]}",
+    "(@a + @b) * c", "z * @z * ((a + @b + 10) * 100 - c) / alpha + @beta",
+    "1 <= [a + b + c]", "10 >= [a + b + c]", "[a + b + c] >= 1", "[a + b + c] <= 10", "1 <= [a + b + c] <= 10",
+    "1 = [a + b + c]", "[a + b + c] = 1", "d <= [a + b + c]", "<= [a + b + c]", "1 < [a + b + c]"
+};
+
+static const std::vector<std::string> constraint_cases = {
+    "1 <= [a + b + c]", "10 >= [a + b + c]", "[a + b + c] >= 1", "[a + b + c] <= 10", "[a + b + c] >= -50.0",
+    "1 <= [a + b + c] <= 10", "1 = [a + b + c]", "[a + b + c] = 1",
+    "1 = [a + b + c] = 1", "1 <= [a + b + c] >= 1", "10 >= [a + b + c] <= 10", "1 <= [a + b +]"
+};
+
+struct parser_scope
+{
+    expression::parser_type previous;
+    parser_scope(expression::parser_type type) : previous(expression::parser_in_use()) { expression::use_parser(type); }
+    ~parser_scope() { expression::use_parser(previous); }
+};
+
+template<typename Ty>
+std::string parse_with(expression::parser_type type, const std::string& source)
+{
+    parser_scope scope(type);
+    try {
+        Ty expr("differential", source);
+        return expr.ast()->to_string_tree();
+    }
+    catch (const ethelo::syntax_error& ex) { return std::string("syntax_error ") + ex.what(); }
+    catch (const ethelo::semantic_error& ex) { return std::string("semantic_error ") + ex.what(); }
+}
+
+TEST_CASE("native parser matches the ANTLR parser", "[parser]") {
+    SECTION("expressions") {
+        for (const auto& source : expression_cases) {
+            INFO(source);
+            REQUIRE(parse_with<expression>(expression::NATIVE_PARSER, source) == parse_with<expression>(expression::ANTLR_PARSER, source));
+        }
+    }
+
+    SECTION("constraints") {
+        for (const auto& source : constraint_cases) {
+            INFO(source);
+            REQUIRE(parse_with<ethelo::constraint>(expression::NATIVE_PARSER, source) == parse_with<ethelo::constraint>(expression::ANTLR_PARSER, source));
+        }
+    }
+}
+
+TEST_CASE("native parser reports a missing token", "[parser]") {
+    parser_scope scope(expression::NATIVE_PARSER);
+    try {
+        expression("differential", "2 * (1 + 1");
+        FAIL("expected a syntax error");
+    }
+    catch (const ethelo::syntax_error& ex) {
+        REQUIRE(std::string(ex.what()).find("MissingTokenException") != std::string::npos);
+    }
+}
+
+TEST_CASE("parser throughput", "[.benchmark]") {
+    std::vector<std::string> corpus;
+    for (const auto& source : expression_cases) {
+        try { expression("benchmark", source); corpus.push_back(source); }
+        catch (const ethelo::syntax_error&) {}
+    }
+
+    const size_t rounds = 2000;
+    for (auto type : {expression::ANTLR_PARSER, expression::NATIVE_PARSER}) {
+        parser_scope scope(type);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; i++)
+            for (const auto& source : corpus)
+                expression("benchmark", source);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << (type == expression::ANTLR_PARSER ? "antlr" : "native") << ": "
+                  << (rounds * corpus.size()) / elapsed.count() << " expressions/s" << std::endl;
+    }
+}
@@ -0,0 +1,121 @@
+#include "thread_pool.hpp"
+
+#include <cstdlib>
+#include <string>
+
+namespace ethelo
+{
+    thread_local bool thread_pool::in_loop_ = false;
+    std::mutex thread_pool::global_mutex_;
+    std::unique_ptr<thread_pool> thread_pool::global_;
+
+    thread_pool::thread_pool(size_t threads)
+    {
+        for (size_t i = 1; i < threads; i++)
+            workers_.emplace_back(&thread_pool::work, this);
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    void thread_pool::parallel_for(size_t n, const std::function<void(size_t)>& fn)
+    {
+        if (n == 0) return;
+        if (workers_.empty() || n == 1 || in_loop_) {
+            for (size_t i = 0; i < n; i++)
+                fn(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submit_mutex_);
+
+        batch b;
+        b.fn = &fn;
+        b.n = n;
+        b.next = 0;
+        b.errors.resize(n);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch_ = &b;
+            generation_++;
+        }
+        wake_.notify_all();
+
+        in_loop_ = true;
+        run(b);
+        in_loop_ = false;
+
+        {
+            // workers only pick up the batch while holding the lock, so once
+            // none are active and the batch is withdrawn nobody can touch it
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this] { return active_ == 0; });
+            batch_ = nullptr;
+        }
+
+        for (auto& error : b.errors)
+            if (error) std::rethrow_exception(error);
+    }
+
+    void thread_pool::work()
+    {
+        in_loop_ = true;
+        size_t seen = 0;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+
+            seen = generation_;
+            batch* b = batch_;
+            if (!b) continue;
+
+            active_++;
+            lock.unlock();
+            run(*b);
+            lock.lock();
+            if (--active_ == 0)
+                idle_.notify_all();
+        }
+    }
+
+    void thread_pool::run(batch& b)
+    {
+        size_t i;
+        while ((i = b.next++) < b.n) {
+            try { (*b.fn)(i); }
+            catch (...) { b.errors[i] = std::current_exception(); }
+        }
+    }
+
+    thread_pool& thread_pool::global()
+    {
+        std::lock_guard<std::mutex> lock(global_mutex_);
+        if (!global_) {
+            size_t threads = std::thread::hardware_concurrency();
+            const char* env = std::getenv("ENGINE_THREADS");
+            if (env && *env) {
+                try { threads = std::stoul(env); }
+                catch (const std::exception&) {}
+            }
+            global_.reset(new thread_pool(threads > 0 ? threads : 1));
+        }
+        return *global_;
+    }
+
+    void thread_pool::configure(size_t threads)
+    {
+        std::lock_guard<std::mutex> lock(global_mutex_);
+        global_.reset(new thread_pool(threads > 0 ? threads : 1));
+    }
+}
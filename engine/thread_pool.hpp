@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ethelo
+{
+    /*
+        thread_pool keeps a fixed set of worker threads alive for the lifetime
+        of the pool and runs index-parallel loops on them.
+
+        parallel_for(n, fn) calls fn(i) exactly once for every i in [0, n); the
+        calling thread takes part in the work and the call returns only once
+        every index has been processed. Work items must write to disjoint
+        outputs (e.g. slot i of a pre-sized vector), which keeps results in
+        index order no matter which thread produced them. If any call throws,
+        the exception of the lowest failing index is rethrown in the caller.
+
+        Nested calls made from inside a running loop are executed inline.
+    */
+    class thread_pool
+    {
+    public:
+        explicit thread_pool(size_t threads);
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // number of threads taking part in a loop, including the caller
+        size_t size() const { return workers_.size() + 1; }
+
+        void parallel_for(size_t n, const std::function<void(size_t)>& fn);
+
+        // shared pool sized by ENGINE_THREADS (defaults to the hardware concurrency)
+        static thread_pool& global();
+
+        // replaces the shared pool; must not be called while it is in use
+        static void configure(size_t threads);
+
+    private:
+        struct batch {
+            const std::function<void(size_t)>* fn;
+            size_t n;
+            std::atomic<size_t> next;
+            std::vector<std::exception_ptr> errors;
+        };
+
+        void work();
+        static void run(batch& b);
+
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::mutex submit_mutex_;
+        std::condition_variable wake_;
+        std::condition_variable idle_;
+        batch* batch_ = nullptr;
+        size_t generation_ = 0;
+        size_t active_ = 0;
+        bool stop_ = false;
+
+        static thread_local bool in_loop_;
+        static std::mutex global_mutex_;
+        static std::unique_ptr<thread_pool> global_;
+    };
+}
@@ -56,6 +56,79 @@ namespace ethelo
         auto cend() const noexcept -> const decltype(vec_.cend()) { return vec_.cend(); }
     };
 
+    // indexed_view<T> presents the items of an indexed_vector, or those of them
+    // listed in an index, without copying them; positions refer to the view
+    template<typename T>
+    class indexed_view
+    {
+        const indexed_vector<T>* items_;
+        std::shared_ptr<const std::vector<size_t>> index_;            // nullptr for all items
+        std::shared_ptr<const std::vector<std::ptrdiff_t>> position_; // view position of each item, -1 if left out
+
+    public:
+        class iterator
+        {
+            const indexed_view* view_;
+            size_t pos_;
+
+        public:
+            iterator(const indexed_view* view, size_t pos) : view_(view), pos_(pos) {}
+            const T& operator*() const { return (*view_)[pos_]; }
+            const T* operator->() const { return &(*view_)[pos_]; }
+            iterator& operator++() { pos_++; return *this; }
+            bool operator==(const iterator& other) const { return pos_ == other.pos_; }
+            bool operator!=(const iterator& other) const { return pos_ != other.pos_; }
+        };
+
+        indexed_view(const indexed_vector<T>& items)
+            : items_(&items) {}
+        indexed_view(const indexed_vector<T>& items,
+                     const std::shared_ptr<const std::vector<size_t>>& index,
+                     const std::shared_ptr<const std::vector<std::ptrdiff_t>>& position)
+            : items_(&items), index_(index), position_(position) {}
+
+        std::ptrdiff_t find(const std::string& name) const {
+            std::ptrdiff_t pos = items_->find(name);
+            return (pos < 0 || !index_) ? pos : (*position_)[pos];
+        }
+
+        bool empty() const noexcept { return size() == 0; }
+        size_t size() const noexcept { return index_ ? index_->size() : items_->size(); }
+        const T& operator[](size_t pos) const { return (*items_)[index_ ? (*index_)[pos] : pos]; }
+        const T& front() const { return (*this)[0]; }
+        const T& back() const { return (*this)[size() - 1]; }
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, size()); }
+    };
+
+    // shared<T> holds an immutable T that copies refer to instead of duplicating;
+    // write() gives mutable access, cloning the value first while it is shared
+    template<typename T>
+    class shared
+    {
+        std::shared_ptr<T> ptr_;
+
+    public:
+        shared() : ptr_(std::make_shared<T>()) {}
+        shared(const T& value) : ptr_(std::make_shared<T>(value)) {}
+        shared(T&& value) : ptr_(std::make_shared<T>(std::move(value))) {}
+        shared(const shared& other) = default; // moves copy too, so no copy is left empty
+        shared& operator=(const shared& other) = default;
+        shared& operator=(const T& value) { ptr_ = std::make_shared<T>(value); return *this; }
+        shared& operator=(T&& value) { ptr_ = std::make_shared<T>(std::move(value)); return *this; }
+
+        // reset() replaces the value by a fresh T, returned for loading
+        T& reset() { ptr_ = std::make_shared<T>(); return *ptr_; }
+
+        const T& operator*() const { return *ptr_; }
+        const T* operator->() const { return ptr_.get(); }
+        T& write() {
+            if (!ptr_.unique())
+                ptr_ = std::make_shared<T>(*ptr_);
+            return *ptr_;
+        }
+    };
+
     class option; template<> inline const char* indexed_vector<option>::type_name() { return "option"; }
     class variable; template<> inline const char* indexed_vector<variable>::type_name() { return "variable"; }
     class criterion; template<> inline const char* indexed_vector<criterion>::type_name() { return "criterion"; }
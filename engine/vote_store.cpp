@@ -0,0 +1,258 @@
+#include "vote_store.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ethelo
+{
+    /*
+        Column kernels: out[r] += a * col[r], and sum_r col[r] * v[r].
+        Every variant converts stored values to double before multiplying, so
+        they only differ from each other in the order of the dot product sums.
+    */
+    namespace
+    {
+#if defined(__AVX2__)
+        inline __m256d load4(const float* p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+
+        inline __m256d load4(const int8_t* p)
+        {
+            int32_t word;
+            std::memcpy(&word, p, sizeof(word));
+            return _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(word)));
+        }
+
+        inline double hsum(__m256d v)
+        {
+            __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        }
+
+        template<typename T>
+        void axpy(const T* col, double a, double* out, size_t n)
+        {
+            const __m256d va = _mm256_set1_pd(a);
+            size_t r = 0;
+            for (; r + 4 <= n; r += 4)
+                _mm256_storeu_pd(out + r, _mm256_add_pd(_mm256_loadu_pd(out + r), _mm256_mul_pd(va, load4(col + r))));
+            for (; r < n; r++)
+                out[r] += a * col[r];
+        }
+
+        template<typename T>
+        double dot(const T* col, const double* v, size_t n)
+        {
+            __m256d acc = _mm256_setzero_pd();
+            size_t r = 0;
+            for (; r + 4 <= n; r += 4)
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(load4(col + r), _mm256_loadu_pd(v + r)));
+            double sum = hsum(acc);
+            for (; r < n; r++)
+                sum += col[r] * v[r];
+            return sum;
+        }
+#elif defined(__SSE2__)
+        // two doubles per register; int8 is sign extended by unpacking with itself
+        inline void load4(const float* p, __m128d& lo, __m128d& hi)
+        {
+            __m128 f = _mm_loadu_ps(p);
+            lo = _mm_cvtps_pd(f);
+            hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+        }
+
+        inline void load4(const int8_t* p, __m128d& lo, __m128d& hi)
+        {
+            int32_t word;
+            std::memcpy(&word, p, sizeof(word));
+            __m128i b = _mm_cvtsi32_si128(word);
+            b = _mm_unpacklo_epi8(b, b);
+            b = _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 24);
+            lo = _mm_cvtepi32_pd(b);
+            hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+
+        template<typename T>
+        void axpy(const T* col, double a, double* out, size_t n)
+        {
+            const __m128d va = _mm_set1_pd(a);
+            __m128d lo, hi;
+            size_t r = 0;
+            for (; r + 4 <= n; r += 4) {
+                load4(col + r, lo, hi);
+                _mm_storeu_pd(out + r, _mm_add_pd(_mm_loadu_pd(out + r), _mm_mul_pd(va, lo)));
+                _mm_storeu_pd(out + r + 2, _mm_add_pd(_mm_loadu_pd(out + r + 2), _mm_mul_pd(va, hi)));
+            }
+            for (; r < n; r++)
+                out[r] += a * col[r];
+        }
+
+        template<typename T>
+        double dot(const T* col, const double* v, size_t n)
+        {
+            __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd(), lo, hi;
+            size_t r = 0;
+            for (; r + 4 <= n; r += 4) {
+                load4(col + r, lo, hi);
+                acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, _mm_loadu_pd(v + r)));
+                acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, _mm_loadu_pd(v + r + 2)));
+            }
+            __m128d s = _mm_add_pd(acc0, acc1);
+            double sum = _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+            for (; r < n; r++)
+                sum += col[r] * v[r];
+            return sum;
+        }
+#else
+        template<typename T>
+        void axpy(const T* col, double a, double* out, size_t n)
+        {
+            for (size_t r = 0; r < n; r++)
+                out[r] += a * col[r];
+        }
+
+        template<typename T>
+        double dot(const T* col, const double* v, size_t n)
+        {
+            double sum = 0.0;
+            for (size_t r = 0; r < n; r++)
+                sum += col[r] * v[r];
+            return sum;
+        }
+#endif
+    }
+
+    null_bitmap::null_bitmap(const arma::mat& votes, double null_value)
+        : null_bitmap(votes.n_rows, votes.n_cols)
+    {
+        const double eps = std::numeric_limits<double>::epsilon();
+        for (size_t c = 0; c < n_cols_; c++) {
+            const double* col = votes.colptr(c);
+            for (size_t r = 0; r < n_rows_; r++)
+                if (std::isnan(col[r]) || std::abs(col[r] - null_value) <= eps)
+                    set(r, c);
+        }
+    }
+
+    vote_store::vote_store(const arma::mat& votes, format f, double null_value)
+        : vote_store(votes, null_bitmap(votes, null_value), f)
+    {}
+
+    vote_store::vote_store(const arma::mat& votes, const null_bitmap& nulls, format f)
+        : format_(f), n_rows_(votes.n_rows), n_cols_(votes.n_cols), nulls_(nulls)
+    {
+        if (nulls_.n_rows() != n_rows_ || nulls_.n_cols() != n_cols_)
+            throw std::invalid_argument("null bitmap does not match the vote matrix");
+
+        const size_t n = n_rows_ * n_cols_;
+        valid_.assign(n_cols_, 0);
+        if (format_ == format::float32)
+            f32_.resize(n);
+        else {
+            i8_.resize(n);
+            scale_.resize(n_cols_);
+        }
+
+        for (size_t c = 0; c < n_cols_; c++) {
+            double max_abs = 0.0;
+            for (size_t r = 0; r < n_rows_; r++) {
+                if (nulls_.test(r, c)) continue;
+                double v = votes.at(r, c);
+                valid_[c]++;
+                max_abs = std::max(max_abs, std::abs(v));
+                if (format_ == format::float32)
+                    f32_[r + c * n_rows_] = static_cast<float>(v);
+            }
+
+            if (format_ == format::int8) {
+                double step = (max_abs > 0.0 ? max_abs : 1.0) / levels;
+                scale_[c] = step;
+                for (size_t r = 0; r < n_rows_; r++) {
+                    if (nulls_.test(r, c)) continue;
+                    long q = std::lround(votes.at(r, c) / step);
+                    i8_[r + c * n_rows_] = static_cast<int8_t>(std::max<long>(-levels, std::min<long>(levels, q)));
+                }
+            }
+        }
+    }
+
+    size_t vote_store::bytes() const
+    {
+        return f32_.size() * sizeof(float) + i8_.size() * sizeof(int8_t)
+            + scale_.size() * sizeof(double) + nulls_.bytes();
+    }
+
+    double vote_store::at(size_t row, size_t col) const
+    {
+        size_t i = row + col * n_rows_;
+        if (format_ == format::float32)
+            return f32_[i];
+        return i8_[i] * scale_[col];
+    }
+
+    void vote_store::multiply(const double* x, double* out) const
+    {
+        std::fill(out, out + n_rows_, 0.0);
+        for (size_t c = 0; c < n_cols_; c++) {
+            if (x[c] == 0.0) continue;
+            if (format_ == format::float32)
+                axpy(f32_.data() + c * n_rows_, x[c], out, n_rows_);
+            else
+                axpy(i8_.data() + c * n_rows_, x[c] * scale_[c], out, n_rows_);
+        }
+    }
+
+    void vote_store::multiply_transpose(const double* v, double* out) const
+    {
+        for (size_t c = 0; c < n_cols_; c++) {
+            if (format_ == format::float32)
+                out[c] = dot(f32_.data() + c * n_rows_, v, n_rows_);
+            else
+                out[c] = scale_[c] * dot(i8_.data() + c * n_rows_, v, n_rows_);
+        }
+    }
+
+    void vote_store::column_means(double* out) const
+    {
+        for (size_t c = 0; c < n_cols_; c++) {
+            double sum = 0.0;
+            if (format_ == format::float32) {
+                const float* col = f32_.data() + c * n_rows_;
+                for (size_t r = 0; r < n_rows_; r++)
+                    sum += col[r];
+            } else {
+                // integer sums are exact
+                const int8_t* col = i8_.data() + c * n_rows_;
+                int64_t q = 0;
+                for (size_t r = 0; r < n_rows_; r++)
+                    q += col[r];
+                sum = q * scale_[c];
+            }
+            out[c] = n_rows_ > 0 ? sum / n_rows_ : 0.0;
+        }
+    }
+
+    bool vote_store::configured(format& f)
+    {
+        static const int selected = [] {
+            const char* env = std::getenv("ENGINE_VOTE_STORE");
+            std::string name = env ? env : "";
+            if (name == "float32") return 0;
+            if (name == "int8") return 1;
+            return -1;
+        }();
+
+        if (selected < 0) return false;
+        f = selected == 0 ? format::float32 : format::int8;
+        return true;
+    }
+}
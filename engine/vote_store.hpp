@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <armadillo>
+
+namespace ethelo
+{
+    /*
+        null_bitmap marks the null entries of a vote matrix, one bit per entry
+        in column-major order. Deserializers fill it while reading votes, so
+        later stages never need to compare against a sentinel value.
+    */
+    class null_bitmap
+    {
+        size_t n_rows_ = 0, n_cols_ = 0;
+        std::vector<uint64_t> bits_;
+
+    public:
+        null_bitmap() {}
+        null_bitmap(size_t n_rows, size_t n_cols)
+            : n_rows_(n_rows), n_cols_(n_cols), bits_((n_rows * n_cols + 63) / 64, 0) {}
+
+        // marks the entries of votes within machine epsilon of null_value, and NaNs
+        null_bitmap(const arma::mat& votes, double null_value);
+
+        size_t n_rows() const { return n_rows_; }
+        size_t n_cols() const { return n_cols_; }
+        size_t bytes() const { return bits_.size() * sizeof(uint64_t); }
+
+        bool test(size_t row, size_t col) const
+        {
+            size_t i = row + col * n_rows_;
+            return (bits_[i / 64] >> (i % 64)) & 1;
+        }
+
+        void set(size_t row, size_t col)
+        {
+            size_t i = row + col * n_rows_;
+            bits_[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    };
+
+    // a vote matrix as read from input: null entries hold null_vote in values
+    struct vote_matrix
+    {
+        arma::mat values;
+        null_bitmap nulls;
+    };
+
+    /*
+        vote_store keeps an influent matrix in a compact column-major form,
+        either as float32 values or as int8 fixed point with one step per
+        column (value = q * max |column| / 120, |q| <= 120).
+        Null entries are stored as 0 and flagged in a separate bitmap, so they
+        drop out of every product.
+
+        Per entry, the stored value differs from the double one by at most
+            float32: 6e-8 relative
+            int8:    max |column| / 240 absolute
+        and all products accumulate in double. 120 has many divisors, so votes
+        on a scale of halves, thirds, quarters, fifths, sixths, eighths or
+        tenths of the column maximum are exact in int8.
+
+        The kernels use AVX2 when the library is built with it (see the
+        ENGINE_AVX2 CMake option), SSE2 on other x86-64 builds, and plain loops
+        elsewhere.
+    */
+    class vote_store
+    {
+    public:
+        enum class format { float32, int8 };
+
+    private:
+        format format_;
+        size_t n_rows_, n_cols_;
+        std::vector<float> f32_;
+        std::vector<int8_t> i8_;
+        std::vector<double> scale_;   // value of q = 1 in column c (int8 only)
+        static const int8_t levels = 120;
+        null_bitmap nulls_;
+        std::vector<size_t> valid_;   // non-null entries per column
+
+    public:
+        // entries equal to null_value (or NaN) are flagged as null
+        vote_store(const arma::mat& votes, format f, double null_value = std::numeric_limits<double>::quiet_NaN());
+        vote_store(const arma::mat& votes, const null_bitmap& nulls, format f);
+
+        size_t n_rows() const { return n_rows_; }
+        size_t n_cols() const { return n_cols_; }
+        format storage() const { return format_; }
+
+        // bytes held by values, scales and the null bitmap
+        size_t bytes() const;
+
+        bool is_null(size_t row, size_t col) const { return nulls_.test(row, col); }
+        size_t valid(size_t col) const { return valid_[col]; }
+
+        // stored value of an entry, 0 for nulls
+        double at(size_t row, size_t col) const;
+
+        // out = V x; x has n_cols entries, out n_rows
+        void multiply(const double* x, double* out) const;
+
+        // out = V' v; v has n_rows entries, out n_cols
+        void multiply_transpose(const double* v, double* out) const;
+
+        // out[c] = sum of column c / n_rows, nulls counting as 0
+        void column_means(double* out) const;
+
+        // format selected by ENGINE_VOTE_STORE (float32 or int8), read once;
+        //   false when votes are kept as doubles
+        static bool configured(format& f);
+    };
+}